@@ -48,11 +48,13 @@ void VRButton::draw()
 	glEnd();
 
 	if (!m_text.empty())
-		VRFontHandler::getInstance()->renderTextBox(m_text, m_x, m_y, 2.0*Z_OFFSET, m_width, m_height);
+		VRFontHandler::getInstance()->renderTextBox(m_textLayout, m_text, m_x, m_y, 2.0*Z_OFFSET, m_width, m_height);
 }
 
 void VRButton::click(double x, double y, bool isDown)
 {
+	if (m_clicked != isDown)
+		markDirty();
 	m_clicked = isDown;
 	if (isDown)
 	{
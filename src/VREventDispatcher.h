@@ -0,0 +1,112 @@
+#ifndef VREVENTDISPATCHER_H
+#define VREVENTDISPATCHER_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <chrono>
+#include <api/MinVR.h>
+
+//Routes events to member functions of T. Event names are interned once into integer ids
+//when a handler is added, routing an event is a single hash lookup of its name into the table
+//of handlers and allocates nothing.
+//E is any event type with getName(), by default the VREvent of MinVR.
+template <class T, class E = MinVR::VREvent>
+class VREventDispatcher {
+public:
+	typedef void (T::*Handler)(const E &event);
+
+	VREventDispatcher(T * owner) : m_owner(owner), m_eventCount(0), m_eventsPerSecond(0)
+	{
+		m_intervalStart = std::chrono::steady_clock::now();
+	}
+
+	//returns the id of the event name, adding it if it was not seen before
+	int intern(const std::string &name)
+	{
+		std::unordered_map<std::string, int>::const_iterator it = m_ids.find(name);
+		if (it != m_ids.end())
+			return it->second;
+
+		int id = m_handlers.size();
+		m_ids[name] = id;
+		m_handlers.push_back(NULL);
+		return id;
+	}
+
+	//returns the id of the event name or -1 if it is unknown
+	int lookup(const std::string &name) const
+	{
+		std::unordered_map<std::string, int>::const_iterator it = m_ids.find(name);
+		return (it != m_ids.end()) ? it->second : -1;
+	}
+
+	void addHandler(const std::string &name, Handler handler)
+	{
+		m_handlers[intern(name)] = handler;
+	}
+
+	bool hasHandler(int id) const
+	{
+		return id >= 0 && m_handlers[id];
+	}
+
+	bool hasHandler(const std::string &name) const
+	{
+		return hasHandler(lookup(name));
+	}
+
+	//calls the handler registered for the event. Returns false if there is none
+	bool dispatch(const E &event)
+	{
+		return dispatch(lookup(event.getName()), event);
+	}
+
+	//as above, with the name of the event read once by the caller
+	bool dispatch(const std::string &name, const E &event)
+	{
+		return dispatch(lookup(name), event);
+	}
+
+	//as above, with the id of the event name from lookup
+	bool dispatch(int id, const E &event)
+	{
+		countEvent();
+
+		if (!hasHandler(id))
+			return false;
+
+		(m_owner->*m_handlers[id])(event);
+		return true;
+	}
+
+	//number of events processed per second, updated once per second
+	double getEventsPerSecond() const
+	{
+		return m_eventsPerSecond;
+	}
+
+private:
+	void countEvent()
+	{
+		m_eventCount++;
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		double seconds = std::chrono::duration<double>(now - m_intervalStart).count();
+		if (seconds >= 1.0)
+		{
+			m_eventsPerSecond = m_eventCount / seconds;
+			m_eventCount = 0;
+			m_intervalStart = now;
+		}
+	}
+
+	T * m_owner;
+	std::unordered_map<std::string, int> m_ids;
+	std::vector<Handler> m_handlers;
+
+	long m_eventCount;
+	double m_eventsPerSecond;
+	std::chrono::steady_clock::time_point m_intervalStart;
+};
+
+#endif //VREVENTDISPATCHER_H
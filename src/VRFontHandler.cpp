@@ -5,23 +5,80 @@
 
 #include "VRFontHandler.h"
 #include <iostream>
+#include <cstring>
 
 #define TEXTBORDER 0.003
+//size the glyphs are rasterized with into the atlas
+#define FONT_ATLAS_PIXELS 48
+//layout units correspond to a face size of 10 (the former FTGL FaceSize)
+#define FONT_FACE_SIZE 10.0f
 
 VRFontHandler* VRFontHandler::instance = NULL;
 
-VRFontHandler::VRFontHandler() 
+VRFontHandler::VRFontHandler() : m_library(NULL), m_face(NULL), m_texture(0), m_atlasSize(512), m_batching(false)
 {
-	font= new FTGLPolygonFont("calibri.ttf");
+	memset(m_glyphs, 0, sizeof(m_glyphs));
 
-	if (font->Error()){
+	if (FT_Init_FreeType(&m_library) || FT_New_Face(m_library, "calibri.ttf", 0, &m_face)){
 		std::cerr << "Font load error" << std::endl;
+		m_face = NULL;
 	}
-	font->FaceSize(10);
+	else
+	{
+		FT_Set_Pixel_Sizes(m_face, 0, FONT_ATLAS_PIXELS);
+
+		//rasterize all printable characters and pack them row by row into the atlas
+		float unit = FONT_FACE_SIZE / FONT_ATLAS_PIXELS;
+		bool fits = false;
+		while (!fits)
+		{
+			fits = true;
+			m_atlasPixels.assign(m_atlasSize * m_atlasSize, 0);
+			int pen_x = 1, pen_y = 1, rowHeight = 0;
+			for (int c = FONT_FIRST_CHAR; c <= FONT_LAST_CHAR && fits; c++)
+			{
+				if (FT_Load_Char(m_face, c, FT_LOAD_RENDER))
+					continue;
+
+				FT_GlyphSlot slot = m_face->glyph;
+				int w = slot->bitmap.width;
+				int h = slot->bitmap.rows;
+				if (pen_x + w + 1 > m_atlasSize)
+				{
+					pen_x = 1;
+					pen_y += rowHeight + 1;
+					rowHeight = 0;
+				}
+				if (pen_y + h + 1 > m_atlasSize)
+				{
+					fits = false;
+					m_atlasSize *= 2;
+					break;
+				}
+
+				for (int row = 0; row < h; row++)
+					memcpy(&m_atlasPixels[(pen_y + row) * m_atlasSize + pen_x], &slot->bitmap.buffer[row * slot->bitmap.pitch], w);
 
-	float ll[3], ur[3];
+				Glyph &g = m_glyphs[c - FONT_FIRST_CHAR];
+				g.advance = (slot->advance.x >> 6) * unit;
+				g.left = slot->bitmap_left * unit;
+				g.top = slot->bitmap_top * unit;
+				g.width = w * unit;
+				g.height = h * unit;
+				g.s0 = (float)pen_x / m_atlasSize;
+				g.t0 = (float)pen_y / m_atlasSize;
+				g.s1 = (float)(pen_x + w) / m_atlasSize;
+				g.t1 = (float)(pen_y + h) / m_atlasSize;
+
+				pen_x += w + 1;
+				if (h > rowHeight) rowHeight = h;
+			}
+		}
+	}
+
+	float ll[2], ur[2];
 	std::string test = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
-	font->BBox(test.c_str(), ll[0], ll[1], ll[2], ur[0], ur[1], ur[2]);
+	bbox(test, ll, ur);
 	m_fontMinMax[0] = ll[1];
 	m_fontMinMax[1] = ur[1];
 }
@@ -29,7 +86,12 @@ VRFontHandler::VRFontHandler()
 VRFontHandler::~VRFontHandler()
 {
 	instance = NULL;
-	delete font;
+	if (m_texture)
+		glDeleteTextures(1, &m_texture);
+	if (m_face)
+		FT_Done_Face(m_face);
+	if (m_library)
+		FT_Done_FreeType(m_library);
 }
 
 VRFontHandler* VRFontHandler::getInstance()
@@ -41,88 +103,209 @@ VRFontHandler* VRFontHandler::getInstance()
 	return instance;
 }
 
-FTFont* VRFontHandler::getFont()
+void VRFontHandler::renderTextBox(TextLayout &layout, const std::string &text, double x, double y, double z, double width, double height, TextAlignment alignment, bool rotateY)
 {
-	return font;
+	if (needsLayout(layout, x, y, z, width, height, alignment, rotateY))
+	{
+		float ll[2], ur[2], fontWidth, fontHeight;
+		float scale = 0.02;
+		bbox(text, ll, ur);
+		fontWidth = (ur[0] - ll[0]) * scale;
+		fontHeight = (ur[1] - ll[1]) * scale;
+
+		if (fontWidth > (width - 2.0*TEXTBORDER) || fontHeight > (height - 2.0*TEXTBORDER))
+		{
+			float scale_x = (width - 2.0*TEXTBORDER) / fontWidth * scale;
+			float scale_y = (height - 2.0*TEXTBORDER) / fontHeight * scale;
+
+			scale = (scale_x < scale_y) ? scale_x : scale_y;
+			fontWidth = (ur[0] - ll[0]) * scale;
+			fontHeight = (ur[1] - ll[1]) * scale;
+		}
+
+		double off_x = (width - fontWidth) / 2.0f;
+		double off_y = (height - fontHeight) / 2.0f;  //Bounding box isn't centered, so we need to add fudge factor
+
+		if (alignment == TextAlignment::LEFT) off_x = TEXTBORDER;
+		if (alignment == TextAlignment::RIGHT) off_x = width - TEXTBORDER - fontWidth;
+
+		off_x -= ll[0] * scale;
+		off_y -= ll[1] * scale;
+
+		addGlyphs(layout, text, x + off_x, y + off_y, scale);
+	}
+
+	draw(layout.vertices);
 }
 
-void VRFontHandler::renderTextBox(std::string text, double x, double y, double z, double width, double height, TextAlignment alignment, bool rotateY)
+void VRFontHandler::renderMultiLineTextBox(TextLayout &layout, const std::vector<std::string> &text, double x, double y, double z, double width, double height, TextAlignment alignment, bool rotateY)
 {
-	float ll[3], ur[3], fontWidth, fontHeight;
-	float scale = 0.02;
-	font->BBox(text.c_str(), ll[0], ll[1], ll[2], ur[0], ur[1], ur[2]);
-	fontWidth = (ur[0] - ll[0]) * scale;
-	fontHeight = (ur[1] - ll[1]) * scale;
+	if (text.size() == 0)
+		return;
 
-	if (fontWidth > (width - 2.0*TEXTBORDER) || fontHeight > (height - 2.0*TEXTBORDER))
+	if (needsLayout(layout, x, y, z, width, height, alignment, rotateY))
 	{
-		float scale_x = (width - 2.0*TEXTBORDER) / fontWidth * scale;
-		float scale_y = (height - 2.0*TEXTBORDER) / fontHeight * scale;
+		float ll[2], ur[2], fontWidth, fontHeight;
+		float scale = 0.02;
+		double textheight = height / text.size();
 
-		scale = (scale_x < scale_y) ? scale_x : scale_y;
-		fontWidth = (ur[0] - ll[0]) * scale;
-		fontHeight = (ur[1] - ll[1]) * scale;
-	}
+		for (std::vector <std::string>::const_iterator it = text.begin(); it != text.end(); ++it){
+			bbox(*it, ll, ur);
+			fontWidth = (ur[0] - ll[0]) * scale;
 
-	double off_x = (width  - fontWidth) / 2.0f;
-	double off_y = (height - fontHeight) / 2.0f;  //Bounding box isn't centered, so we need to add fudge factor
+			if (fontWidth > (width - 2.0*TEXTBORDER))
+			{
+				scale = (width - 2.0*TEXTBORDER) / fontWidth * scale;
+			}
+		}
 
-	if (alignment == TextAlignment::LEFT) off_x = TEXTBORDER;
-	if (alignment == TextAlignment::RIGHT) off_x = width - TEXTBORDER - fontWidth;
+		fontHeight = (m_fontMinMax[1] - m_fontMinMax[0]) * scale;
+		if (fontHeight > (textheight - 2.0*TEXTBORDER))
+		{
+			scale = (textheight - 2.0*TEXTBORDER) / fontHeight * scale;
+			fontHeight = (m_fontMinMax[1] - m_fontMinMax[0]) * scale;
+		}
+
+		double off_y = (textheight - fontHeight) / 2.0f - m_fontMinMax[0] * scale;  //Bounding box isn't centered, so we need to add fudge factor
 
-	off_x -= ll[0] * scale;
-	off_y -= ll[1] * scale;
+		for (int i = 0; i < text.size(); i++){
+			bbox(text[i], ll, ur);
+			fontWidth = (ur[0] - ll[0]) * scale;
+			double off_x = (width - fontWidth) / 2.0f;
 
-	glPushMatrix();
-	glTranslatef(x + off_x, y + off_y, z);
-	glScalef(scale, scale, scale);
-	if (rotateY)glRotatef(180, 0, 1, 0);
-	font->Render(text.c_str());
-	glPopMatrix();
+			if (alignment == TextAlignment::LEFT) off_x = TEXTBORDER;
+			if (alignment == TextAlignment::RIGHT) off_x = width - TEXTBORDER - fontWidth;
+			off_x -= ll[0] * scale;
+
+			addGlyphs(layout, text[i], x + off_x, y + off_y + (text.size() - i - 1) * textheight, scale);
+		}
+	}
+
+	draw(layout.vertices);
 }
 
-void VRFontHandler::renderMultiLineTextBox(std::vector<std::string> text, double x, double y, double z, double width, double height, TextAlignment alignment, bool rotateY)
+void VRFontHandler::beginBatch()
 {
-	if (text.size() == 0)
-		return;
+	m_batching = true;
+	m_batch.clear();
+}
 
-	float ll[3], ur[3], fontWidth, fontHeight;
-	float scale = 0.02;
-	double textheight = height / text.size();
+void VRFontHandler::endBatch()
+{
+	m_batching = false;
+	draw(m_batch);
+	m_batch.clear();
+}
 
-	for (std::vector <std::string>::const_iterator it = text.begin(); it != text.end(); ++it){
-		font->BBox(it->c_str(), ll[0], ll[1], ll[2], ur[0], ur[1], ur[2]);
-		fontWidth = (ur[0] - ll[0]) * scale;
-		
-		if (fontWidth > (width - 2.0*TEXTBORDER))
+void VRFontHandler::createAtlas()
+{
+	glGenTextures(1, &m_texture);
+	glBindTexture(GL_TEXTURE_2D, m_texture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_ALPHA, m_atlasSize, m_atlasSize, 0, GL_ALPHA, GL_UNSIGNED_BYTE, m_atlasPixels.empty() ? NULL : &m_atlasPixels[0]);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	//the pixels are only needed for the upload
+	std::vector<unsigned char>().swap(m_atlasPixels);
+}
+
+void VRFontHandler::bbox(const std::string &text, float *ll, float *ur)
+{
+	float pen = 0;
+	bool empty = true;
+	ll[0] = ll[1] = ur[0] = ur[1] = 0;
+	for (std::string::const_iterator it = text.begin(); it != text.end(); ++it)
+	{
+		if (*it < FONT_FIRST_CHAR || *it > FONT_LAST_CHAR)
+			continue;
+		const Glyph &g = m_glyphs[*it - FONT_FIRST_CHAR];
+		if (g.width > 0 && g.height > 0)
 		{
-			scale = (width - 2.0*TEXTBORDER) / fontWidth * scale;
+			float x0 = pen + g.left, y0 = g.top - g.height;
+			float x1 = x0 + g.width, y1 = g.top;
+			if (empty || x0 < ll[0]) ll[0] = x0;
+			if (empty || y0 < ll[1]) ll[1] = y0;
+			if (empty || x1 > ur[0]) ur[0] = x1;
+			if (empty || y1 > ur[1]) ur[1] = y1;
+			empty = false;
 		}
+		pen += g.advance;
 	}
-	
-	fontHeight = (m_fontMinMax[1] - m_fontMinMax[0]) * scale;
-	if (fontHeight > (textheight - 2.0*TEXTBORDER))
+}
+
+void VRFontHandler::addGlyphs(TextLayout &layout, const std::string &text, double x, double y, float scale)
+{
+	float dir = layout.rotateY ? -1.0f : 1.0f;
+	float pen = 0;
+	for (std::string::const_iterator it = text.begin(); it != text.end(); ++it)
 	{
-		scale = (textheight - 2.0*TEXTBORDER) / fontHeight * scale;
-		fontHeight = (m_fontMinMax[1] - m_fontMinMax[0]) * scale;
+		if (*it < FONT_FIRST_CHAR || *it > FONT_LAST_CHAR)
+			continue;
+		const Glyph &g = m_glyphs[*it - FONT_FIRST_CHAR];
+		if (g.width > 0 && g.height > 0)
+		{
+			float x0 = x + dir * (pen + g.left) * scale;
+			float x1 = x + dir * (pen + g.left + g.width) * scale;
+			float y0 = y + (g.top - g.height) * scale;
+			float y1 = y + g.top * scale;
+			float quad[20] = {
+				g.s0, g.t1, x0, y0, (float)layout.z,		// Bottom Left
+				g.s1, g.t1, x1, y0, (float)layout.z,		// Bottom Right
+				g.s1, g.t0, x1, y1, (float)layout.z,		// Top Right
+				g.s0, g.t0, x0, y1, (float)layout.z };		// Top Left
+			layout.vertices.insert(layout.vertices.end(), quad, quad + 20);
+		}
+		pen += g.advance;
 	}
+}
 
-	double off_y = (textheight - fontHeight) / 2.0f - m_fontMinMax[0] * scale;  //Bounding box isn't centered, so we need to add fudge factor
+bool VRFontHandler::needsLayout(TextLayout &layout, double x, double y, double z, double width, double height, TextAlignment alignment, bool rotateY)
+{
+	if (layout.valid && layout.x == x && layout.y == y && layout.z == z && layout.width == width && layout.height == height &&
+		layout.alignment == alignment && layout.rotateY == rotateY)
+		return false;
 
-	for (int i = 0; i < text.size(); i++){
-		font->BBox(text[i].c_str(), ll[0], ll[1], ll[2], ur[0], ur[1], ur[2]);
-		fontWidth = (ur[0] - ll[0]) * scale;
-		double off_x = (width  - fontWidth) / 2.0f;
-		
-		if (alignment == TextAlignment::LEFT) off_x = TEXTBORDER;
-		if (alignment == TextAlignment::RIGHT) off_x = width - TEXTBORDER - fontWidth;
-		off_x -= ll[0] * scale;
+	layout.valid = true;
+	layout.x = x;
+	layout.y = y;
+	layout.z = z;
+	layout.width = width;
+	layout.height = height;
+	layout.alignment = alignment;
+	layout.rotateY = rotateY;
+	layout.vertices.clear();
+	return true;
+}
 
-		glPushMatrix();
-		glTranslatef(x + off_x, y + off_y + (text.size() - i - 1) * textheight, z);
-		glScalef(scale, scale, scale);
-		if (rotateY)glRotatef(180, 0, 1, 0);
-		font->Render(text[i].c_str());
-		glPopMatrix();
+void VRFontHandler::draw(const std::vector<float> &vertices)
+{
+	if (m_batching)
+	{
+		m_batch.insert(m_batch.end(), vertices.begin(), vertices.end());
+		return;
 	}
+
+	if (vertices.empty() || !m_face)
+		return;
+
+	if (!m_texture)
+		createAtlas();
+
+	glPushAttrib(GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT | GL_TEXTURE_BIT);
+	glEnable(GL_TEXTURE_2D);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+	glBindTexture(GL_TEXTURE_2D, m_texture);
+
+	glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
+	glInterleavedArrays(GL_T2F_V3F, 0, &vertices[0]);
+	glDrawArrays(GL_QUADS, 0, vertices.size() / 5);
+	glPopClientAttrib();
+
+	glPopAttrib();
 }
@@ -1,8 +1,13 @@
 #ifndef VRFONT_H_
 #define VRFONT_H_
 
-#include <FTGL/ftgl.h>
+#include <ft2build.h>
+#include FT_FREETYPE_H
 #include <string>
+#include <vector>
+
+#define FONT_FIRST_CHAR 32
+#define FONT_LAST_CHAR 126
 
 class VRFontHandler
 	{
@@ -14,21 +19,57 @@ class VRFontHandler
 				RIGHT
 			};
 
+			//Glyph quads of a string placed in a text box. Computed once and reused until
+			//the text (see invalidate) or the box changes.
+			struct TextLayout
+			{
+				TextLayout() : valid(false){};
+				void invalidate(){ valid = false; };
+
+				bool valid;
+				double x, y, z, width, height;
+				TextAlignment alignment;
+				bool rotateY;
+				std::vector<float> vertices;	//s,t,x,y,z per quad corner
+			};
+
 			virtual ~VRFontHandler();
 			static VRFontHandler* getInstance();
 
-			FTFont* getFont();
+			void renderTextBox(TextLayout &layout, const std::string &text, double x, double y, double z, double width, double height, TextAlignment alignment = CENTER, bool rotateY = false);
+			void renderMultiLineTextBox(TextLayout &layout, const std::vector<std::string> &text, double x, double y, double z, double width, double height, TextAlignment alignment = CENTER, bool rotateY = false);
 
-			void renderTextBox(std::string text, double x, double y, double z, double width, double height, TextAlignment alignment = CENTER, bool rotateY = false);
-			void renderMultiLineTextBox(std::vector<std::string> text, double x, double y, double z, double width, double height, TextAlignment alignment = CENTER, bool rotateY = false);
+			//collects all text rendered until endBatch and draws it with a single call in the current color
+			void beginBatch();
+			void endBatch();
 
 		private:
+			struct Glyph
+			{
+				float advance;
+				float left, top, width, height;
+				float s0, t0, s1, t1;
+			};
+
 			VRFontHandler();
 			static VRFontHandler* instance;
 
-			FTFont* font;
+			void createAtlas();
+			void bbox(const std::string &text, float *ll, float *ur);
+			void addGlyphs(TextLayout &layout, const std::string &text, double x, double y, float scale);
+			bool needsLayout(TextLayout &layout, double x, double y, double z, double width, double height, TextAlignment alignment, bool rotateY);
+			void draw(const std::vector<float> &vertices);
+
+			FT_Library m_library;
+			FT_Face m_face;
+			unsigned int m_texture;
+			int m_atlasSize;
+			std::vector<unsigned char> m_atlasPixels;
+			Glyph m_glyphs[FONT_LAST_CHAR - FONT_FIRST_CHAR + 1];
 			double m_fontMinMax[2];
+
+			bool m_batching;
+			std::vector<float> m_batch;
 	};
 
 #endif /* VRFONT_H_ */
-
@@ -1,19 +1,46 @@
 #ifdef _WIN32
-#define NOMINMAX 
+#define NOMINMAX
 #include <windows.h>
 #endif
-#include <GL/gl.h>
+#include <GL/glew.h>
 #include <limits>
 #include "VRGraph.h"
+#include "VRMemoryTracker.h"
 
-VRGraph::VRGraph(std::string name, std::vector<double> data) : VRMenuElement(name, ""), m_data(data), m_current(-1), m_selection(-1), m_mouseDown(false)
+static int memoryCategory()
 {
+	static int category = VRMemoryTracker::getInstance()->addCategory("Graphs");
+	return category;
+}
+
+static bool isValue(double value)
+{
+	return value != GRAPHUNDEFINEDVALUE && value != GRAPHSKIPDVALUE;
+}
+
+VRGraph::VRGraph(std::string name, const std::vector<double> &data) : VRMenuElement(name, ""), m_data(data), m_first(0), m_last(data.size()), m_current(-1), m_selection(-1), m_mouseDown(false),
+m_vbo(0), m_verticesDirty(true), m_cpuBytes(0), m_gpuBytes(0)
+{
+	buildPyramid();
 	computeBounds();
+	countMemory(0);
 }
 
 VRGraph::~VRGraph()
 {
+	if (m_vbo)
+		glDeleteBuffers(1, &m_vbo);
+	VRMemoryTracker::getInstance()->release(memoryCategory(), m_cpuBytes, m_gpuBytes);
+}
 
+void VRGraph::countMemory(long long gpuBytes)
+{
+	long long cpuBytes = m_data.capacity() * sizeof(double);
+	for (size_t l = 0; l < m_pyramid.size(); l++)
+		cpuBytes += m_pyramid[l].capacity() * sizeof(Bucket);
+	VRMemoryTracker::getInstance()->allocate(memoryCategory(), cpuBytes - m_cpuBytes, gpuBytes - m_gpuBytes);
+	m_cpuBytes = cpuBytes;
+	m_gpuBytes = gpuBytes;
 }
 
 void VRGraph::addToMenu(VRMenu * menu, double x, double y, double width, double height)
@@ -34,50 +61,59 @@ void VRGraph::draw()
 	glVertex3f(m_x, m_y + m_height, Z_OFFSET);					// Top Left
 	glEnd();
 
-	glColor3f(0.0f, 0.0, 0.0f);
-	glBegin(GL_LINE_STRIP);
-	for (int i = 0; i < m_data.size(); i++){
-		if (m_data[i] != GRAPHUNDEFINEDVALUE && m_data[i] != GRAPHSKIPDVALUE){
-			glVertex3f(m_x + m_spacing[0] * i, m_y + (m_data[i] - m_range[0]) * m_spacing[1], Z_OFFSET);
-		}
-		else if (m_data[i] == GRAPHSKIPDVALUE)
+	if (m_verticesDirty)
+		buildVertices();
+
+	if (m_strips.size() > 1)
+	{
+		glColor3f(0.0f, 0.0, 0.0f);
+		glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+		glEnableClientState(GL_VERTEX_ARRAY);
+		glVertexPointer(3, GL_FLOAT, 0, 0);
+		for (int i = 0; i + 1 < m_strips.size(); i++)
 		{
-			glEnd();
-			glBegin(GL_LINE_STRIP);
+			glDrawArrays(GL_LINE_STRIP, m_strips[i], m_strips[i + 1] - m_strips[i]);
 		}
+		glDisableClientState(GL_VERTEX_ARRAY);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
 	}
-	glEnd();
 
-	if (m_current >= 0 && m_current < m_data.size())
+	if (m_selection >= m_first && m_selection < m_last)
 	{
-		glColor3f(0.9f, 0.0, 0.0f);
+		glColor3f(0.0f, 0.9, 0.0f);
 		glBegin(GL_LINE_STRIP);
-		glVertex3f(m_x + m_spacing[0] * m_current, m_y , Z_OFFSET);
-		glVertex3f(m_x + m_spacing[0] * m_current, m_y + (m_range[1] - m_range[0]) * m_spacing[1], Z_OFFSET);
+		glVertex3f(m_x + m_spacing[0] * (m_selection - m_first), m_y, Z_OFFSET);
+		glVertex3f(m_x + m_spacing[0] * (m_selection - m_first), m_y + (m_range[1] - m_range[0]) * m_spacing[1], Z_OFFSET);
 		glEnd();
 	}
+}
 
-	if (m_selection >= 0 && m_selection < m_data.size())
+void VRGraph::drawOverlay()
+{
+	//the playhead moves every frame during playback
+	if (m_current >= m_first && m_current < m_last)
 	{
-		glColor3f(0.0f, 0.9, 0.0f);
+		glColor3f(0.9f, 0.0, 0.0f);
 		glBegin(GL_LINE_STRIP);
-		glVertex3f(m_x + m_spacing[0] * m_selection, m_y, Z_OFFSET);
-		glVertex3f(m_x + m_spacing[0] * m_selection, m_y + (m_range[1] - m_range[0]) * m_spacing[1], Z_OFFSET);
+		glVertex3f(m_x + m_spacing[0] * (m_current - m_first), m_y, Z_OFFSET);
+		glVertex3f(m_x + m_spacing[0] * (m_current - m_first), m_y + (m_range[1] - m_range[0]) * m_spacing[1], Z_OFFSET);
 		glEnd();
 	}
 }
 
 bool VRGraph::checkIntersect(MinVR::VRPoint3& pt)
 {
-	if (VRMenuElement::checkIntersect(pt))
+	int selection = -1;
+	bool intersect = VRMenuElement::checkIntersect(pt);
+	if (intersect)
+		selection = clampSelection(m_first + (pt.x - m_x) / m_spacing[0] + 0.5);
+
+	if (selection != m_selection)
 	{
-		m_selection = (pt.x - m_x) / m_spacing[0] + 0.5;
-		if(m_selection < 0) m_selection = 0;
-		if (m_selection >= m_data.size()) m_selection = m_data.size() - 1;
-		return true;
+		m_selection = selection;
+		markDirty();
 	}
-	m_selection = -1;
-	return false;
+	return intersect;
 }
 
 void VRGraph::click(double x, double y, bool isDown)
@@ -97,17 +133,26 @@ void VRGraph::updateMousePosition(double x, double y)
 {
 	if (m_mouseDown)
 	{
-		m_selection = (x - m_x) / m_spacing[0] + 0.5;
-		if (m_selection < 0) m_selection = 0;
-		if (m_selection >= m_data.size()) m_selection = m_data.size() - 1;
+		int selection = clampSelection(m_first + (x - m_x) / m_spacing[0] + 0.5);
+		if (selection != m_selection)
+		{
+			m_selection = selection;
+			markDirty();
+		}
 		m_menu->sendEvent(this);
 	}
 }
 
-void VRGraph::setData(std::vector<double> data)
+void VRGraph::setData(const std::vector<double> &data)
 {
 	m_data = data;
-	computeBounds();
+	resetViewRange();
+}
+
+void VRGraph::setData(std::vector<double> &&data)
+{
+	m_data.swap(data);
+	resetViewRange();
 }
 
 void VRGraph::setCurrent(int current)
@@ -120,24 +165,178 @@ int VRGraph::getSelection()
 	return m_selection;
 }
 
+void VRGraph::setViewRange(int first, int last)
+{
+	if (first < 0) first = 0;
+	if (last > m_data.size()) last = m_data.size();
+	if (last <= first)
+		return;
+
+	m_first = first;
+	m_last = last;
+	computeBounds();
+}
+
+void VRGraph::resetViewRange()
+{
+	m_first = 0;
+	m_last = m_data.size();
+	buildPyramid();
+	computeBounds();
+	countMemory(m_gpuBytes);
+}
+
+void VRGraph::buildPyramid()
+{
+	m_pyramid.clear();
+	if (m_data.size() <= 1)
+		return;
+
+	//level 1 combines two samples, every further level halves the previous one
+	int size = m_data.size();
+	while (size > 1)
+	{
+		int level = m_pyramid.size() + 1;
+		size = (size + 1) / 2;
+		m_pyramid.push_back(std::vector<Bucket>(size));
+		std::vector<Bucket> &buckets = m_pyramid.back();
+		int childSize = (level == 1) ? m_data.size() : m_pyramid[level - 2].size();
+
+		for (int i = 0; i < size; i++)
+		{
+			Bucket b = getBucket(level - 1, 2 * i);
+			if (2 * i + 1 < childSize)
+			{
+				Bucket b2 = getBucket(level - 1, 2 * i + 1);
+				if (!b.valid) {
+					b.min = b2.min;
+					b.max = b2.max;
+				}
+				else if (b2.valid){
+					if (b2.min < b.min) b.min = b2.min;
+					if (b2.max > b.max) b.max = b2.max;
+				}
+				b.valid = b.valid || b2.valid;
+				b.gap = b.gap || b2.gap;
+			}
+			buckets[i] = b;
+		}
+	}
+}
+
+VRGraph::Bucket VRGraph::getBucket(int level, int index)
+{
+	if (level > 0)
+		return m_pyramid[level - 1][index];
+
+	Bucket b;
+	b.min = b.max = m_data[index];
+	b.valid = isValue(m_data[index]);
+	b.gap = m_data[index] == GRAPHSKIPDVALUE;
+	return b;
+}
+
 void VRGraph::computeBounds()
 {
-	double min = std::numeric_limits<double>::max();
-	double max = std::numeric_limits<double>::min();
+	m_verticesDirty = true;
+	markDirty();
 
-	if (m_data.size() <= 0)
+	if (m_last <= m_first)
 		return;
 
-	for (std::vector<double>::const_iterator it = m_data.begin(); it != m_data.end(); ++it)
+	//combine the O(log n) pyramid buckets covering [first,last)
+	double min = std::numeric_limits<double>::max();
+	double max = -std::numeric_limits<double>::max();
+	int first = m_first;
+	int last = m_last;
+	for (int level = 0; first < last; level++)
 	{
-		if (*it != GRAPHUNDEFINEDVALUE && *it != GRAPHSKIPDVALUE){
-			if (min > *it) min = *it;
-			if (max < *it) max = *it;
+		if (first & 1)
+		{
+			Bucket b = getBucket(level, first++);
+			if (b.valid && min > b.min) min = b.min;
+			if (b.valid && max < b.max) max = b.max;
+		}
+		if (last & 1)
+		{
+			Bucket b = getBucket(level, --last);
+			if (b.valid && min > b.min) min = b.min;
+			if (b.valid && max < b.max) max = b.max;
 		}
+		first >>= 1;
+		last >>= 1;
+	}
+
+	if (min > max)
+	{
+		min = 0;
+		max = 1;
 	}
 	m_range[0] = min;
-	m_range[1] = max;
+	m_range[1] = (max > min) ? max : min + 1;
 
-	m_spacing[0] = m_width / m_data.size();
+	m_spacing[0] = m_width / (m_last - m_first);
 	m_spacing[1] = m_height / (m_range[1] - m_range[0]);
 }
+
+void VRGraph::buildVertices()
+{
+	m_verticesDirty = false;
+	m_strips.clear();
+
+	if (m_last <= m_first)
+		return;
+
+	//select the coarsest level which still has at most GRAPHMAXSAMPLES buckets in the range
+	int level = 0;
+	while (level < m_pyramid.size() && ((m_last - m_first) >> level) > GRAPHMAXSAMPLES)
+		level++;
+
+	int first = m_first >> level;
+	int last = ((m_last - 1) >> level) + 1;
+	double bucketWidth = m_spacing[0] * (1 << level);
+
+	std::vector<float> vertices;
+	m_strips.push_back(0);
+	for (int i = first; i < last; i++)
+	{
+		Bucket b = getBucket(level, i);
+		double x = m_x + bucketWidth * (i + 0.5) - m_spacing[0] * (m_first + 0.5);
+		if (x < m_x) x = m_x;
+		if (x > m_x + m_width) x = m_x + m_width;
+
+		if (b.valid){
+			vertices.push_back(x);
+			vertices.push_back(m_y + (b.min - m_range[0]) * m_spacing[1]);
+			vertices.push_back(Z_OFFSET);
+			if (b.max != b.min){
+				vertices.push_back(x);
+				vertices.push_back(m_y + (b.max - m_range[0]) * m_spacing[1]);
+				vertices.push_back(Z_OFFSET);
+			}
+		}
+		if (b.gap && m_strips.back() != vertices.size() / 3)
+		{
+			m_strips.push_back(vertices.size() / 3);
+		}
+	}
+	if (m_strips.back() != vertices.size() / 3)
+		m_strips.push_back(vertices.size() / 3);
+
+	if (m_strips.size() <= 1)
+		return;
+
+	if (!m_vbo)
+		glGenBuffers(1, &m_vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), &vertices[0], GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	countMemory(vertices.size() * sizeof(float));
+}
+
+int VRGraph::clampSelection(int selection)
+{
+	if (selection < m_first) selection = m_first;
+	if (selection >= m_last) selection = m_last - 1;
+	return selection;
+}
@@ -6,31 +6,63 @@
 
 #define GRAPHUNDEFINEDVALUE -999999999
 #define GRAPHSKIPDVALUE -9999999999
+//maximum number of samples drawn over the width of a graph. Longer ranges are drawn from the min/max pyramid
+#define GRAPHMAXSAMPLES 512
 
 class VRGraph : public VRMenuElement {
 public:
-	VRGraph(std::string name, std::vector<double> data);
+	VRGraph(std::string name, const std::vector<double> &data);
 	virtual ~VRGraph();
 
 	virtual void addToMenu(VRMenu * menu, double x, double y, double width, double height);
 	virtual void draw();
+	virtual void drawOverlay();
 	virtual bool checkIntersect(MinVR::VRPoint3 &pt);
 	virtual void click(double x, double y, bool isDown);
 	virtual void updateMousePosition(double x, double y);
 
-	void setData(std::vector<double> data);
+	void setData(const std::vector<double> &data);
+	void setData(std::vector<double> &&data);
 	void setCurrent(int current);
 	int getSelection();
 
+	//restricts the displayed range to the samples [first,last)
+	void setViewRange(int first, int last);
+	void resetViewRange();
+
 private:
+	struct Bucket
+	{
+		float min;
+		float max;
+		bool valid;		//bucket contains at least one value
+		bool gap;		//bucket contains a GRAPHSKIPDVALUE
+	};
+
 	std::vector <double> m_data;
+	std::vector <std::vector<Bucket> > m_pyramid;
 	double m_spacing[2];
 	double m_range[2];
+	int m_first, m_last;
 	int m_current;
 	int m_selection;
 	bool m_mouseDown;
 
+	unsigned int m_vbo;
+	std::vector<int> m_strips;
+	bool m_verticesDirty;
+
+	//bytes counted in the Graphs category of the VRMemoryTracker
+	long long m_cpuBytes;
+	long long m_gpuBytes;
+	//counts the data, the pyramid and a vertex buffer of gpuBytes
+	void countMemory(long long gpuBytes);
+
+	void buildPyramid();
+	Bucket getBucket(int level, int index);
 	void computeBounds();
+	void buildVertices();
+	int clampSelection(int selection);
 };
 
 #endif //VRGRAPH_H
\ No newline at end of file
@@ -0,0 +1,155 @@
+#include "VRMemoryTracker.h"
+#include <fstream>
+#include <cstdio>
+
+VRMemoryTracker::VRMemoryTracker()
+{
+	for (int i = 0; i <= MEMORY_CATEGORIES; i++)
+	{
+		m_cpu[i] = 0;
+		m_gpu[i] = 0;
+		m_cpuPeak[i] = 0;
+		m_gpuPeak[i] = 0;
+	}
+}
+
+VRMemoryTracker::~VRMemoryTracker()
+{
+
+}
+
+VRMemoryTracker* VRMemoryTracker::getInstance()
+{
+	//owners on loading threads may be the first to count
+	static VRMemoryTracker instance;
+	return &instance;
+}
+
+int VRMemoryTracker::addCategory(const std::string &name)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (size_t i = 0; i < m_names.size(); i++)
+	{
+		if (m_names[i] == name)
+			return i;
+	}
+	//further categories are counted in the last one
+	if (m_names.size() == MEMORY_CATEGORIES)
+		return MEMORY_CATEGORIES - 1;
+	m_names.push_back(name);
+	return m_names.size() - 1;
+}
+
+void VRMemoryTracker::add(std::atomic<long long> &value, std::atomic<long long> &peak, long long bytes)
+{
+	long long current = (value += bytes);
+	long long previous = peak;
+	while (current > previous && !peak.compare_exchange_weak(previous, current))
+	{
+	}
+}
+
+void VRMemoryTracker::allocate(int category, long long cpuBytes, long long gpuBytes)
+{
+	if (cpuBytes != 0)
+	{
+		add(m_cpu[category], m_cpuPeak[category], cpuBytes);
+		add(m_cpu[MEMORY_CATEGORIES], m_cpuPeak[MEMORY_CATEGORIES], cpuBytes);
+	}
+	if (gpuBytes != 0)
+	{
+		add(m_gpu[category], m_gpuPeak[category], gpuBytes);
+		add(m_gpu[MEMORY_CATEGORIES], m_gpuPeak[MEMORY_CATEGORIES], gpuBytes);
+	}
+}
+
+void VRMemoryTracker::release(int category, long long cpuBytes, long long gpuBytes)
+{
+	allocate(category, -cpuBytes, -gpuBytes);
+}
+
+int VRMemoryTracker::getNumCategories()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_names.size();
+}
+
+VRMemoryTracker::Usage VRMemoryTracker::getUsage(int category)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	Usage usage = { m_names[category], m_cpu[category], m_gpu[category] };
+	return usage;
+}
+
+VRMemoryTracker::Usage VRMemoryTracker::getPeak(int category)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	Usage usage = { m_names[category], m_cpuPeak[category], m_gpuPeak[category] };
+	return usage;
+}
+
+VRMemoryTracker::Usage VRMemoryTracker::getTotal()
+{
+	Usage usage = { "Total", m_cpu[MEMORY_CATEGORIES], m_gpu[MEMORY_CATEGORIES] };
+	return usage;
+}
+
+VRMemoryTracker::Usage VRMemoryTracker::getTotalPeak()
+{
+	Usage usage = { "Total", m_cpuPeak[MEMORY_CATEGORIES], m_gpuPeak[MEMORY_CATEGORIES] };
+	return usage;
+}
+
+std::string VRMemoryTracker::formatBytes(long long bytes)
+{
+	char buf[32];
+	if (bytes < 0)
+		return "-" + formatBytes(-bytes);
+	if (bytes < 1024)
+		std::snprintf(buf, sizeof(buf), "%lld B", bytes);
+	else if (bytes < 1024 * 1024)
+		std::snprintf(buf, sizeof(buf), "%.1f KB", bytes / 1024.0);
+	else if (bytes < 1024LL * 1024 * 1024)
+		std::snprintf(buf, sizeof(buf), "%.1f MB", bytes / (1024.0 * 1024.0));
+	else
+		std::snprintf(buf, sizeof(buf), "%.2f GB", bytes / (1024.0 * 1024.0 * 1024.0));
+	return buf;
+}
+
+std::vector<std::string> VRMemoryTracker::getReport(const std::vector<Usage> &owners)
+{
+	std::vector<std::string> report;
+	report.push_back("CPU / GPU (peak CPU / GPU)");
+	int count = getNumCategories();
+	for (int i = 0; i <= count; i++)
+	{
+		Usage usage = (i < count) ? getUsage(i) : getTotal();
+		Usage peak = (i < count) ? getPeak(i) : getTotalPeak();
+		report.push_back(usage.name + ": " + formatBytes(usage.cpuBytes) + " / " + formatBytes(usage.gpuBytes) +
+			" (" + formatBytes(peak.cpuBytes) + " / " + formatBytes(peak.gpuBytes) + ")");
+	}
+	for (size_t i = 0; i < owners.size(); i++)
+		report.push_back(owners[i].name + ": " + formatBytes(owners[i].cpuBytes) + " / " + formatBytes(owners[i].gpuBytes));
+	return report;
+}
+
+bool VRMemoryTracker::dumpCSV(const std::string &filename, const std::vector<Usage> &owners)
+{
+	std::ofstream out(filename.c_str());
+	if (!out.is_open())
+		return false;
+
+	out << "kind,name,cpu_bytes,gpu_bytes,peak_cpu_bytes,peak_gpu_bytes" << std::endl;
+	int count = getNumCategories();
+	for (int i = 0; i <= count; i++)
+	{
+		Usage usage = (i < count) ? getUsage(i) : getTotal();
+		Usage peak = (i < count) ? getPeak(i) : getTotalPeak();
+		out << ((i < count) ? "category," : "total,") << usage.name << "," << usage.cpuBytes << "," << usage.gpuBytes << ","
+			<< peak.cpuBytes << "," << peak.gpuBytes << std::endl;
+	}
+	//owners have no peaks
+	for (size_t i = 0; i < owners.size(); i++)
+		out << "owner," << owners[i].name << "," << owners[i].cpuBytes << "," << owners[i].gpuBytes << ",," << std::endl;
+	return true;
+}
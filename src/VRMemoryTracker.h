@@ -0,0 +1,59 @@
+#ifndef VRMEMORYTRACKER_H
+#define VRMEMORYTRACKER_H
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <mutex>
+
+//maximum number of categories
+#define MEMORY_CATEGORIES 16
+
+//Counts the CPU and GPU bytes held per named category, e.g. per subsystem, together with their
+//peaks. Owners add their allocations and release them again, from any thread. GPU bytes are the
+//sizes of the textures, buffers and display lists as uploaded, not what the driver allocates.
+class VRMemoryTracker
+{
+public:
+	struct Usage
+	{
+		std::string name;
+		long long cpuBytes;
+		long long gpuBytes;
+	};
+
+	virtual ~VRMemoryTracker();
+	static VRMemoryTracker* getInstance();
+
+	//returns the id of the category with the name and adds it if there is none. Categories
+	//are reported in the order they are added
+	int addCategory(const std::string &name);
+
+	void allocate(int category, long long cpuBytes, long long gpuBytes = 0);
+	void release(int category, long long cpuBytes, long long gpuBytes = 0);
+
+	int getNumCategories();
+	Usage getUsage(int category);
+	Usage getPeak(int category);
+	//over all categories
+	Usage getTotal();
+	Usage getTotalPeak();
+
+	//the categories and the total, followed by the owners, e.g. the objects of a scene
+	std::vector<std::string> getReport(const std::vector<Usage> &owners = std::vector<Usage>());
+	bool dumpCSV(const std::string &filename, const std::vector<Usage> &owners = std::vector<Usage>());
+	static std::string formatBytes(long long bytes);
+
+private:
+	VRMemoryTracker();
+	static void add(std::atomic<long long> &value, std::atomic<long long> &peak, long long bytes);
+
+	std::mutex m_mutex;
+	std::vector<std::string> m_names;
+	std::atomic<long long> m_cpu[MEMORY_CATEGORIES + 1];	//the last entry is the total
+	std::atomic<long long> m_gpu[MEMORY_CATEGORIES + 1];
+	std::atomic<long long> m_cpuPeak[MEMORY_CATEGORIES + 1];
+	std::atomic<long long> m_gpuPeak[MEMORY_CATEGORIES + 1];
+};
+
+#endif //VRMEMORYTRACKER_H
@@ -1,17 +1,33 @@
 #ifdef _WIN32
 #include <windows.h>
 #endif
-#include <GL/gl.h>
+#include <GL/glew.h>
 #include <math.h>
 #include "VRMenu.h"
 #include "VRFontHandler.h"
 #include "VRMenuElement.h"
 #include "VRMenuHandler.h"
+#include "VRMemoryTracker.h"
 
 #define BORDER 0.002
+//texture pixels per meter of menu
+#define MENU_TEXTURE_RESOLUTION 1024
 
-VRMenu::VRMenu(double width, double height, int col, int row, std::string title, double titleHeight) :m_width(width), m_height(height), m_col(col), m_row(row),
-m_hover(false), m_title(title), m_titleHeight(titleHeight), m_activeElement(NULL), m_isMouseDown(false)
+//bytes of the RGBA texture with its mipmaps
+static long long textureBytes(int width, int height)
+{
+	return (long long)width * height * 4 * 4 / 3;
+}
+
+static int memoryCategory()
+{
+	static int category = VRMemoryTracker::getInstance()->addCategory("Menus");
+	return category;
+}
+
+VRMenu::VRMenu(double width, double height, int col, int row, std::string title, double titleHeight) :m_col(col), m_row(row), m_width(width), m_height(height),
+m_title(title), m_titleHeight(titleHeight), m_visible(false), m_hover(false), m_hoverElement(NULL),
+m_fbo(0), m_texture(0), m_textureWidth(0), m_textureHeight(0), m_dirty(true), m_activeElement(NULL), m_isMouseDown(false)
 {
 	m_col_width = width/col;
 	m_row_height = height / row;	
@@ -27,101 +43,256 @@ VRMenu::~VRMenu()
 	m_elements.clear();
 
 	m_handlers.clear();
+
+	if (m_fbo)
+		glDeleteFramebuffers(1, &m_fbo);
+	if (m_texture)
+	{
+		glDeleteTextures(1, &m_texture);
+		VRMemoryTracker::getInstance()->release(memoryCategory(), 0, textureBytes(m_textureWidth, m_textureHeight));
+	}
 }
 
 void VRMenu::draw()
 {
 	if (m_visible)
 	{
+		updateTexture();
+
 		GLint depth_funct;
 		glGetIntegerv(GL_DEPTH_FUNC, &depth_funct);
 		glDepthFunc(GL_LEQUAL);
 		glPushMatrix();
 		glMultMatrixf(m_transformation.getArray());
 
-		glBegin(GL_QUADS);			
-			// Draw A Quad		
-			if (m_hover)
-			{
-				glColor3f(1.0f, 1.0f, 1.0f);
-			}
-			else
-			{
-				glColor3f(1.0f, 1.0f, 1.0f);
-			}	
+		if (m_texture)
+		{
+			glPushAttrib(GL_ENABLE_BIT | GL_TEXTURE_BIT);
+			glEnable(GL_TEXTURE_2D);
+			glBindTexture(GL_TEXTURE_2D, m_texture);
+			glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
+			glBegin(GL_QUADS);
+			glTexCoord2f(0.0f, 1.0f);
 			glVertex3f(-m_width*0.5, m_height + m_titleHeight, 0.0f);              // Top Left
+			glTexCoord2f(1.0f, 1.0f);
 			glVertex3f(m_width*0.5, m_height + m_titleHeight, 0.0f);				// Top Right
+			glTexCoord2f(1.0f, 0.0f);
 			glVertex3f(m_width*0.5, 0.0f, 0.0f);					// Bottom Right
+			glTexCoord2f(0.0f, 0.0f);
 			glVertex3f(-m_width*0.5, 0.0f, 0.0f);              // Bottom Left
-		glEnd();
-
-		glColor3f(0.0f, 0.0, 0.0f);
-		glBegin(GL_LINE_STRIP);
-		// Draw A Quad
-		glVertex3f(-m_width*0.5, m_height + m_titleHeight, Z_OFFSET);              // Top Left
-		glVertex3f(m_width*0.5, m_height + m_titleHeight, Z_OFFSET);				// Top Right
-		glVertex3f(m_width*0.5, 0.0f, 0.001f);					// Bottom Right
-		glVertex3f(-m_width*0.5, 0.0f, 0.001f);              // Bottom Left
-		glVertex3f(-m_width*0.5, m_height + m_titleHeight, Z_OFFSET);              // Top Left
-		glEnd();
-
-		glColor3f(0.0f, 0.0, 0.0f);
-		glBegin(GL_LINES);
-		// Draw A Quad
-		glVertex3f(-m_width*0.5, m_height, Z_OFFSET);              // Top Left
-		glVertex3f(m_width*0.5, m_height, Z_OFFSET);				// Top Right
-		glEnd();
-
-		if (!m_title.empty())
-			VRFontHandler::getInstance()->renderTextBox(m_title, -m_width*0.5 + BORDER, m_height + BORDER, Z_OFFSET, m_width - 2.0 * BORDER, m_titleHeight - 2.0 * BORDER);
-
-		for (std::vector<VRMenuElement*>::const_iterator it = m_elements.begin(); it != m_elements.end(); ++it)
+			glEnd();
+			glPopAttrib();
+		}
+		else
 		{
-			(*it)->draw();
+			//no framebuffer objects available, draw the elements directly
+			drawContents();
 		}
+		drawOverlays();
+
 		glPopMatrix();
 		glDepthFunc(depth_funct);
 	}
 }
 
-VRMenuElement* VRMenu::intersect(MinVR::VRPoint3& position, MinVR::VRVector3& direction, double &distance)
+void VRMenu::updateTexture()
 {
-	if (m_visible)
-	{
-		m_hover = false;
-		for (std::vector<VRMenuElement*>::const_iterator it = m_elements.begin(); it != m_elements.end(); ++it)
-		{
-			(*it)->resetHover();
-		}
+	if (!m_visible || !m_dirty)
+		return;
+
+	if (!m_texture && !createTexture())
+		return;
+
+	m_dirty = false;
+
+	GLint drawFramebuffer, readFramebuffer;
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &drawFramebuffer);
+	glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &readFramebuffer);
+	glPushAttrib(GL_ENABLE_BIT | GL_VIEWPORT_BIT | GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_CURRENT_BIT);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+	glViewport(0, 0, m_textureWidth, m_textureHeight);
+	glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT);
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_LIGHTING);
+	glDisable(GL_CULL_FACE);
+
+	glMatrixMode(GL_PROJECTION);
+	glPushMatrix();
+	glLoadIdentity();
+	glOrtho(-m_width * 0.5, m_width * 0.5, 0.0, m_height + m_titleHeight, -1.0, 1.0);
+	glMatrixMode(GL_MODELVIEW);
+	glPushMatrix();
+	glLoadIdentity();
+
+	//without depth test the elements are layered in drawing order
+	drawContents();
+
+	glPopMatrix();
+	glMatrixMode(GL_PROJECTION);
+	glPopMatrix();
+	glMatrixMode(GL_MODELVIEW);
 
-		MinVR::VRPoint3 pt = m_transformation.inverse() * position;
-		MinVR::VRVector3 dir = m_transformation.inverse() * direction;
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, drawFramebuffer);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, readFramebuffer);
+	glPopAttrib();
 
-		distance = - pt.z / dir.z; 
-		m_interactionPoint = pt + dir * distance;
-		if (m_isMouseDown && m_activeElement)
+	glBindTexture(GL_TEXTURE_2D, m_texture);
+	glGenerateMipmap(GL_TEXTURE_2D);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void VRMenu::setDirty()
+{
+	m_dirty = true;
+}
+
+void VRMenu::drawContents()
+{
+	glBegin(GL_QUADS);			
+		// Draw A Quad		
+		if (m_hover)
 		{
-			//when mouse down we do not change the active element
-			m_activeElement->updateMousePosition(m_interactionPoint.x, m_interactionPoint.y);
-			return m_activeElement;
+			glColor3f(1.0f, 1.0f, 1.0f);
 		}
-		else{
-			if (distance > 0 && distance < 1.0 && fabs(m_interactionPoint.x) <= m_width * 0.5 && m_interactionPoint.y >= 0 && m_interactionPoint.y <= m_height + m_titleHeight){
-				for (std::vector<VRMenuElement*>::const_iterator it = m_elements.begin(); it != m_elements.end(); ++it)
+		else
+		{
+			glColor3f(1.0f, 1.0f, 1.0f);
+		}	
+		glVertex3f(-m_width*0.5, m_height + m_titleHeight, 0.0f);              // Top Left
+		glVertex3f(m_width*0.5, m_height + m_titleHeight, 0.0f);				// Top Right
+		glVertex3f(m_width*0.5, 0.0f, 0.0f);					// Bottom Right
+		glVertex3f(-m_width*0.5, 0.0f, 0.0f);              // Bottom Left
+	glEnd();
+
+	glColor3f(0.0f, 0.0, 0.0f);
+	glBegin(GL_LINE_STRIP);
+	// Draw A Quad
+	glVertex3f(-m_width*0.5, m_height + m_titleHeight, Z_OFFSET);              // Top Left
+	glVertex3f(m_width*0.5, m_height + m_titleHeight, Z_OFFSET);				// Top Right
+	glVertex3f(m_width*0.5, 0.0f, 0.001f);					// Bottom Right
+	glVertex3f(-m_width*0.5, 0.0f, 0.001f);              // Bottom Left
+	glVertex3f(-m_width*0.5, m_height + m_titleHeight, Z_OFFSET);              // Top Left
+	glEnd();
+
+	glColor3f(0.0f, 0.0, 0.0f);
+	glBegin(GL_LINES);
+	// Draw A Quad
+	glVertex3f(-m_width*0.5, m_height, Z_OFFSET);              // Top Left
+	glVertex3f(m_width*0.5, m_height, Z_OFFSET);				// Top Right
+	glEnd();
+
+	//all text of the menu is drawn in one batch after the elements
+	VRFontHandler::getInstance()->beginBatch();
+	if (!m_title.empty())
+		VRFontHandler::getInstance()->renderTextBox(m_titleLayout, m_title, -m_width*0.5 + BORDER, m_height + BORDER, Z_OFFSET, m_width - 2.0 * BORDER, m_titleHeight - 2.0 * BORDER);
+
+	for (std::vector<VRMenuElement*>::const_iterator it = m_elements.begin(); it != m_elements.end(); ++it)
+	{
+		(*it)->draw();
+	}
+	glColor3f(0.0f, 0.0, 0.0f);
+	VRFontHandler::getInstance()->endBatch();
+}
+
+void VRMenu::drawOverlays()
+{
+	VRFontHandler::getInstance()->beginBatch();
+	for (std::vector<VRMenuElement*>::const_iterator it = m_elements.begin(); it != m_elements.end(); ++it)
+	{
+		(*it)->drawOverlay();
+	}
+	glColor3f(0.0f, 0.0, 0.0f);
+	VRFontHandler::getInstance()->endBatch();
+}
+
+bool VRMenu::createTexture()
+{
+	if (!GLEW_VERSION_3_0 && !GLEW_ARB_framebuffer_object)
+		return false;
+
+	m_textureWidth = m_width * MENU_TEXTURE_RESOLUTION;
+	m_textureHeight = (m_height + m_titleHeight) * MENU_TEXTURE_RESOLUTION;
+
+	glGenTextures(1, &m_texture);
+	glBindTexture(GL_TEXTURE_2D, m_texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, m_textureWidth, m_textureHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	GLint drawFramebuffer;
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &drawFramebuffer);
+	glGenFramebuffers(1, &m_fbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_texture, 0);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindFramebuffer(GL_FRAMEBUFFER, drawFramebuffer);
+
+	if (status != GL_FRAMEBUFFER_COMPLETE)
+	{
+		glDeleteFramebuffers(1, &m_fbo);
+		glDeleteTextures(1, &m_texture);
+		m_fbo = 0;
+		m_texture = 0;
+		return false;
+	}
+	VRMemoryTracker::getInstance()->allocate(memoryCategory(), 0, textureBytes(m_textureWidth, m_textureHeight));
+	return true;
+}
+
+VRMenuElement* VRMenu::intersect(MinVR::VRPoint3& position, MinVR::VRVector3& direction, double &distance)
+{
+	if (!m_visible)
+		return NULL;
+
+	VRMenuElement * hovered = NULL;
+	VRMenuElement * result = NULL;
+
+	m_hover = false;
+	for (std::vector<VRMenuElement*>::const_iterator it = m_elements.begin(); it != m_elements.end(); ++it)
+	{
+		(*it)->resetHover();
+	}
+
+	MinVR::VRPoint3 pt = m_inverseTransformation * position;
+	MinVR::VRVector3 dir = m_inverseTransformation * direction;
+
+	distance = - pt.z / dir.z; 
+	m_interactionPoint = pt + dir * distance;
+	if (m_isMouseDown && m_activeElement)
+	{
+		//when mouse down we do not change the active element
+		m_activeElement->updateMousePosition(m_interactionPoint.x, m_interactionPoint.y);
+		result = m_activeElement;
+	}
+	else{
+		if (distance > 0 && distance < 1.0 && fabs(m_interactionPoint.x) <= m_width * 0.5 && m_interactionPoint.y >= 0 && m_interactionPoint.y <= m_height + m_titleHeight){
+			for (std::vector<VRMenuElement*>::const_iterator it = m_elements.begin(); it != m_elements.end(); ++it)
+			{
+				if ((*it)->checkIntersect(m_interactionPoint))
 				{
-					if ((*it)->checkIntersect(m_interactionPoint))
-					{
-						m_activeElement = *it;
-						return (*it);
-					}
+					hovered = *it;
+					break;
 				}
-				m_hover = true;
 			}
+			m_hover = (hovered == NULL);
 		}
+		result = hovered;
 	}
 
-	m_activeElement = NULL;
-	return NULL;
+	//only a change of the hovered element requires the menu texture to be updated
+	if (hovered != m_hoverElement)
+	{
+		m_hoverElement = hovered;
+		setDirty();
+	}
+
+	m_activeElement = result;
+	return result;
 }
 
 bool VRMenu::click(bool isDown)
@@ -154,10 +325,13 @@ void VRMenu::addElement(VRMenuElement* element, int col, int row, int width, int
 void VRMenu::setTransformation(MinVR::VRMatrix4& transformation)
 {
 	m_transformation = transformation;
+	m_inverseTransformation = transformation.inverse();
 }
 
 void VRMenu::setVisible(bool visible)
 {
+	if (visible && !m_visible)
+		setDirty();
 	m_visible = visible;
 	if (!visible){
 		if (m_isMouseDown){
@@ -166,9 +340,22 @@ void VRMenu::setVisible(bool visible)
 			m_isMouseDown = false;
 		}
 		m_activeElement = NULL;
+
+		//hidden menus are not intersected, so the hover state is cleared here
+		m_hover = false;
+		m_hoverElement = NULL;
+		for (std::vector<VRMenuElement*>::const_iterator it = m_elements.begin(); it != m_elements.end(); ++it)
+		{
+			(*it)->resetHover();
+		}
 	}
 }
 
+bool VRMenu::isVisible()
+{
+	return m_visible;
+}
+
 void VRMenu::sendEvent(VRMenuElement* element)
 {
 	for (std::vector<VRMenuHandler*>::const_iterator it = m_handlers.begin(); it != m_handlers.end(); ++it)
@@ -2,6 +2,7 @@
 #define VRMENU_H
 
 #include <math/VRMath.h>
+#include "VRFontHandler.h"
 
 class VRMenuElement;
 class VRMenuHandler;
@@ -12,6 +13,9 @@ public:
 	~VRMenu();
 
 	void draw();
+	//re-renders the menu texture if an element changed since the last update
+	void updateTexture();
+	void setDirty();
 	VRMenuElement * intersect(MinVR::VRPoint3& position, MinVR::VRVector3& direction, double &distance);
 	bool click(bool isDown);
 	void updateIteration();
@@ -19,6 +23,7 @@ public:
 	void addElement(VRMenuElement * element, int col, int row, int width, int height);
 	void setTransformation(MinVR::VRMatrix4& transformation);
 	void setVisible(bool visible);
+	bool isVisible();
 	void sendEvent(VRMenuElement * element);
 	void addMenuHandler(VRMenuHandler * handler);
 
@@ -31,10 +36,23 @@ private:
 	
 	std::string m_title;
 	double m_titleHeight;
+	VRFontHandler::TextLayout m_titleLayout;
 
 	bool m_visible;
 	bool m_hover;
+	VRMenuElement * m_hoverElement;
 	MinVR::VRMatrix4 m_transformation;
+	MinVR::VRMatrix4 m_inverseTransformation;
+
+	unsigned int m_fbo;
+	unsigned int m_texture;
+	int m_textureWidth, m_textureHeight;
+	bool m_dirty;
+
+	void drawContents();
+	//parts of the elements which change every frame, drawn over the texture instead of into it
+	void drawOverlays();
+	bool createTexture();
 
 	std::vector<VRMenuElement *> m_elements;
 	std::vector<VRMenuHandler *> m_handlers;
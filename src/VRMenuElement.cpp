@@ -2,7 +2,7 @@
 
 
 
-VRMenuElement::VRMenuElement(std::string name, std::string text) : m_hover(false), m_x(0), m_y(0), m_width(0), m_height(0), m_name(name), m_text(text){
+VRMenuElement::VRMenuElement(std::string name, std::string text) : m_hover(false), m_x(0), m_y(0), m_width(0), m_height(0), m_name(name), m_text(text), m_menu(NULL){
 
 }
 
@@ -34,6 +34,12 @@ bool VRMenuElement::checkIntersect(MinVR::VRPoint3 &pt)
 	return false;
 }
 
+void VRMenuElement::markDirty()
+{
+	if (m_menu)
+		m_menu->setDirty();
+}
+
 std::string VRMenuElement::getName()
 {
 	return m_name;
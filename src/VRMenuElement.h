@@ -6,6 +6,7 @@
 #include <math/VRMath.h>
 
 #include "VRMenu.h"
+#include "VRFontHandler.h"
 
 	class VRMenuElement {
 	public:
@@ -13,6 +14,8 @@
 		virtual ~VRMenuElement();
 
 		virtual void draw() = 0;
+		//drawn over the menu texture every frame, for parts which change too often to render them into it
+		virtual void drawOverlay(){};
 		virtual void addToMenu(VRMenu * menu, double x, double y, double width, double height);
 		virtual void resetHover();
 		virtual void click(double x, double y, bool isDown){};
@@ -22,10 +25,14 @@
 		std::string getName();
 
 	protected:
+		//marks the menu texture as outdated after a visual change of the element
+		void markDirty();
+
 		bool m_hover;
 		double m_x, m_y, m_width, m_height;
 		std::string m_text;
 		std::string m_name;
+		VRFontHandler::TextLayout m_textLayout;
 
 		VRMenu * m_menu;
 	};
@@ -29,10 +29,12 @@ void VRMultiLineTextBox::draw()
 		glEnd();
 	}
 
-	VRFontHandler::getInstance()->renderMultiLineTextBox(m_multiLineText, m_x, m_y, Z_OFFSET, m_width, m_height, m_alignment);
+	VRFontHandler::getInstance()->renderMultiLineTextBox(m_textLayout, m_multiLineText, m_x, m_y, Z_OFFSET, m_width, m_height, m_alignment);
 }
 
 void VRMultiLineTextBox::setText(std::vector<std::string> text)
 {
 	m_multiLineText = text;
+	m_textLayout.invalidate();
+	markDirty();
 }
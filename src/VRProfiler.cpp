@@ -0,0 +1,151 @@
+#include "VRProfiler.h"
+#include <algorithm>
+#include <fstream>
+#include <cstdio>
+
+VRProfiler* VRProfiler::instance = NULL;
+
+VRProfiler::VRProfiler() : m_enabled(false), m_historyPos(0), m_historySize(0)
+{
+	addPhase("Frame");
+}
+
+VRProfiler::~VRProfiler()
+{
+
+}
+
+VRProfiler* VRProfiler::getInstance()
+{
+	if (!instance)
+		instance = new VRProfiler();
+
+	return instance;
+}
+
+int VRProfiler::addPhase(const std::string &name)
+{
+	m_names.push_back(name);
+	m_current.push_back(0.0);
+	m_history.push_back(std::vector<float>(PROFILER_HISTORY, 0.0f));
+	return m_names.size() - 1;
+}
+
+void VRProfiler::setEnabled(bool enabled)
+{
+	if (enabled && !m_enabled)
+	{
+		//start with an empty history
+		m_historyPos = 0;
+		m_historySize = 0;
+		std::fill(m_current.begin(), m_current.end(), 0.0);
+		m_frameStart = Clock::now();
+	}
+	m_enabled = enabled;
+}
+
+bool VRProfiler::isEnabled()
+{
+	return m_enabled;
+}
+
+void VRProfiler::add(int phase, Clock::duration duration)
+{
+	m_current[phase] += std::chrono::duration<double, std::milli>(duration).count();
+}
+
+void VRProfiler::endFrame()
+{
+	if (!m_enabled)
+		return;
+
+	Clock::time_point now = Clock::now();
+	m_current[0] = std::chrono::duration<double, std::milli>(now - m_frameStart).count();
+	m_frameStart = now;
+
+	for (int i = 0; i < m_current.size(); i++)
+	{
+		m_history[i][m_historyPos] = m_current[i];
+		m_current[i] = 0.0;
+	}
+	m_historyPos = (m_historyPos + 1) % PROFILER_HISTORY;
+	if (m_historySize < PROFILER_HISTORY)
+		m_historySize++;
+}
+
+int VRProfiler::getNumPhases()
+{
+	return m_names.size();
+}
+
+const std::string &VRProfiler::getPhaseName(int phase)
+{
+	return m_names[phase];
+}
+
+VRProfiler::Stats VRProfiler::getStats(int phase)
+{
+	Stats stats;
+	stats.min = stats.avg = stats.p99 = 0.0;
+	if (m_historySize == 0)
+		return stats;
+
+	std::vector<float> values(m_history[phase].begin(), m_history[phase].begin() + m_historySize);
+	double sum = 0;
+	stats.min = values[0];
+	for (int i = 0; i < values.size(); i++)
+	{
+		sum += values[i];
+		if (values[i] < stats.min) stats.min = values[i];
+	}
+	stats.avg = sum / values.size();
+
+	int index = (values.size() - 1) * 99 / 100;
+	std::nth_element(values.begin(), values.begin() + index, values.end());
+	stats.p99 = values[index];
+
+	return stats;
+}
+
+std::vector<std::string> VRProfiler::getReport()
+{
+	std::vector<std::string> report;
+	if (!m_enabled)
+	{
+		report.push_back("Profiling disabled");
+		return report;
+	}
+
+	char buf[128];
+	report.push_back("Phase: min / avg / p99 ms");
+	for (int i = 0; i < m_names.size(); i++)
+	{
+		Stats stats = getStats(i);
+		std::snprintf(buf, sizeof(buf), "%s: %.2f / %.2f / %.2f", m_names[i].c_str(), stats.min, stats.avg, stats.p99);
+		report.push_back(buf);
+	}
+	return report;
+}
+
+bool VRProfiler::dumpCSV(const std::string &filename)
+{
+	std::ofstream out(filename.c_str());
+	if (!out.is_open())
+		return false;
+
+	for (int i = 0; i < m_names.size(); i++)
+		out << ((i > 0) ? "," : "") << m_names[i];
+	out << std::endl;
+
+	//oldest frame first
+	int start = (m_historySize < PROFILER_HISTORY) ? 0 : m_historyPos;
+	for (int f = 0; f < m_historySize; f++)
+	{
+		int pos = (start + f) % PROFILER_HISTORY;
+		for (int i = 0; i < m_names.size(); i++)
+			out << ((i > 0) ? "," : "") << m_history[i][pos];
+		out << std::endl;
+	}
+
+	return true;
+}
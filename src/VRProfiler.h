@@ -0,0 +1,82 @@
+#ifndef VRPROFILER_H
+#define VRPROFILER_H
+
+#include <string>
+#include <vector>
+#include <chrono>
+
+//number of frames the statistics are computed over
+#define PROFILER_HISTORY 300
+
+//Accumulates the time spent in named phases per frame and keeps a rolling history
+//from which min/avg/p99 are computed. When disabled the timers only test a flag.
+class VRProfiler
+{
+public:
+	typedef std::chrono::steady_clock Clock;
+
+	struct Stats
+	{
+		double min;
+		double avg;
+		double p99;
+	};
+
+	//Adds the time between construction and destruction to a phase
+	class ScopedTimer
+	{
+	public:
+		ScopedTimer(int phase) : m_phase(-1)
+		{
+			if (VRProfiler::getInstance()->isEnabled())
+			{
+				m_phase = phase;
+				m_start = Clock::now();
+			}
+		}
+
+		~ScopedTimer()
+		{
+			if (m_phase >= 0)
+				VRProfiler::getInstance()->add(m_phase, Clock::now() - m_start);
+		}
+
+	private:
+		int m_phase;
+		Clock::time_point m_start;
+	};
+
+	virtual ~VRProfiler();
+	static VRProfiler* getInstance();
+
+	//registers a phase and returns its id. Phases are reported in the order they are added
+	int addPhase(const std::string &name);
+
+	void setEnabled(bool enabled);
+	bool isEnabled();
+
+	void add(int phase, Clock::duration duration);
+	//stores the accumulated times of the current frame in the history and starts a new frame
+	void endFrame();
+
+	//statistics in milliseconds over the recorded history. The first entry is the total frame time
+	Stats getStats(int phase);
+	int getNumPhases();
+	const std::string &getPhaseName(int phase);
+	std::vector<std::string> getReport();
+	bool dumpCSV(const std::string &filename);
+
+private:
+	VRProfiler();
+	static VRProfiler* instance;
+
+	bool m_enabled;
+	std::vector<std::string> m_names;
+	std::vector<double> m_current;
+	std::vector<std::vector<float> > m_history;	//per phase ring buffer of ms values
+	int m_historyPos;
+	int m_historySize;
+	Clock::time_point m_frameStart;
+};
+
+#endif //VRPROFILER_H
@@ -5,7 +5,7 @@
 
 #include "VRTextBox.h"
 
-VRTextBox::VRTextBox(std::string name, std::string text, VRFontHandler::TextAlignment alignment) : VRMenuElement(name,text), m_alignment(alignment)
+VRTextBox::VRTextBox(std::string name, std::string text, VRFontHandler::TextAlignment alignment) : VRMenuElement(name,text), m_alignment(alignment), m_overlay(false)
 {
 
 }
@@ -27,11 +27,26 @@ void VRTextBox::draw()
 	glVertex3f(m_x, m_y + m_height, Z_OFFSET);					// Top Left
 	glEnd();
 
-	if (!m_text.empty())
-		VRFontHandler::getInstance()->renderTextBox(m_text, m_x, m_y, Z_OFFSET, m_width, m_height, m_alignment);
+	if (!m_overlay && !m_text.empty())
+		VRFontHandler::getInstance()->renderTextBox(m_textLayout, m_text, m_x, m_y, Z_OFFSET, m_width, m_height, m_alignment);
+}
+
+void VRTextBox::drawOverlay()
+{
+	if (m_overlay && !m_text.empty())
+		VRFontHandler::getInstance()->renderTextBox(m_textLayout, m_text, m_x, m_y, Z_OFFSET, m_width, m_height, m_alignment);
 }
 
 void VRTextBox::setText(std::string text)
 {
 	m_text = text;
+	m_textLayout.invalidate();
+	if (!m_overlay)
+		markDirty();
+}
+
+void VRTextBox::setOverlay(bool overlay)
+{
+	m_overlay = overlay;
+	markDirty();
 }
@@ -10,11 +10,15 @@ class VRTextBox : public VRMenuElement {
 		virtual ~VRTextBox();
 
 		virtual void draw();
+		virtual void drawOverlay();
 
 		void setText(std::string text);
+		//draws the text over the menu texture, so a text changing every frame does not re-render the menu
+		void setOverlay(bool overlay);
 
 	private:
 		VRFontHandler::TextAlignment m_alignment;
+		bool m_overlay;
 	};
 
 #endif //VRVRBUTTONELEMENT_H
\ No newline at end of file
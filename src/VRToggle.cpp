@@ -48,7 +48,7 @@ void VRToggle::draw()
 	glEnd();
 
 	if (!m_text.empty())
-		VRFontHandler::getInstance()->renderTextBox(m_text, m_x, m_y, 2.0*Z_OFFSET, m_width, m_height);
+		VRFontHandler::getInstance()->renderTextBox(m_textLayout, m_text, m_x, m_y, 2.0*Z_OFFSET, m_width, m_height);
 }
 
 void VRToggle::click(double x, double y, bool isDown)
@@ -56,6 +56,7 @@ void VRToggle::click(double x, double y, bool isDown)
 	if (isDown)
 	{
 		m_isToggled = !m_isToggled;
+		markDirty();
 		m_menu->sendEvent(this);
 	}
 }
@@ -67,5 +68,7 @@ bool VRToggle::isToggled()
 
 void VRToggle::setToggled(bool isToggled)
 {
+	if (m_isToggled != isToggled)
+		markDirty();
 	m_isToggled = isToggled;
 }
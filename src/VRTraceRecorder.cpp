@@ -0,0 +1,138 @@
+#include "VRTraceRecorder.h"
+#include <fstream>
+#include <iostream>
+
+VRTraceRecorder* VRTraceRecorder::instance = NULL;
+thread_local VRTraceRecorder::ThreadBuffer* VRTraceRecorder::threadLocalBuffer = NULL;
+
+VRTraceRecorder::VRTraceRecorder() : m_recording(false)
+{
+	m_epoch = Clock::now();
+}
+
+VRTraceRecorder::~VRTraceRecorder()
+{
+	for (std::vector<ThreadBuffer*>::iterator it = m_buffers.begin(); it != m_buffers.end(); ++it)
+	{
+		delete (*it);
+	}
+	m_buffers.clear();
+}
+
+VRTraceRecorder* VRTraceRecorder::getInstance()
+{
+	if (!instance)
+		instance = new VRTraceRecorder();
+
+	return instance;
+}
+
+void VRTraceRecorder::start(double seconds, const std::string &filename)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (std::vector<ThreadBuffer*>::iterator it = m_buffers.begin(); it != m_buffers.end(); ++it)
+	{
+		std::lock_guard<std::mutex> bufferLock((*it)->mutex);
+		(*it)->count = 0;
+	}
+
+	m_filename = filename;
+	m_stopTime = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+	m_recording = true;
+	std::cerr << "Trace started for " << seconds << "s" << std::endl;
+}
+
+bool VRTraceRecorder::update()
+{
+	if (!m_recording || Clock::now() < m_stopTime)
+		return false;
+
+	m_recording = false;
+	if (write(m_filename))
+	{
+		std::cerr << "Trace written to " << m_filename << std::endl;
+		return true;
+	}
+
+	std::cerr << "Could not write " << m_filename << std::endl;
+	return false;
+}
+
+bool VRTraceRecorder::isRecording()
+{
+	return m_recording;
+}
+
+void VRTraceRecorder::setThreadName(const char * name)
+{
+	ThreadBuffer * buffer = threadBuffer();
+	std::lock_guard<std::mutex> lock(buffer->mutex);
+	buffer->name = name;
+}
+
+void VRTraceRecorder::add(const char * name, Clock::time_point start, Clock::time_point end)
+{
+	ThreadBuffer * buffer = threadBuffer();
+	std::lock_guard<std::mutex> lock(buffer->mutex);
+	if (buffer->events.empty())
+		buffer->events.resize(TRACE_BUFFER_EVENTS);
+
+	Event &event = buffer->events[buffer->count % TRACE_BUFFER_EVENTS];
+	event.name = name;
+	event.start = toMicroseconds(start);
+	event.duration = toMicroseconds(end) - event.start;
+	buffer->count++;
+}
+
+VRTraceRecorder::ThreadBuffer* VRTraceRecorder::threadBuffer()
+{
+	//buffers are owned by the recorder so they outlive the threads writing them
+	if (!threadLocalBuffer)
+	{
+		ThreadBuffer * buffer = new ThreadBuffer();
+		std::lock_guard<std::mutex> lock(m_mutex);
+		buffer->id = m_buffers.size() + 1;
+		m_buffers.push_back(buffer);
+		threadLocalBuffer = buffer;
+	}
+	return threadLocalBuffer;
+}
+
+bool VRTraceRecorder::write(const std::string &filename)
+{
+	std::ofstream out(filename.c_str());
+	if (!out.is_open())
+		return false;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	out << "{\"traceEvents\":[" << std::endl;
+	bool first = true;
+	for (std::vector<ThreadBuffer*>::iterator it = m_buffers.begin(); it != m_buffers.end(); ++it)
+	{
+		std::lock_guard<std::mutex> bufferLock((*it)->mutex);
+		if ((*it)->name)
+		{
+			out << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << (*it)->id
+				<< ",\"args\":{\"name\":\"" << (*it)->name << "\"}}";
+			first = false;
+		}
+
+		long long count = ((*it)->count < TRACE_BUFFER_EVENTS) ? (*it)->count : TRACE_BUFFER_EVENTS;
+		for (long long i = (*it)->count - count; i < (*it)->count; i++)
+		{
+			const Event &event = (*it)->events[i % TRACE_BUFFER_EVENTS];
+			out << (first ? "" : ",\n") << "{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << (*it)->id
+				<< ",\"ts\":" << event.start << ",\"dur\":" << event.duration << "}";
+			first = false;
+		}
+		(*it)->count = 0;
+	}
+	out << std::endl << "]}" << std::endl;
+
+	return true;
+}
+
+long long VRTraceRecorder::toMicroseconds(Clock::time_point time)
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(time - m_epoch).count();
+}
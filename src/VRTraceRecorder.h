@@ -0,0 +1,93 @@
+#ifndef VRTRACERECORDER_H
+#define VRTRACERECORDER_H
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+
+//number of events kept per thread, older events are overwritten
+#define TRACE_BUFFER_EVENTS 65536
+
+//Records begin/end events of named scopes from any thread into per thread ring buffers
+//and writes them as Chrome trace JSON (chrome://tracing, ui.perfetto.dev).
+class VRTraceRecorder
+{
+public:
+	typedef std::chrono::steady_clock Clock;
+
+	//Records the lifetime of the object as one event. The name has to be a string literal
+	class Scope
+	{
+	public:
+		Scope(const char * name) : m_name(NULL)
+		{
+			if (VRTraceRecorder::getInstance()->isRecording())
+			{
+				m_name = name;
+				m_start = Clock::now();
+			}
+		}
+
+		~Scope()
+		{
+			if (m_name)
+				VRTraceRecorder::getInstance()->add(m_name, m_start, Clock::now());
+		}
+
+	private:
+		const char * m_name;
+		Clock::time_point m_start;
+	};
+
+	virtual ~VRTraceRecorder();
+	static VRTraceRecorder* getInstance();
+
+	//starts recording for the given time. The trace is written to filename once it elapsed
+	void start(double seconds, const std::string &filename);
+	//writes the trace if the capture time elapsed. Returns true if a trace was written
+	bool update();
+	bool isRecording();
+
+	//name shown for the calling thread in the trace. The name has to be a string literal
+	void setThreadName(const char * name);
+
+	void add(const char * name, Clock::time_point start, Clock::time_point end);
+
+private:
+	struct Event
+	{
+		const char * name;
+		long long start;	//us since the recorder was created
+		long long duration;	//us
+	};
+
+	struct ThreadBuffer
+	{
+		ThreadBuffer() : id(0), name(NULL), count(0){};
+		int id;
+		const char * name;
+		std::mutex mutex;
+		std::vector<Event> events;
+		long long count;	//number of events added since the recording started
+	};
+
+	VRTraceRecorder();
+	static VRTraceRecorder* instance;
+	static thread_local ThreadBuffer* threadLocalBuffer;
+
+	ThreadBuffer * threadBuffer();
+	bool write(const std::string &filename);
+	long long toMicroseconds(Clock::time_point time);
+
+	std::atomic<bool> m_recording;
+	Clock::time_point m_epoch;
+	Clock::time_point m_stopTime;
+	std::string m_filename;
+
+	std::mutex m_mutex;
+	std::vector<ThreadBuffer *> m_buffers;
+};
+
+#endif //VRTRACERECORDER_H
@@ -0,0 +1,251 @@
+#include "XMAAnalysis.h"
+#include "XMATransformTrack.h"
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define XMA_SSE2
+#include <emmintrin.h>
+#endif
+
+void XMAAnalysis::multiply(const float * a, const float * b, float * result)
+{
+	float tmp[16];
+	for (int c = 0; c < 4; c++)
+	{
+		for (int r = 0; r < 4; r++)
+		{
+			tmp[4 * c + r] = a[r] * b[4 * c] + a[4 + r] * b[4 * c + 1] + a[8 + r] * b[4 * c + 2] + a[12 + r] * b[4 * c + 3];
+		}
+	}
+	for (int i = 0; i < 16; i++)
+		result[i] = tmp[i];
+}
+
+bool XMAAnalysis::invert(const float * m, float * result)
+{
+	double inv[16];
+	inv[0] = m[5] * m[10] * m[15] - m[5] * m[11] * m[14] - m[9] * m[6] * m[15] + m[9] * m[7] * m[14] + m[13] * m[6] * m[11] - m[13] * m[7] * m[10];
+	inv[4] = -m[4] * m[10] * m[15] + m[4] * m[11] * m[14] + m[8] * m[6] * m[15] - m[8] * m[7] * m[14] - m[12] * m[6] * m[11] + m[12] * m[7] * m[10];
+	inv[8] = m[4] * m[9] * m[15] - m[4] * m[11] * m[13] - m[8] * m[5] * m[15] + m[8] * m[7] * m[13] + m[12] * m[5] * m[11] - m[12] * m[7] * m[9];
+	inv[12] = -m[4] * m[9] * m[14] + m[4] * m[10] * m[13] + m[8] * m[5] * m[14] - m[8] * m[6] * m[13] - m[12] * m[5] * m[10] + m[12] * m[6] * m[9];
+	inv[1] = -m[1] * m[10] * m[15] + m[1] * m[11] * m[14] + m[9] * m[2] * m[15] - m[9] * m[3] * m[14] - m[13] * m[2] * m[11] + m[13] * m[3] * m[10];
+	inv[5] = m[0] * m[10] * m[15] - m[0] * m[11] * m[14] - m[8] * m[2] * m[15] + m[8] * m[3] * m[14] + m[12] * m[2] * m[11] - m[12] * m[3] * m[10];
+	inv[9] = -m[0] * m[9] * m[15] + m[0] * m[11] * m[13] + m[8] * m[1] * m[15] - m[8] * m[3] * m[13] - m[12] * m[1] * m[11] + m[12] * m[3] * m[9];
+	inv[13] = m[0] * m[9] * m[14] - m[0] * m[10] * m[13] - m[8] * m[1] * m[14] + m[8] * m[2] * m[13] + m[12] * m[1] * m[10] - m[12] * m[2] * m[9];
+	inv[2] = m[1] * m[6] * m[15] - m[1] * m[7] * m[14] - m[5] * m[2] * m[15] + m[5] * m[3] * m[14] + m[13] * m[2] * m[7] - m[13] * m[3] * m[6];
+	inv[6] = -m[0] * m[6] * m[15] + m[0] * m[7] * m[14] + m[4] * m[2] * m[15] - m[4] * m[3] * m[14] - m[12] * m[2] * m[7] + m[12] * m[3] * m[6];
+	inv[10] = m[0] * m[5] * m[15] - m[0] * m[7] * m[13] - m[4] * m[1] * m[15] + m[4] * m[3] * m[13] + m[12] * m[1] * m[7] - m[12] * m[3] * m[5];
+	inv[14] = -m[0] * m[5] * m[14] + m[0] * m[6] * m[13] + m[4] * m[1] * m[14] - m[4] * m[2] * m[13] - m[12] * m[1] * m[6] + m[12] * m[2] * m[5];
+	inv[3] = -m[1] * m[6] * m[11] + m[1] * m[7] * m[10] + m[5] * m[2] * m[11] - m[5] * m[3] * m[10] - m[9] * m[2] * m[7] + m[9] * m[3] * m[6];
+	inv[7] = m[0] * m[6] * m[11] - m[0] * m[7] * m[10] - m[4] * m[2] * m[11] + m[4] * m[3] * m[10] + m[8] * m[2] * m[7] - m[8] * m[3] * m[6];
+	inv[11] = -m[0] * m[5] * m[11] + m[0] * m[7] * m[9] + m[4] * m[1] * m[11] - m[4] * m[3] * m[9] - m[8] * m[1] * m[7] + m[8] * m[3] * m[5];
+	inv[15] = m[0] * m[5] * m[10] - m[0] * m[6] * m[9] - m[4] * m[1] * m[10] + m[4] * m[2] * m[9] + m[8] * m[1] * m[6] - m[8] * m[2] * m[5];
+
+	double det = m[0] * inv[0] + m[1] * inv[4] + m[2] * inv[8] + m[3] * inv[12];
+	if (det == 0)
+		return false;
+
+	for (int i = 0; i < 16; i++)
+		result[i] = inv[i] / det;
+	return true;
+}
+
+void XMAAnalysis::transformPoint(const float * m, const float * p, float * result)
+{
+	float x = m[0] * p[0] + m[4] * p[1] + m[8] * p[2] + m[12];
+	float y = m[1] * p[0] + m[5] * p[1] + m[9] * p[2] + m[13];
+	float z = m[2] * p[0] + m[6] * p[1] + m[10] * p[2] + m[14];
+	float w = m[3] * p[0] + m[7] * p[1] + m[11] * p[2] + m[15];
+	if (w != 0 && w != 1)
+	{
+		x /= w;
+		y /= w;
+		z /= w;
+	}
+	result[0] = x;
+	result[1] = y;
+	result[2] = z;
+}
+
+void XMAAnalysis::computeTrajectory(const float * position, XMATransformTrack * track, XMATransformTrack * fixedTrack, const float * fixPose,
+	int numFrames, float * positions, unsigned char * visible)
+{
+	computeTrajectories(position, 1, track, fixedTrack, fixPose, numFrames, &positions, &visible);
+}
+
+void XMAAnalysis::computeTrajectories(const float * points, int count, XMATransformTrack * track, XMATransformTrack * fixedTrack,
+	const float * fixPose, int numFrames, float * const * positions, unsigned char * const * visible)
+{
+	std::vector<float> matrices(track ? 16 * TRACK_PAGE_FRAMES : 0);
+	std::vector<unsigned char> trackVisible(TRACK_PAGE_FRAMES, 1);
+	std::vector<float> fixes(fixedTrack ? 16 * TRACK_PAGE_FRAMES : 0);
+	std::vector<unsigned char> fixedVisible(TRACK_PAGE_FRAMES, 1);
+	float inverse[16];
+	for (int first = 0; first < numFrames; first += TRACK_PAGE_FRAMES)
+	{
+		int frames = (numFrames - first < TRACK_PAGE_FRAMES) ? numFrames - first : TRACK_PAGE_FRAMES;
+		if (track)
+			track->readRange(first, frames, &matrices[0], &trackVisible[0]);
+		if (fixedTrack)
+		{
+			//the fixed bone is placed at fixPose once per frame for all points
+			fixedTrack->readRange(first, frames, &fixes[0], &fixedVisible[0]);
+			for (int i = 0; i < frames; i++)
+			{
+				invert(&fixes[16 * i], inverse);
+				multiply(fixPose, inverse, &fixes[16 * i]);
+			}
+		}
+
+		for (int k = 0; k < count; k++)
+		{
+			for (int i = 0; i < frames; i++)
+			{
+				float * p = &positions[k][3 * (first + i)];
+				memcpy(p, &points[3 * k], 3 * sizeof(float));
+				visible[k][first + i] = trackVisible[i] && fixedVisible[i];
+				if (track)
+					transformPoint(&matrices[16 * i], p, p);
+				if (fixedTrack)
+					transformPoint(&fixes[16 * i], p, p);
+			}
+		}
+	}
+}
+
+void XMAAnalysis::projectToPlane(const float * toPlane, const float * fromPlane, const float * points, int count,
+	float * result, float * min, float * max)
+{
+	if (count <= 0)
+		return;
+
+	//dropping y in the frame is a projection, so the way back is folded into one matrix
+	static const float flatten[16] = { 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+	float m[16];
+	multiply(fromPlane, flatten, m);
+	multiply(m, toPlane, m);
+	const float * t = toPlane;
+
+	int i = 0;
+	float minX = 1e30f, minZ = 1e30f, maxX = -1e30f, maxZ = -1e30f;
+#ifdef XMA_SSE2
+	//four points are twelve consecutive floats, transposed to x, y and z of the four
+	__m128 minx = _mm_set1_ps(minX), minz = _mm_set1_ps(minZ), maxx = _mm_set1_ps(maxX), maxz = _mm_set1_ps(maxZ);
+	for (; i + 4 <= count; i += 4)
+	{
+		const float * p = &points[3 * i];
+		__m128 a = _mm_loadu_ps(p), b = _mm_loadu_ps(p + 4), c = _mm_loadu_ps(p + 8);
+		__m128 x = _mm_shuffle_ps(a, _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2)), _MM_SHUFFLE(2, 0, 3, 0));
+		__m128 y = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1)), _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+		__m128 z = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2)), _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0));
+
+		__m128 px = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(t[0]), x), _mm_mul_ps(_mm_set1_ps(t[4]), y)), _mm_mul_ps(_mm_set1_ps(t[8]), z)), _mm_set1_ps(t[12]));
+		__m128 pz = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(t[2]), x), _mm_mul_ps(_mm_set1_ps(t[6]), y)), _mm_mul_ps(_mm_set1_ps(t[10]), z)), _mm_set1_ps(t[14]));
+		minx = _mm_min_ps(minx, px);
+		maxx = _mm_max_ps(maxx, px);
+		minz = _mm_min_ps(minz, pz);
+		maxz = _mm_max_ps(maxz, pz);
+
+		__m128 rx = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[0]), x), _mm_mul_ps(_mm_set1_ps(m[4]), y)), _mm_mul_ps(_mm_set1_ps(m[8]), z)), _mm_set1_ps(m[12]));
+		__m128 ry = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[1]), x), _mm_mul_ps(_mm_set1_ps(m[5]), y)), _mm_mul_ps(_mm_set1_ps(m[9]), z)), _mm_set1_ps(m[13]));
+		__m128 rz = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[2]), x), _mm_mul_ps(_mm_set1_ps(m[6]), y)), _mm_mul_ps(_mm_set1_ps(m[10]), z)), _mm_set1_ps(m[14]));
+
+		float * r = &result[3 * i];
+		_mm_storeu_ps(r, _mm_shuffle_ps(_mm_shuffle_ps(rx, ry, _MM_SHUFFLE(0, 0, 0, 0)), _mm_shuffle_ps(rz, rx, _MM_SHUFFLE(1, 1, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0)));
+		_mm_storeu_ps(r + 4, _mm_shuffle_ps(_mm_shuffle_ps(ry, rz, _MM_SHUFFLE(1, 1, 1, 1)), _mm_shuffle_ps(rx, ry, _MM_SHUFFLE(2, 2, 2, 2)), _MM_SHUFFLE(2, 0, 2, 0)));
+		_mm_storeu_ps(r + 8, _mm_shuffle_ps(_mm_shuffle_ps(rz, rx, _MM_SHUFFLE(3, 3, 2, 2)), _mm_shuffle_ps(ry, rz, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0)));
+	}
+	float lanes[4][4];
+	_mm_storeu_ps(lanes[0], minx);
+	_mm_storeu_ps(lanes[1], maxx);
+	_mm_storeu_ps(lanes[2], minz);
+	_mm_storeu_ps(lanes[3], maxz);
+	for (int k = 0; k < 4; k++)
+	{
+		if (lanes[0][k] < minX) minX = lanes[0][k];
+		if (lanes[1][k] > maxX) maxX = lanes[1][k];
+		if (lanes[2][k] < minZ) minZ = lanes[2][k];
+		if (lanes[3][k] > maxZ) maxZ = lanes[3][k];
+	}
+#endif
+	for (; i < count; i++)
+	{
+		const float * p = &points[3 * i];
+		float px = t[0] * p[0] + t[4] * p[1] + t[8] * p[2] + t[12];
+		float pz = t[2] * p[0] + t[6] * p[1] + t[10] * p[2] + t[14];
+		if (px < minX) minX = px;
+		if (px > maxX) maxX = px;
+		if (pz < minZ) minZ = pz;
+		if (pz > maxZ) maxZ = pz;
+
+		float * r = &result[3 * i];
+		r[0] = m[0] * p[0] + m[4] * p[1] + m[8] * p[2] + m[12];
+		r[1] = m[1] * p[0] + m[5] * p[1] + m[9] * p[2] + m[13];
+		r[2] = m[2] * p[0] + m[6] * p[1] + m[10] * p[2] + m[14];
+	}
+	min[0] = minX;
+	min[1] = minZ;
+	max[0] = maxX;
+	max[1] = maxZ;
+}
+
+int XMAAnalysis::findNearest(const float * points, int count, const float * target, float maxDistance)
+{
+	//compare squared distances
+	int nearest = -1;
+	float best = maxDistance * maxDistance;
+	for (int i = 0; i < count; i++)
+	{
+		float dx = points[3 * i] - target[0];
+		float dy = points[3 * i + 1] - target[1];
+		float dz = points[3 * i + 2] - target[2];
+		float d = dx * dx + dy * dy + dz * dz;
+		if (d < best)
+		{
+			best = d;
+			nearest = i;
+		}
+	}
+	return nearest;
+}
+
+void XMAAnalysis::distanceSeries(const float * a, const unsigned char * visibleA, const float * b, const unsigned char * visibleB,
+	int numFrames, double skipValue, std::vector<double> &series)
+{
+	series.resize(numFrames);
+	for (int i = 0; i < numFrames; i++)
+	{
+		if (visibleA[i] && visibleB[i])
+		{
+			double dx = a[3 * i] - b[3 * i];
+			double dy = a[3 * i + 1] - b[3 * i + 1];
+			double dz = a[3 * i + 2] - b[3 * i + 2];
+			series[i] = sqrt(dx * dx + dy * dy + dz * dz);
+		}
+		else
+		{
+			series[i] = skipValue;
+		}
+	}
+}
+
+void XMAAnalysis::angleSeries(const float * a, const unsigned char * visibleA, const float * b, const unsigned char * visibleB,
+	const float * c, const unsigned char * visibleC, const float * d, const unsigned char * visibleD,
+	int numFrames, double skipValue, std::vector<double> &series)
+{
+	series.resize(numFrames);
+	for (int i = 0; i < numFrames; i++)
+	{
+		if (visibleA[i] && visibleB[i] && visibleC[i] && visibleD[i])
+		{
+			series[i] = (a[3 * i] - b[3 * i]) * (c[3 * i] - d[3 * i])
+				+ (a[3 * i + 1] - b[3 * i + 1]) * (c[3 * i + 1] - d[3 * i + 1])
+				+ (a[3 * i + 2] - b[3 * i + 2]) * (c[3 * i + 2] - d[3 * i + 2]);
+		}
+		else
+		{
+			series[i] = skipValue;
+		}
+	}
+}
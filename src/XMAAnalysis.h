@@ -0,0 +1,45 @@
+#ifndef XMAANALYSIS_H
+#define XMAANALYSIS_H
+
+#include <vector>
+
+class XMATransformTrack;
+
+// Analysis kernels on plain float data, shared by the application and the benchmarks.
+// Matrices are column major 4x4, points are x,y,z triplets.
+namespace XMAAnalysis
+{
+	void multiply(const float * a, const float * b, float * result);
+	//returns false if the matrix is singular
+	bool invert(const float * m, float * result);
+	void transformPoint(const float * m, const float * p, float * result);
+
+	//Position of a point attached to a bone for every frame. track is NULL for a point in world space.
+	//If fixedTrack is set the positions are relative to the fixed bone placed at fixPose.
+	//positions has to hold 3 * numFrames and visible numFrames values.
+	void computeTrajectory(const float * position, XMATransformTrack * track, XMATransformTrack * fixedTrack, const float * fixPose,
+		int numFrames, float * positions, unsigned char * visible);
+	//The same for count points attached to one bone, points holds their x,y,z. The tracks are read once
+	//for all points, a page of frames at a time. positions[k] and visible[k] get the frames of point k.
+	void computeTrajectories(const float * points, int count, XMATransformTrack * track, XMATransformTrack * fixedTrack,
+		const float * fixPose, int numFrames, float * const * positions, unsigned char * const * visible);
+
+	//Projects points along the y axis of a frame onto its y = 0 plane. toPlane transforms the points into
+	//the frame, fromPlane from the frame into the coordinates of result. min and max get the x and z range
+	//of the projected points in the frame and are not changed if count is 0.
+	void projectToPlane(const float * toPlane, const float * fromPlane, const float * points, int count,
+		float * result, float * min, float * max);
+
+	//index of the point closest to target with a distance below maxDistance, -1 if there is none
+	int findNearest(const float * points, int count, const float * target, float maxDistance);
+
+	//|a - b| per frame, skipValue for frames in which a point is not visible
+	void distanceSeries(const float * a, const unsigned char * visibleA, const float * b, const unsigned char * visibleB,
+		int numFrames, double skipValue, std::vector<double> &series);
+	//dot(a - b, c - d) per frame, skipValue for frames in which a point is not visible
+	void angleSeries(const float * a, const unsigned char * visibleA, const float * b, const unsigned char * visibleB,
+		const float * c, const unsigned char * visibleC, const float * d, const unsigned char * visibleD,
+		int numFrames, double skipValue, std::vector<double> &series);
+}
+
+#endif //XMAANALYSIS_H
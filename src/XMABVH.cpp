@@ -0,0 +1,301 @@
+#include "XMABVH.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	struct BuildTask
+	{
+		int node;
+		int begin;
+		int end;
+	};
+
+	struct CentroidLess
+	{
+		const std::vector<float> * centroids;
+		int axis;
+		bool operator()(int a, int b) const { return (*centroids)[3 * a + axis] < (*centroids)[3 * b + axis]; }
+	};
+
+	inline void sub(const float * a, const float * b, float * r)
+	{
+		r[0] = a[0] - b[0];
+		r[1] = a[1] - b[1];
+		r[2] = a[2] - b[2];
+	}
+
+	inline void cross(const float * a, const float * b, float * r)
+	{
+		r[0] = a[1] * b[2] - a[2] * b[1];
+		r[1] = a[2] * b[0] - a[0] * b[2];
+		r[2] = a[0] * b[1] - a[1] * b[0];
+	}
+
+	inline float dot(const float * a, const float * b)
+	{
+		return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+	}
+
+	inline void transformPoint(const float * m, const float * p, float * r)
+	{
+		for (int i = 0; i < 3; i++)
+			r[i] = m[i] * p[0] + m[4 + i] * p[1] + m[8 + i] * p[2] + m[12 + i];
+	}
+
+	//signed distances of the vertices q to the plane of the triangle p, scaled by the length of its
+	//normal. Distances within the epsilon are set to 0. Returns the length of the normal
+	float planeDistances(const float * p, const float * q, float * d)
+	{
+		float e1[3], e2[3], n[3];
+		sub(p + 3, p, e1);
+		sub(p + 6, p, e2);
+		cross(e1, e2, n);
+		float length = std::sqrt(dot(n, n));
+		float offset = dot(n, p);
+		for (int i = 0; i < 3; i++)
+		{
+			d[i] = dot(n, q + 3 * i) - offset;
+			if (std::fabs(d[i]) < XMA_BVH_EPSILON * length)
+				d[i] = 0.0f;
+		}
+		return length;
+	}
+
+	//interval in which the triangle with the projected vertices p and the plane distances d crosses
+	//the other plane. Returns false if the triangle lies in the plane
+	bool crossingInterval(const float * p, const float * d, float &a, float &b)
+	{
+		//the vertex alone on its side of the plane
+		int lone;
+		if (d[0] * d[1] > 0.0f)
+			lone = 2;
+		else if (d[0] * d[2] > 0.0f)
+			lone = 1;
+		else if (d[1] * d[2] > 0.0f || d[0] != 0.0f)
+			lone = 0;
+		else if (d[1] != 0.0f)
+			lone = 1;
+		else if (d[2] != 0.0f)
+			lone = 2;
+		else
+			return false;
+
+		int o1 = (lone + 1) % 3;
+		int o2 = (lone + 2) % 3;
+		a = p[lone] + (p[o1] - p[lone]) * d[lone] / (d[lone] - d[o1]);
+		b = p[lone] + (p[o2] - p[lone]) * d[lone] / (d[lone] - d[o2]);
+		if (a > b)
+			std::swap(a, b);
+		return true;
+	}
+
+	//Moeller's interval test of two triangles given by 9 floats each. Returns the depth of the
+	//crossing, or a negative value if they do not cross
+	float crossTriangles(const float * v, const float * u)
+	{
+		float du[3], dv[3];
+		float lengthV = planeDistances(v, u, du);
+		if ((du[0] > 0.0f && du[1] > 0.0f && du[2] > 0.0f) || (du[0] < 0.0f && du[1] < 0.0f && du[2] < 0.0f))
+			return -1.0f;
+		float lengthU = planeDistances(u, v, dv);
+		if ((dv[0] > 0.0f && dv[1] > 0.0f && dv[2] > 0.0f) || (dv[0] < 0.0f && dv[1] < 0.0f && dv[2] < 0.0f))
+			return -1.0f;
+		if (lengthV == 0.0f || lengthU == 0.0f)
+			return -1.0f;
+
+		//project onto the largest axis of the line in which the planes meet
+		float e1[3], e2[3], nv[3], nu[3], line[3];
+		sub(v + 3, v, e1);
+		sub(v + 6, v, e2);
+		cross(e1, e2, nv);
+		sub(u + 3, u, e1);
+		sub(u + 6, u, e2);
+		cross(e1, e2, nu);
+		cross(nv, nu, line);
+		int axis = 0;
+		if (std::fabs(line[1]) > std::fabs(line[axis]))
+			axis = 1;
+		if (std::fabs(line[2]) > std::fabs(line[axis]))
+			axis = 2;
+
+		float pv[3] = { v[axis], v[3 + axis], v[6 + axis] };
+		float pu[3] = { u[axis], u[3 + axis], u[6 + axis] };
+		float av, bv, au, bu;
+		if (!crossingInterval(pv, dv, av, bv) || !crossingInterval(pu, du, au, bu))
+			return -1.0f;
+		//intervals which only touch do not count
+		if (av >= bu || au >= bv)
+			return -1.0f;
+
+		float behindV = 0.0f, behindU = 0.0f;
+		for (int i = 0; i < 3; i++)
+		{
+			behindV = std::max(behindV, -dv[i]);
+			behindU = std::max(behindU, -du[i]);
+		}
+		return std::min(behindV / lengthU, behindU / lengthV);
+	}
+}
+
+XMABVH::XMABVH(const float * triangles, int numTriangles)
+{
+	if (numTriangles <= 0)
+		return;
+
+	std::vector<float> centroids(3 * numTriangles);
+	std::vector<int> order(numTriangles);
+	for (int t = 0; t < numTriangles; t++)
+	{
+		order[t] = t;
+		for (int k = 0; k < 3; k++)
+			centroids[3 * t + k] = (triangles[9 * t + k] + triangles[9 * t + 3 + k] + triangles[9 * t + 6 + k]) / 3.0f;
+	}
+
+	//split at the median centroid along the longest axis until the leaves are small enough
+	m_nodes.reserve(2 * (numTriangles / XMA_BVH_LEAF_TRIANGLES) + 1);
+	m_nodes.push_back(Node());
+	std::vector<BuildTask> tasks;
+	BuildTask root = { 0, 0, numTriangles };
+	tasks.push_back(root);
+	while (!tasks.empty())
+	{
+		BuildTask task = tasks.back();
+		tasks.pop_back();
+
+		Node node;
+		float cmin[3], cmax[3];
+		for (int k = 0; k < 3; k++)
+		{
+			node.min[k] = cmin[k] = HUGE_VALF;
+			node.max[k] = cmax[k] = -HUGE_VALF;
+		}
+		for (int i = task.begin; i < task.end; i++)
+		{
+			const float * tri = triangles + 9 * order[i];
+			for (int k = 0; k < 3; k++)
+			{
+				node.min[k] = std::min(node.min[k], std::min(tri[k], std::min(tri[3 + k], tri[6 + k])));
+				node.max[k] = std::max(node.max[k], std::max(tri[k], std::max(tri[3 + k], tri[6 + k])));
+				cmin[k] = std::min(cmin[k], centroids[3 * order[i] + k]);
+				cmax[k] = std::max(cmax[k], centroids[3 * order[i] + k]);
+			}
+		}
+
+		if (task.end - task.begin <= XMA_BVH_LEAF_TRIANGLES)
+		{
+			node.first = task.begin;
+			node.count = task.end - task.begin;
+			m_nodes[task.node] = node;
+			continue;
+		}
+
+		int axis = 0;
+		if (cmax[1] - cmin[1] > cmax[axis] - cmin[axis])
+			axis = 1;
+		if (cmax[2] - cmin[2] > cmax[axis] - cmin[axis])
+			axis = 2;
+		int middle = (task.begin + task.end) / 2;
+		CentroidLess less = { &centroids, axis };
+		std::nth_element(order.begin() + task.begin, order.begin() + middle, order.begin() + task.end, less);
+
+		node.first = m_nodes.size();
+		node.count = 0;
+		m_nodes[task.node] = node;
+		m_nodes.push_back(Node());
+		m_nodes.push_back(Node());
+		BuildTask left = { node.first, task.begin, middle };
+		BuildTask right = { node.first + 1, middle, task.end };
+		tasks.push_back(right);
+		tasks.push_back(left);
+	}
+	m_nodes.shrink_to_fit();
+
+	m_triangles.resize(9 * numTriangles);
+	for (int i = 0; i < numTriangles; i++)
+		std::copy(triangles + 9 * order[i], triangles + 9 * order[i] + 9, m_triangles.begin() + 9 * i);
+}
+
+bool XMABVH::intersect(const XMABVH &other, const float * otherToThis, float * depth) const
+{
+	if (depth)
+		*depth = 0.0f;
+	if (m_nodes.empty() || other.m_nodes.empty())
+		return false;
+
+	const float * m = otherToThis;
+	bool found = false;
+	std::vector<std::pair<int, int> > stack;
+	stack.push_back(std::make_pair(0, 0));
+	float moved[9 * XMA_BVH_LEAF_TRIANGLES];
+	while (!stack.empty())
+	{
+		int ia = stack.back().first;
+		int ib = stack.back().second;
+		stack.pop_back();
+		const Node &a = m_nodes[ia];
+		const Node &b = other.m_nodes[ib];
+
+		//box of b in the coordinates of this mesh, around its moved center
+		float center[3], extent[3], c[3];
+		for (int k = 0; k < 3; k++)
+			c[k] = 0.5f * (b.min[k] + b.max[k]);
+		transformPoint(m, c, center);
+		bool overlap = true;
+		for (int k = 0; k < 3 && overlap; k++)
+		{
+			extent[k] = 0.5f * (std::fabs(m[k]) * (b.max[0] - b.min[0]) + std::fabs(m[4 + k]) * (b.max[1] - b.min[1]) + std::fabs(m[8 + k]) * (b.max[2] - b.min[2]));
+			overlap = center[k] - extent[k] <= a.max[k] && center[k] + extent[k] >= a.min[k];
+		}
+		if (!overlap)
+			continue;
+
+		if (a.count > 0 && b.count > 0)
+		{
+			for (int j = 0; j < b.count; j++)
+			{
+				for (int k = 0; k < 3; k++)
+					transformPoint(m, &other.m_triangles[9 * (b.first + j) + 3 * k], moved + 9 * j + 3 * k);
+			}
+			for (int i = 0; i < a.count; i++)
+			{
+				for (int j = 0; j < b.count; j++)
+				{
+					float d = crossTriangles(&m_triangles[9 * (a.first + i)], moved + 9 * j);
+					if (d < 0.0f)
+						continue;
+					if (!depth)
+						return true;
+					found = true;
+					*depth = std::max(*depth, d);
+				}
+			}
+			continue;
+		}
+
+		//descend into the larger box, or the one which is not a leaf
+		float sizeA = (a.max[0] - a.min[0]) + (a.max[1] - a.min[1]) + (a.max[2] - a.min[2]);
+		float sizeB = (b.max[0] - b.min[0]) + (b.max[1] - b.min[1]) + (b.max[2] - b.min[2]);
+		if (b.count > 0 || (a.count == 0 && sizeA >= sizeB))
+		{
+			stack.push_back(std::make_pair(a.first, ib));
+			stack.push_back(std::make_pair(a.first + 1, ib));
+		}
+		else
+		{
+			stack.push_back(std::make_pair(ia, b.first));
+			stack.push_back(std::make_pair(ia, b.first + 1));
+		}
+	}
+	return found;
+}
+
+int XMABVH::getTriangles() const
+{
+	return m_triangles.size() / 9;
+}
+
+long long XMABVH::getBytes() const
+{
+	return m_nodes.capacity() * sizeof(Node) + m_triangles.capacity() * sizeof(float);
+}
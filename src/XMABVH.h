@@ -0,0 +1,45 @@
+#ifndef XMABVH_H
+#define XMABVH_H
+
+#include <vector>
+#include <cstddef>
+
+//maximum number of triangles in a leaf of the hierarchy
+#define XMA_BVH_LEAF_TRIANGLES 4
+//vertices closer than this to the plane of the other triangle are on it, in model units
+#define XMA_BVH_EPSILON 1e-6f
+
+//Bounding volume hierarchy of axis aligned boxes over the triangles of a mesh. Two meshes in
+//different poses are tested for intersecting triangles by descending both hierarchies at once,
+//the boxes of the other mesh are moved into the coordinates of this one on the way.
+class XMABVH
+{
+public:
+	//9 floats per triangle, the x,y,z of its three vertices
+	XMABVH(const float * triangles, int numTriangles);
+
+	//tests the mesh other placed by otherToThis, a column major rigid 4x4 transformation into the
+	//coordinates of this mesh. Returns true if triangles cross each other, triangles which only touch
+	//or are coplanar do not count. Without depth the test stops at the first crossing. Otherwise
+	//depth gets the deepest crossing: for each pair of crossing triangles, how far the vertices of
+	//each one lie behind the other, the smaller of both. Triangles have to be counter clockwise
+	//seen from outside. Meshes completely inside each other are not found.
+	bool intersect(const XMABVH &other, const float * otherToThis, float * depth = NULL) const;
+
+	int getTriangles() const;
+	long long getBytes() const;
+
+private:
+	struct Node
+	{
+		float min[3];
+		float max[3];
+		int first;	//first triangle of a leaf, first of the two children otherwise
+		int count;	//triangles of a leaf, 0 for inner nodes
+	};
+
+	std::vector<Node> m_nodes;
+	std::vector<float> m_triangles;	//ordered by leaf
+};
+
+#endif //XMABVH_H
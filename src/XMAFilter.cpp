@@ -0,0 +1,288 @@
+#include "XMAFilter.h"
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define XMA_SSE2
+#include <emmintrin.h>
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+XMAFilter::XMAFilter(double cutoff, double sampleRate) : m_cutoff(cutoff), m_sampleRate(sampleRate)
+{
+	m_valid = cutoff > 0 && sampleRate > 0 && cutoff < 0.5 * sampleRate;
+	if (!m_valid)
+		return;
+
+	//prewarped cutoff of the bilinear transform, corrected for the two passes (Winter)
+	double correction = std::pow(std::sqrt(2.0) - 1.0, 0.25);
+	double k = std::tan(M_PI * cutoff / sampleRate) / correction;
+	double norm = 1.0 / (1.0 + std::sqrt(2.0) * k + k * k);
+	m_b[0] = (float)(k * k * norm);
+	m_b[1] = (float)(2.0 * k * k * norm);
+	m_b[2] = m_b[0];
+	m_a[0] = 1.0f;
+	m_a[1] = (float)(2.0 * (k * k - 1.0) * norm);
+	m_a[2] = (float)((1.0 - std::sqrt(2.0) * k + k * k) * norm);
+}
+
+bool XMAFilter::isValid() const
+{
+	return m_valid;
+}
+
+double XMAFilter::getCutoff() const
+{
+	return m_cutoff;
+}
+
+double XMAFilter::getSampleRate() const
+{
+	return m_sampleRate;
+}
+
+void XMAFilter::filtfilt(float * data, int numFrames, int channels, int stride) const
+{
+	if (!m_valid || numFrames < 2 || channels <= 0)
+		return;
+
+	//odd reflection of about one period of the cutoff at both ends
+	int pad = std::min(numFrames - 1, std::max(XMA_FILTER_MIN_PAD, (int)(m_sampleRate / m_cutoff)));
+	int length = numFrames + 2 * pad;
+	std::vector<float> buffer((size_t)length * channels);
+	const float * first = data;
+	const float * last = data + (size_t)stride * (numFrames - 1);
+	for (int t = 0; t < numFrames; t++)
+		std::copy(data + (size_t)stride * t, data + (size_t)stride * t + channels, &buffer[(size_t)channels * (pad + t)]);
+	for (int k = 1; k <= pad; k++)
+	{
+		const float * before = data + (size_t)stride * k;
+		const float * after = data + (size_t)stride * (numFrames - 1 - k);
+		for (int c = 0; c < channels; c++)
+		{
+			buffer[(size_t)channels * (pad - k) + c] = 2.0f * first[c] - before[c];
+			buffer[(size_t)channels * (pad + numFrames - 1 + k) + c] = 2.0f * last[c] - after[c];
+		}
+	}
+
+	pass(&buffer[0], length, channels, false);
+	pass(&buffer[0], length, channels, true);
+
+	for (int t = 0; t < numFrames; t++)
+		std::copy(&buffer[(size_t)channels * (pad + t)], &buffer[(size_t)channels * (pad + t)] + channels, data + (size_t)stride * t);
+}
+
+void XMAFilter::pass(float * data, int numFrames, int channels, bool backward) const
+{
+	//transposed direct form II, the state starts as if the first value had been there forever
+	const float b0 = m_b[0], b1 = m_b[1], b2 = m_b[2], a1 = m_a[1], a2 = m_a[2];
+	int step = backward ? -channels : channels;
+	float * row = backward ? data + (size_t)channels * (numFrames - 1) : data;
+	std::vector<float> z1(channels), z2(channels);
+	for (int c = 0; c < channels; c++)
+	{
+		z2[c] = (b2 - a2) * row[c];
+		z1[c] = (b1 - a1) * row[c] + z2[c];
+	}
+
+	for (int t = 0; t < numFrames; t++, row += step)
+	{
+		int c = 0;
+#ifdef XMA_SSE2
+		__m128 vb0 = _mm_set1_ps(b0), vb1 = _mm_set1_ps(b1), vb2 = _mm_set1_ps(b2), va1 = _mm_set1_ps(a1), va2 = _mm_set1_ps(a2);
+		for (; c + 4 <= channels; c += 4)
+		{
+			__m128 x = _mm_loadu_ps(row + c);
+			__m128 y = _mm_add_ps(_mm_mul_ps(vb0, x), _mm_loadu_ps(&z1[c]));
+			_mm_storeu_ps(&z1[c], _mm_add_ps(_mm_sub_ps(_mm_mul_ps(vb1, x), _mm_mul_ps(va1, y)), _mm_loadu_ps(&z2[c])));
+			_mm_storeu_ps(&z2[c], _mm_sub_ps(_mm_mul_ps(vb2, x), _mm_mul_ps(va2, y)));
+			_mm_storeu_ps(row + c, y);
+		}
+#endif
+		for (; c < channels; c++)
+		{
+			float x = row[c];
+			float y = b0 * x + z1[c];
+			z1[c] = b1 * x - a1 * y + z2[c];
+			z2[c] = b2 * x - a2 * y;
+			row[c] = y;
+		}
+	}
+}
+
+bool XMAFilter::bridgeGaps(float * data, int numFrames, int channels, int stride, const unsigned char * visible)
+{
+	int previous = -1;
+	for (int t = 0; t <= numFrames; t++)
+	{
+		if (t < numFrames && !visible[t])
+			continue;
+		if (t == numFrames && previous == -1)
+			return false;
+
+		//frames between the previous visible frame and this one, held at the ends of the track
+		const float * from = data + (size_t)stride * ((previous == -1) ? t : previous);
+		const float * to = data + (size_t)stride * ((t == numFrames) ? previous : t);
+		for (int g = previous + 1; g < t; g++)
+		{
+			float w = (previous == -1 || t == numFrames) ? 0.0f : (float)(g - previous) / (t - previous);
+			for (int c = 0; c < channels; c++)
+				data[(size_t)stride * g + c] = from[c] + w * (to[c] - from[c]);
+		}
+		previous = t;
+	}
+	return true;
+}
+
+void XMAFilter::filterTransforms(float * matrices, const unsigned char * visible, int numFrames) const
+{
+	if (!m_valid || numFrames < 2)
+		return;
+
+	//translation and quaternion per frame, neighbouring quaternions in the same hemisphere
+	std::vector<float> channels(7 * (size_t)numFrames);
+	const float * previous = NULL;
+	for (int t = 0; t < numFrames; t++)
+	{
+		if (!visible[t])
+			continue;
+		const float * m = matrices + 16 * (size_t)t;
+		float * ch = &channels[7 * (size_t)t];
+		ch[0] = m[12];
+		ch[1] = m[13];
+		ch[2] = m[14];
+		float * q = ch + 3;
+		float trace = m[0] + m[5] + m[10];
+		if (trace > 0)
+		{
+			float s = 2.0f * std::sqrt(trace + 1.0f);
+			q[0] = 0.25f * s;
+			q[1] = (m[6] - m[9]) / s;
+			q[2] = (m[8] - m[2]) / s;
+			q[3] = (m[1] - m[4]) / s;
+		}
+		else if (m[0] > m[5] && m[0] > m[10])
+		{
+			float s = 2.0f * std::sqrt(1.0f + m[0] - m[5] - m[10]);
+			q[0] = (m[6] - m[9]) / s;
+			q[1] = 0.25f * s;
+			q[2] = (m[4] + m[1]) / s;
+			q[3] = (m[8] + m[2]) / s;
+		}
+		else if (m[5] > m[10])
+		{
+			float s = 2.0f * std::sqrt(1.0f + m[5] - m[0] - m[10]);
+			q[0] = (m[8] - m[2]) / s;
+			q[1] = (m[4] + m[1]) / s;
+			q[2] = 0.25f * s;
+			q[3] = (m[9] + m[6]) / s;
+		}
+		else
+		{
+			float s = 2.0f * std::sqrt(1.0f + m[10] - m[0] - m[5]);
+			q[0] = (m[1] - m[4]) / s;
+			q[1] = (m[8] + m[2]) / s;
+			q[2] = (m[9] + m[6]) / s;
+			q[3] = 0.25f * s;
+		}
+		if (previous && q[0] * previous[0] + q[1] * previous[1] + q[2] * previous[2] + q[3] * previous[3] < 0)
+		{
+			for (int k = 0; k < 4; k++)
+				q[k] = -q[k];
+		}
+		previous = q;
+	}
+
+	if (!bridgeGaps(&channels[0], numFrames, 7, 7, visible))
+		return;
+	filtfilt(&channels[0], numFrames, 7, 7);
+
+	for (int t = 0; t < numFrames; t++)
+	{
+		if (!visible[t])
+			continue;
+		float * m = matrices + 16 * (size_t)t;
+		const float * ch = &channels[7 * (size_t)t];
+		float length = std::sqrt(ch[3] * ch[3] + ch[4] * ch[4] + ch[5] * ch[5] + ch[6] * ch[6]);
+		float w = ch[3] / length, x = ch[4] / length, y = ch[5] / length, z = ch[6] / length;
+		m[0] = 1 - 2 * (y * y + z * z);
+		m[1] = 2 * (x * y + w * z);
+		m[2] = 2 * (x * z - w * y);
+		m[4] = 2 * (x * y - w * z);
+		m[5] = 1 - 2 * (x * x + z * z);
+		m[6] = 2 * (y * z + w * x);
+		m[8] = 2 * (x * z + w * y);
+		m[9] = 2 * (y * z - w * x);
+		m[10] = 1 - 2 * (x * x + y * y);
+		m[12] = ch[0];
+		m[13] = ch[1];
+		m[14] = ch[2];
+	}
+}
+
+void XMAFilter::filterTrajectories(float * const * positions, const unsigned char * const * visible, int count, int numFrames) const
+{
+	int channels = 3 * count;
+	if (!m_valid || channels == 0 || numFrames < 2)
+		return;
+
+	//all trajectories side by side, so a frame of every point is filtered at once
+	std::vector<float> packed((size_t)channels * numFrames);
+	std::vector<unsigned char> filtered(count);
+	parallelFor(count, [&](int p) {
+		for (int t = 0; t < numFrames; t++)
+		{
+			for (int k = 0; k < 3; k++)
+				packed[(size_t)channels * t + 3 * p + k] = positions[p][3 * (size_t)t + k];
+		}
+		filtered[p] = bridgeGaps(&packed[3 * p], numFrames, 3, channels, visible[p]);
+	});
+
+	int blocks = (channels + XMA_FILTER_BLOCK_CHANNELS - 1) / XMA_FILTER_BLOCK_CHANNELS;
+	parallelFor(blocks, [&](int b) {
+		int first = b * XMA_FILTER_BLOCK_CHANNELS;
+		filtfilt(&packed[first], numFrames, std::min(XMA_FILTER_BLOCK_CHANNELS, channels - first), channels);
+	});
+
+	parallelFor(count, [&](int p) {
+		if (!filtered[p])
+			return;
+		for (int t = 0; t < numFrames; t++)
+		{
+			if (!visible[p][t])
+				continue;
+			for (int k = 0; k < 3; k++)
+				positions[p][3 * (size_t)t + k] = packed[(size_t)channels * t + 3 * p + k];
+		}
+	});
+}
+
+void XMAFilter::parallelFor(int count, const std::function<void(int)> &job)
+{
+	int threads = std::min((int)std::thread::hardware_concurrency(), count);
+	if (threads <= 1)
+	{
+		for (int i = 0; i < count; i++)
+			job(i);
+		return;
+	}
+
+	//bones differ in length, so the threads take the next index when they are done
+	std::atomic<int> next(0);
+	auto work = [&]() {
+		for (int i = next++; i < count; i = next++)
+			job(i);
+	};
+	std::vector<std::thread> workers;
+	for (int t = 1; t < threads; t++)
+		workers.push_back(std::thread(work));
+	work();
+	for (size_t t = 0; t < workers.size(); t++)
+		workers[t].join();
+}
@@ -0,0 +1,52 @@
+#ifndef XMAFILTER_H
+#define XMAFILTER_H
+
+#include <functional>
+
+//frames added by odd reflection at both ends of a channel at least, against the transients of the filter
+#define XMA_FILTER_MIN_PAD 9
+//channels one thread filters together when trajectories are filtered in parallel
+#define XMA_FILTER_BLOCK_CHANNELS 64
+
+//Zero lag low-pass filter: a second order Butterworth filter run forwards and then backwards
+//over the frames, as XROMM data is usually filtered. Running it twice makes it a fourth order
+//filter, the cutoff is corrected for that so the filtered data is at -3 dB at the cutoff.
+//
+//The data are channels interleaved per frame. A frame of all channels is filtered at once, four
+//channels at a time with SSE2. Frames in which a bone or point is not visible are bridged by
+//linear interpolation before filtering and left as they are afterwards.
+class XMAFilter
+{
+public:
+	//cutoff and sample rate in Hz
+	XMAFilter(double cutoff, double sampleRate);
+
+	//false if the corrected cutoff is not below half the sample rate
+	bool isValid() const;
+	double getCutoff() const;
+	double getSampleRate() const;
+
+	//filters the channel c of frame t at data[stride * t + c] for c < channels
+	void filtfilt(float * data, int numFrames, int channels, int stride) const;
+	//column major rigid 4x4 matrices, filtered as translation and quaternion
+	void filterTransforms(float * matrices, const unsigned char * visible, int numFrames) const;
+	//the x, y and z of count trajectories of numFrames points each, filtered together as 3 * count channels
+	void filterTrajectories(float * const * positions, const unsigned char * const * visible, int count, int numFrames) const;
+
+	//linear interpolation of the channels over the frames which are not visible, the first and
+	//last visible frame are held before and after. Returns false if no frame is visible
+	static bool bridgeGaps(float * data, int numFrames, int channels, int stride, const unsigned char * visible);
+	//calls job(i) for 0 <= i < count from one thread per core, the calling thread takes part
+	static void parallelFor(int count, const std::function<void(int)> &job);
+
+private:
+	void pass(float * data, int numFrames, int channels, bool backward) const;
+
+	double m_cutoff;
+	double m_sampleRate;
+	bool m_valid;
+	float m_b[3];
+	float m_a[3];
+};
+
+#endif //XMAFILTER_H
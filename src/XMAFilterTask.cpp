@@ -0,0 +1,72 @@
+#include "XMAFilterTask.h"
+#include "XMAObject.h"
+#include "VRTraceRecorder.h"
+
+XMAFilterTask::XMAFilterTask(const std::vector<XMAObject*> &objects, const XMAFilter &filter) : m_objects(objects), m_filter(filter),
+	m_nextObject(0), m_filteredObjects(0), m_running(0), m_stop(false), m_finished(false)
+{
+}
+
+XMAFilterTask::~XMAFilterTask()
+{
+	m_stop = true;
+	for (size_t i = 0; i < m_workers.size(); i++)
+	{
+		if (m_workers[i].joinable())
+			m_workers[i].join();
+	}
+}
+
+void XMAFilterTask::start(int threads)
+{
+	int count = m_objects.size();
+	if (threads <= 0)
+		threads = (int)std::thread::hardware_concurrency() - 1;
+	if (threads > count)
+		threads = count;
+	if (threads < 1)
+		threads = 1;
+
+	m_running = threads;
+	for (int i = 0; i < threads; i++)
+		m_workers.push_back(std::thread(&XMAFilterTask::work, this));
+}
+
+bool XMAFilterTask::isFinished()
+{
+	return m_finished;
+}
+
+float XMAFilterTask::getProgress()
+{
+	return m_objects.empty() ? 1.0f : (float)m_filteredObjects / m_objects.size();
+}
+
+const XMAFilter &XMAFilterTask::getFilter()
+{
+	return m_filter;
+}
+
+void XMAFilterTask::apply()
+{
+	for (size_t i = 0; i < m_objects.size(); i++)
+		m_objects[i]->applyFilter();
+}
+
+void XMAFilterTask::work()
+{
+	VRTraceRecorder::getInstance()->setThreadName("Filter");
+	int count = m_objects.size();
+	while (!m_stop)
+	{
+		//bones differ in length, so the workers take the next bone when they are done
+		int o = m_nextObject++;
+		if (o >= count)
+			break;
+		m_objects[o]->prepareFilter(m_filter);
+		m_filteredObjects++;
+	}
+
+	if (--m_running == 0 && !m_stop)
+		m_finished = true;
+}
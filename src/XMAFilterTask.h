@@ -0,0 +1,46 @@
+#ifndef XMAFILTERTASK_H
+#define XMAFILTERTASK_H
+
+#include <vector>
+#include <thread>
+#include <atomic>
+
+#include "XMAFilter.h"
+
+class XMAObject;
+
+//Filters the transformations of the bones on background threads. Workers take the next bone when
+//they are done with one and read its track again. The bones are drawn as before until apply is
+//called once isFinished is true, so changing the filter does not stall the frames.
+class XMAFilterTask
+{
+public:
+	//the objects have to stay loaded until the task is finished or deleted
+	XMAFilterTask(const std::vector<XMAObject*> &objects, const XMAFilter &filter);
+	//stops the workers after the bone they are filtering
+	~XMAFilterTask();
+
+	//0 threads uses all cores but one, which is left to rendering
+	void start(int threads = 0);
+	bool isFinished();
+	//fraction of the bones filtered
+	float getProgress();
+	const XMAFilter &getFilter();
+	//draws the bones with the filtered transformations, from the render thread once isFinished is true
+	void apply();
+
+private:
+	void work();
+
+	std::vector<XMAObject*> m_objects;
+	XMAFilter m_filter;
+
+	std::atomic<int> m_nextObject;
+	std::atomic<int> m_filteredObjects;
+	std::atomic<int> m_running;
+	std::atomic<bool> m_stop;
+	std::atomic<bool> m_finished;
+	std::vector<std::thread> m_workers;
+};
+
+#endif //XMAFILTERTASK_H
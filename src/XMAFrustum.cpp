@@ -0,0 +1,57 @@
+#include "XMAFrustum.h"
+#include <cmath>
+
+XMAFrustum::XMAFrustum()
+{
+	//a frustum which contains everything
+	for (int p = 0; p < 6; p++)
+	{
+		m_planes[p][0] = m_planes[p][1] = m_planes[p][2] = 0.0f;
+		m_planes[p][3] = 1.0f;
+	}
+}
+
+XMAFrustum::XMAFrustum(const MinVR::VRMatrix4 &clip)
+{
+	//Gribb and Hartmann: the planes are the sums and differences of the fourth row with the
+	//others. The matrix is column-major, row i of column j is m[4 * j + i]
+	const float * m = clip.getArray();
+	for (int p = 0; p < 6; p++)
+	{
+		int row = p / 2;
+		float sign = (p % 2) ? -1.0f : 1.0f;
+		for (int j = 0; j < 4; j++)
+			m_planes[p][j] = m[4 * j + 3] + sign * m[4 * j + row];
+
+		float length = sqrt(m_planes[p][0] * m_planes[p][0] + m_planes[p][1] * m_planes[p][1] + m_planes[p][2] * m_planes[p][2]);
+		if (length > 0)
+		{
+			for (int j = 0; j < 4; j++)
+				m_planes[p][j] /= length;
+		}
+	}
+}
+
+bool XMAFrustum::isSphereVisible(const MinVR::VRPoint3 &center, float radius) const
+{
+	for (int p = 0; p < 6; p++)
+	{
+		if (m_planes[p][0] * center.x + m_planes[p][1] * center.y + m_planes[p][2] * center.z + m_planes[p][3] < -radius)
+			return false;
+	}
+	return true;
+}
+
+bool XMAFrustum::isBoxVisible(const float * min, const float * max) const
+{
+	//the corner furthest along the normal decides
+	for (int p = 0; p < 6; p++)
+	{
+		float x = m_planes[p][0] >= 0 ? max[0] : min[0];
+		float y = m_planes[p][1] >= 0 ? max[1] : min[1];
+		float z = m_planes[p][2] >= 0 ? max[2] : min[2];
+		if (m_planes[p][0] * x + m_planes[p][1] * y + m_planes[p][2] * z + m_planes[p][3] < 0)
+			return false;
+	}
+	return true;
+}
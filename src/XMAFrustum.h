@@ -0,0 +1,23 @@
+#ifndef XMAFRUSTUM_H
+#define XMAFRUSTUM_H
+
+#include <math/VRMath.h>
+
+//The six planes of a view frustum, taken from a projection matrix times a modelview matrix.
+//The planes are in the coordinates the modelview matrix transforms from, so bounding volumes
+//are tested without transforming them first.
+class XMAFrustum
+{
+public:
+	XMAFrustum();
+	XMAFrustum(const MinVR::VRMatrix4 &clip);
+
+	//false if the volume lies completely outside of one of the planes
+	bool isSphereVisible(const MinVR::VRPoint3 &center, float radius) const;
+	bool isBoxVisible(const float * min, const float * max) const;
+
+private:
+	float m_planes[6][4];	//a, b, c, d of a x + b y + c z + d >= 0 inside, with unit normals
+};
+
+#endif //XMAFRUSTUM_H
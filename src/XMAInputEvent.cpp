@@ -0,0 +1,101 @@
+#include "XMAInputEvent.h"
+#include <sstream>
+#include <cstdio>
+
+XMAInputEvent::XMAInputEvent(const std::string &name) : m_name(name)
+{
+}
+
+const std::string &XMAInputEvent::getName() const
+{
+	return m_name;
+}
+
+void XMAInputEvent::setData(const std::string &path, const std::vector<float> &values)
+{
+	for (size_t i = 0; i < m_data.size(); i++)
+	{
+		if (m_data[i].first == path)
+		{
+			m_data[i].second = values;
+			return;
+		}
+	}
+	m_data.push_back(std::make_pair(path, values));
+}
+
+const std::vector<float> * XMAInputEvent::find(const std::string &path) const
+{
+	//events carry only a handful of values, a linear search is enough
+	for (size_t i = 0; i < m_data.size(); i++)
+	{
+		if (m_data[i].first == path)
+			return &m_data[i].second;
+	}
+	return NULL;
+}
+
+bool XMAInputEvent::exists(const std::string &path) const
+{
+	return find(path) != NULL;
+}
+
+double XMAInputEvent::getValue(const std::string &path) const
+{
+	const std::vector<float> * values = find(path);
+	return (values && !values->empty()) ? (*values)[0] : 0.0;
+}
+
+std::vector<float> XMAInputEvent::getDataAsFloatArray(const std::string &field) const
+{
+	const std::vector<float> * values = find("/" + m_name + "/" + field);
+	return values ? *values : std::vector<float>();
+}
+
+float XMAInputEvent::getDataAsFloat(const std::string &field) const
+{
+	return getValue("/" + m_name + "/" + field);
+}
+
+std::string XMAInputEvent::serialize() const
+{
+	//name count [path size values...]*, names and paths of MinVR events contain no spaces
+	std::ostringstream out;
+	out << m_name << " " << m_data.size();
+	char buf[32];
+	for (size_t i = 0; i < m_data.size(); i++)
+	{
+		out << " " << m_data[i].first << " " << m_data[i].second.size();
+		for (size_t v = 0; v < m_data[i].second.size(); v++)
+		{
+			snprintf(buf, sizeof(buf), " %.9g", m_data[i].second[v]);
+			out << buf;
+		}
+	}
+	return out.str();
+}
+
+bool XMAInputEvent::deserialize(const std::string &line)
+{
+	std::istringstream in(line);
+	int count;
+	if (!(in >> m_name >> count))
+		return false;
+
+	m_data.clear();
+	for (int i = 0; i < count; i++)
+	{
+		std::string path;
+		int size;
+		if (!(in >> path >> size))
+			return false;
+		std::vector<float> values(size);
+		for (int v = 0; v < size; v++)
+		{
+			if (!(in >> values[v]))
+				return false;
+		}
+		m_data.push_back(std::make_pair(path, values));
+	}
+	return true;
+}
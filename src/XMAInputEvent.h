@@ -0,0 +1,37 @@
+#ifndef XMAINPUTEVENT_H
+#define XMAINPUTEVENT_H
+
+#include <string>
+#include <vector>
+#include <utility>
+
+//Copy of the parts of a VREvent the application reads: its name and the values of some data
+//paths. Unlike a VREvent it can be written to a file and created again for a replay.
+class XMAInputEvent
+{
+public:
+	XMAInputEvent(const std::string &name = "");
+
+	const std::string &getName() const;
+
+	//paths are absolute, e.g. /HTC_Controller_Right/Pose
+	void setData(const std::string &path, const std::vector<float> &values);
+	bool exists(const std::string &path) const;
+	double getValue(const std::string &path) const;
+
+	//fields are relative to the event name, as in VREvent
+	std::vector<float> getDataAsFloatArray(const std::string &field) const;
+	float getDataAsFloat(const std::string &field) const;
+
+	//one line of text, without the line break
+	std::string serialize() const;
+	bool deserialize(const std::string &line);
+
+private:
+	const std::vector<float> * find(const std::string &path) const;
+
+	std::string m_name;
+	std::vector<std::pair<std::string, std::vector<float> > > m_data;
+};
+
+#endif //XMAINPUTEVENT_H
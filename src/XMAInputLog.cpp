@@ -0,0 +1,118 @@
+#include "XMAInputLog.h"
+#include <fstream>
+#include <sstream>
+#include <iostream>
+
+#define INPUT_LOG_HEADER "# XROMM input log 1"
+
+XMAInputLog::XMAInputLog() : m_file(NULL), m_replaying(false), m_replayPos(0)
+{
+}
+
+XMAInputLog::~XMAInputLog()
+{
+	stopRecording();
+}
+
+bool XMAInputLog::startRecording(const std::string &filename)
+{
+	stopRecording();
+	m_file = fopen(filename.c_str(), "w");
+	if (!m_file)
+	{
+		std::cerr << "Could not record input to " << filename << std::endl;
+		return false;
+	}
+	fprintf(m_file, "%s\n", INPUT_LOG_HEADER);
+	m_start = std::chrono::steady_clock::now();
+	std::cerr << "Recording input to " << filename << std::endl;
+	return true;
+}
+
+void XMAInputLog::stopRecording()
+{
+	if (m_file)
+	{
+		fclose(m_file);
+		m_file = NULL;
+	}
+}
+
+bool XMAInputLog::isRecording()
+{
+	return m_file != NULL;
+}
+
+void XMAInputLog::record(int frame, const XMAInputEvent &event)
+{
+	if (!m_file)
+		return;
+	double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+	fprintf(m_file, "%d %.6f %s\n", frame, time, event.serialize().c_str());
+}
+
+bool XMAInputLog::loadReplay(const std::string &filename)
+{
+	std::ifstream in(filename.c_str());
+	if (!in)
+	{
+		std::cerr << "Could not open the input log " << filename << std::endl;
+		return false;
+	}
+
+	m_replay.clear();
+	m_replayPos = 0;
+	std::string line;
+	int lineNumber = 0;
+	while (std::getline(in, line))
+	{
+		lineNumber++;
+		if (line.empty() || line[0] == '#')
+			continue;
+
+		std::istringstream fields(line);
+		Entry entry;
+		std::string rest;
+		if (!(fields >> entry.frame >> entry.time) || !std::getline(fields, rest) || !entry.event.deserialize(rest))
+		{
+			std::cerr << "Invalid input log " << filename << " at line " << lineNumber << std::endl;
+			m_replay.clear();
+			return false;
+		}
+		m_replay.push_back(entry);
+	}
+
+	m_replaying = true;
+	std::cerr << "Replaying " << m_replay.size() << " events over " << getReplayFrames() << " frames from " << filename << std::endl;
+	return true;
+}
+
+bool XMAInputLog::isReplaying()
+{
+	return m_replaying;
+}
+
+void XMAInputLog::stopReplay()
+{
+	m_replaying = false;
+	m_replay.clear();
+	m_replayPos = 0;
+}
+
+bool XMAInputLog::next(int frame, XMAInputEvent &event)
+{
+	if (!m_replaying || m_replayPos >= m_replay.size() || m_replay[m_replayPos].frame > frame)
+		return false;
+	event = m_replay[m_replayPos++].event;
+	return true;
+}
+
+bool XMAInputLog::isReplayFinished()
+{
+	return m_replaying && m_replayPos >= m_replay.size();
+}
+
+int XMAInputLog::getReplayFrames()
+{
+	return m_replay.empty() ? 0 : m_replay.back().frame;
+}
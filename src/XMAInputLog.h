@@ -0,0 +1,48 @@
+#ifndef XMAINPUTLOG_H
+#define XMAINPUTLOG_H
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdio>
+#include "XMAInputEvent.h"
+
+//Records the input events of a session with the frame and time they arrived at, and plays
+//a recording back. A replay hands out the events of a frame before that frame is drawn, so a
+//session replayed against the same trial runs through the same states as when it was recorded.
+class XMAInputLog
+{
+public:
+	XMAInputLog();
+	~XMAInputLog();
+
+	bool startRecording(const std::string &filename);
+	void stopRecording();
+	bool isRecording();
+	void record(int frame, const XMAInputEvent &event);
+
+	bool loadReplay(const std::string &filename);
+	bool isReplaying();
+	void stopReplay();
+	//returns the next event recorded at or before the frame, false if there is none left for it
+	bool next(int frame, XMAInputEvent &event);
+	bool isReplayFinished();
+	int getReplayFrames();
+
+private:
+	struct Entry
+	{
+		int frame;
+		double time;
+		XMAInputEvent event;
+	};
+
+	FILE * m_file;
+	std::chrono::steady_clock::time_point m_start;
+
+	bool m_replaying;
+	std::vector<Entry> m_replay;
+	size_t m_replayPos;
+};
+
+#endif //XMAINPUTLOG_H
@@ -0,0 +1,198 @@
+#include "XMAInterpenetration.h"
+#include "XMAObject.h"
+#include "XMABVH.h"
+#include "XMATransformTrack.h"
+#include "XMAAnalysis.h"
+#include "VRTraceRecorder.h"
+#include "VRMemoryTracker.h"
+#include <algorithm>
+
+static int memoryCategory()
+{
+	static int category = VRMemoryTracker::getInstance()->addCategory("Interpenetration");
+	return category;
+}
+
+XMAInterpenetration::XMAInterpenetration(const std::vector<XMAObject*> &objects, int numFrames, double skipValue) : m_objects(objects),
+	m_numFrames(numFrames), m_skipValue(skipValue), m_penetratingFrames(0), m_nextBlock(0), m_testedFrames(0), m_running(0), m_stop(false), m_finished(false)
+{
+	m_series.resize(numFrames, 0.0);
+	m_penetrating.resize(numFrames, 0);
+	m_boneA.resize(numFrames, -1);
+	m_boneB.resize(numFrames, -1);
+	m_bytes = numFrames * (sizeof(double) + sizeof(unsigned char) + 2 * sizeof(int));
+	VRMemoryTracker::getInstance()->allocate(memoryCategory(), m_bytes);
+}
+
+XMAInterpenetration::~XMAInterpenetration()
+{
+	m_stop = true;
+	for (size_t i = 0; i < m_workers.size(); i++)
+	{
+		if (m_workers[i].joinable())
+			m_workers[i].join();
+	}
+	VRMemoryTracker::getInstance()->release(memoryCategory(), m_bytes);
+}
+
+void XMAInterpenetration::start(int threads)
+{
+	int blocks = (m_numFrames + TRACK_PAGE_FRAMES - 1) / TRACK_PAGE_FRAMES;
+	if (threads <= 0)
+		threads = (int)std::thread::hardware_concurrency() - 1;
+	if (threads > blocks)
+		threads = blocks;
+	if (threads < 1)
+		threads = 1;
+
+	m_running = threads;
+	for (int i = 0; i < threads; i++)
+		m_workers.push_back(std::thread(&XMAInterpenetration::work, this));
+}
+
+bool XMAInterpenetration::isFinished()
+{
+	return m_finished;
+}
+
+float XMAInterpenetration::getProgress()
+{
+	return (m_numFrames > 0) ? (float)m_testedFrames / m_numFrames : 1.0f;
+}
+
+const std::vector<double> &XMAInterpenetration::getSeries()
+{
+	return m_series;
+}
+
+const std::vector<XMAInterpenetration::Event> &XMAInterpenetration::getEvents()
+{
+	return m_events;
+}
+
+int XMAInterpenetration::getPenetratingFrames()
+{
+	return m_penetratingFrames;
+}
+
+void XMAInterpenetration::work()
+{
+	VRTraceRecorder::getInstance()->setThreadName("Interpenetration");
+	int count = m_objects.size();
+	std::vector<float> matrices(16 * TRACK_PAGE_FRAMES * count);
+	std::vector<unsigned char> visible(TRACK_PAGE_FRAMES * count);
+	while (!m_stop)
+	{
+		int first = TRACK_PAGE_FRAMES * m_nextBlock++;
+		if (first >= m_numFrames)
+			break;
+		int frames = std::min(TRACK_PAGE_FRAMES, m_numFrames - first);
+
+		{
+			VRTraceRecorder::Scope trace("Read poses");
+			//the poses of a block are read bone by bone, past the pages kept for playback
+			for (int o = 0; o < count; o++)
+				m_objects[o]->getTrack()->readRange(first, frames, &matrices[16 * o * TRACK_PAGE_FRAMES], &visible[o * TRACK_PAGE_FRAMES]);
+		}
+
+		VRTraceRecorder::Scope trace("Test frames");
+		for (int f = 0; f < frames && !m_stop; f++)
+		{
+			testFrame(first + f, matrices, visible, f);
+			m_testedFrames++;
+		}
+	}
+
+	//the last worker collects the events
+	if (--m_running == 0 && !m_stop)
+	{
+		findEvents();
+		m_finished = true;
+	}
+}
+
+void XMAInterpenetration::testFrame(int frame, const std::vector<float> &matrices, const std::vector<unsigned char> &visible, int offset)
+{
+	int count = m_objects.size();
+	std::vector<int> bones;
+	std::vector<float> centers;
+	for (int o = 0; o < count; o++)
+	{
+		if (!visible[o * TRACK_PAGE_FRAMES + offset] || !m_objects[o]->getBVH())
+			continue;
+		MinVR::VRPoint3 c = m_objects[o]->getCenter();
+		float local[3] = { c.x, c.y, c.z };
+		float world[3];
+		XMAAnalysis::transformPoint(&matrices[16 * (o * TRACK_PAGE_FRAMES + offset)], local, world);
+		bones.push_back(o);
+		centers.insert(centers.end(), world, world + 3);
+	}
+	if (bones.size() < 2)
+	{
+		m_series[frame] = m_skipValue;
+		return;
+	}
+
+	float deepest = 0.0f;
+	for (size_t i = 0; i < bones.size(); i++)
+	{
+		const float * poseA = &matrices[16 * (bones[i] * TRACK_PAGE_FRAMES + offset)];
+		float inverseA[16];
+		bool inverted = false;
+		for (size_t j = i + 1; j < bones.size(); j++)
+		{
+			//bones are adjacent if their bounding spheres overlap
+			float dx = centers[3 * i] - centers[3 * j];
+			float dy = centers[3 * i + 1] - centers[3 * j + 1];
+			float dz = centers[3 * i + 2] - centers[3 * j + 2];
+			float radii = m_objects[bones[i]]->getRadius() + m_objects[bones[j]]->getRadius();
+			if (dx * dx + dy * dy + dz * dz >= radii * radii)
+				continue;
+
+			if (!inverted && !(inverted = XMAAnalysis::invert(poseA, inverseA)))
+				break;
+			float relative[16];
+			XMAAnalysis::multiply(inverseA, &matrices[16 * (bones[j] * TRACK_PAGE_FRAMES + offset)], relative);
+			float depth;
+			if (!m_objects[bones[i]]->getBVH()->intersect(*m_objects[bones[j]]->getBVH(), relative, &depth))
+				continue;
+			if (!m_penetrating[frame] || depth > deepest)
+			{
+				deepest = depth;
+				m_boneA[frame] = bones[i];
+				m_boneB[frame] = bones[j];
+			}
+			m_penetrating[frame] = 1;
+		}
+	}
+	m_series[frame] = deepest;
+}
+
+void XMAInterpenetration::findEvents()
+{
+	m_events.clear();
+	m_penetratingFrames = 0;
+	for (int frame = 0; frame < m_numFrames; frame++)
+	{
+		if (!m_penetrating[frame])
+			continue;
+		m_penetratingFrames++;
+		if (m_events.empty() || m_events.back().last != frame - 1)
+		{
+			Event event = { frame, frame, frame, m_boneA[frame], m_boneB[frame], (float)m_series[frame] };
+			m_events.push_back(event);
+			continue;
+		}
+		Event &event = m_events.back();
+		event.last = frame;
+		if (m_series[frame] > event.depth)
+		{
+			event.frame = frame;
+			event.boneA = m_boneA[frame];
+			event.boneB = m_boneB[frame];
+			event.depth = m_series[frame];
+		}
+	}
+	m_bytes += m_events.capacity() * sizeof(Event);
+	VRMemoryTracker::getInstance()->allocate(memoryCategory(), m_events.capacity() * sizeof(Event));
+}
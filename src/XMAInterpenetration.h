@@ -0,0 +1,71 @@
+#ifndef XMAINTERPENETRATION_H
+#define XMAINTERPENETRATION_H
+
+#include <vector>
+#include <thread>
+#include <atomic>
+
+class XMAObject;
+
+//Finds the frames of a trial in which bones penetrate each other, on background threads. Workers
+//take blocks of TRACK_PAGE_FRAMES frames. In every frame the bones whose bounding spheres overlap
+//are adjacent, and the bounding volume hierarchies of each adjacent pair are tested for crossing
+//triangles in the relative pose of the two bones. The results can be read once isFinished is true.
+class XMAInterpenetration
+{
+public:
+	//a run of consecutive frames with penetrating bones
+	struct Event
+	{
+		int first;
+		int last;
+		//deepest frame of the run and the pair penetrating deepest in it
+		int frame;
+		int boneA;
+		int boneB;
+		float depth;
+	};
+
+	//the objects have to stay loaded until the check is finished or deleted
+	XMAInterpenetration(const std::vector<XMAObject*> &objects, int numFrames, double skipValue);
+	//stops the workers after the frame they are testing
+	~XMAInterpenetration();
+
+	//0 threads uses all cores but one, which is left to rendering
+	void start(int threads = 0);
+	bool isFinished();
+	//fraction of the frames tested
+	float getProgress();
+
+	//deepest penetration per frame, 0 for frames without one and the skip value for frames
+	//in which fewer than two bones are visible
+	const std::vector<double> &getSeries();
+	const std::vector<Event> &getEvents();
+	int getPenetratingFrames();
+
+private:
+	void work();
+	void testFrame(int frame, const std::vector<float> &matrices, const std::vector<unsigned char> &visible, int offset);
+	void findEvents();
+
+	std::vector<XMAObject*> m_objects;
+	int m_numFrames;
+	double m_skipValue;
+
+	std::vector<double> m_series;
+	std::vector<unsigned char> m_penetrating;
+	std::vector<int> m_boneA;	//deepest pair per frame
+	std::vector<int> m_boneB;
+	std::vector<Event> m_events;
+	int m_penetratingFrames;
+	long long m_bytes;
+
+	std::atomic<int> m_nextBlock;
+	std::atomic<int> m_testedFrames;
+	std::atomic<int> m_running;
+	std::atomic<bool> m_stop;
+	std::atomic<bool> m_finished;
+	std::vector<std::thread> m_workers;
+};
+
+#endif //XMAINTERPENETRATION_H
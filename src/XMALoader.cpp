@@ -0,0 +1,133 @@
+#include "XMALoader.h"
+#include "XMAObject.h"
+#include "VRTraceRecorder.h"
+#include <algorithm>
+
+XMALoader::XMALoader(const std::string &directory, float scale, float weldEpsilon) : m_directory(directory), m_scale(scale), m_weldEpsilon(weldEpsilon),
+	m_next(0), m_loaded(0), m_taken(0), m_stop(false)
+{
+}
+
+XMALoader::~XMALoader()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	wait();
+	for (size_t i = 0; i < m_entries.size(); i++)
+	{
+		if (m_entries[i].state != TAKEN)
+			delete m_entries[i].object;
+	}
+}
+
+bool XMALoader::start(int threads)
+{
+	std::vector<XMAManifestEntry> bones;
+	if (!XMAManifest::read(m_directory, bones))
+		return false;
+	for (size_t i = 0; i < bones.size(); i++)
+	{
+		Entry entry;
+		entry.bone = bones[i];
+		entry.state = WAITING;
+		entry.object = NULL;
+		m_entries.push_back(entry);
+		m_order.push_back(i);
+	}
+	std::stable_sort(m_order.begin(), m_order.end(), [this](size_t a, size_t b) { return m_entries[a].bone.priority > m_entries[b].bone.priority; });
+
+	if (threads <= 0)
+		threads = std::thread::hardware_concurrency();
+	if (threads > (int)m_entries.size())
+		threads = m_entries.size();
+	if (threads < 1)
+		threads = 1;
+	for (int i = 0; i < threads; i++)
+		m_workers.push_back(std::thread(&XMALoader::work, this));
+	return true;
+}
+
+void XMALoader::wait()
+{
+	for (size_t i = 0; i < m_workers.size(); i++)
+	{
+		if (m_workers[i].joinable())
+			m_workers[i].join();
+	}
+}
+
+void XMALoader::work()
+{
+	VRTraceRecorder::getInstance()->setThreadName("Loader");
+	while (true)
+	{
+		size_t i;
+		XMAManifestEntry bone;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (m_stop || m_next >= m_order.size())
+				return;
+			i = m_order[m_next++];
+			m_entries[i].state = LOADING;
+			bone = m_entries[i].bone;
+		}
+
+		XMAObject * object = new XMAObject(bone, m_scale, m_weldEpsilon);
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_entries[i].object = object;
+		m_entries[i].state = LOADED;
+		m_loaded++;
+	}
+}
+
+std::vector<int> XMALoader::takeLoaded(std::vector<XMAObject*> &objects)
+{
+	std::vector<int> taken;
+	objects.resize(m_entries.size(), NULL);
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (size_t i = 0; i < m_entries.size(); i++)
+	{
+		if (m_entries[i].state != LOADED)
+			continue;
+		objects[i] = m_entries[i].object;
+		m_entries[i].state = TAKEN;
+		taken.push_back(i);
+		m_taken++;
+	}
+	return taken;
+}
+
+bool XMALoader::isFinished()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_taken >= (int)m_entries.size();
+}
+
+int XMALoader::getCount()
+{
+	return m_entries.size();
+}
+
+int XMALoader::getLoaded()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_loaded;
+}
+
+std::vector<std::string> XMALoader::getLoading()
+{
+	std::vector<std::string> names;
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (size_t i = 0; i < m_entries.size(); i++)
+	{
+		if (m_entries[i].state != LOADING)
+			continue;
+		const std::string &objFile = m_entries[i].bone.objFile;
+		size_t sep = objFile.find_last_of("\\/");
+		names.push_back(sep == std::string::npos ? objFile : objFile.substr(sep + 1));
+	}
+	return names;
+}
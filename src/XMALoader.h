@@ -0,0 +1,68 @@
+#ifndef XMALOADER_H
+#define XMALOADER_H
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+
+#include "XMAManifest.h"
+
+class XMAObject;
+
+//Loads the bones listed in the manifest of a trial on background threads. The meshes are read,
+//simplified and the transformations parsed by the workers, the application takes each bone as
+//soon as it is finished and uploads its display lists on its OpenGL thread.
+//Workers start the bones with the highest priority first, bones of the same priority in order.
+class XMALoader
+{
+public:
+	XMALoader(const std::string &directory, float scale = 1.0, float weldEpsilon = 0.0);
+	//stops the workers after the bones they are loading, bones which were not taken are deleted
+	~XMALoader();
+
+	//reads the manifest and starts the workers, 0 threads uses one per core. Returns false if
+	//there is nothing to load.
+	bool start(int threads = 0);
+	//blocks until all bones are loaded
+	void wait();
+
+	//puts the bones loaded since the last call into objects at their index in the manifest. objects
+	//gets a slot for every bone, the slots of bones which are not taken yet are NULL. Returns the
+	//indices of the bones taken
+	std::vector<int> takeLoaded(std::vector<XMAObject*> &objects);
+	//true once all bones were taken
+	bool isFinished();
+
+	int getCount();
+	int getLoaded();
+	//names of the bones the workers are loading
+	std::vector<std::string> getLoading();
+
+private:
+	enum State { WAITING, LOADING, LOADED, TAKEN };
+
+	struct Entry
+	{
+		XMAManifestEntry bone;
+		State state;
+		XMAObject * object;
+	};
+
+	void work();
+
+	std::string m_directory;
+	float m_scale;
+	float m_weldEpsilon;
+
+	std::vector<Entry> m_entries;
+	std::vector<size_t> m_order;	//entries by priority
+	size_t m_next;		//next entry of m_order a worker loads
+	int m_loaded;
+	int m_taken;		//bones handed to the application
+	bool m_stop;
+	std::mutex m_mutex;
+	std::vector<std::thread> m_workers;
+};
+
+#endif //XMALOADER_H
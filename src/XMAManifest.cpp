@@ -0,0 +1,239 @@
+#include "XMAManifest.h"
+#include "tinyxml2.h"
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <cstdio>
+#include <cstdlib>
+#include <cctype>
+
+#define MANIFEST_COLUMNS 7
+static const char * columns[MANIFEST_COLUMNS] = { "obj", "transformation", "scale", "color", "lod", "binary", "priority" };
+
+static bool fileExists(const std::string &filename)
+{
+	FILE * file = fopen(filename.c_str(), "r");
+	if (!file)
+		return false;
+	fclose(file);
+	return true;
+}
+
+static std::string lowerCase(std::string s)
+{
+	for (size_t i = 0; i < s.size(); i++)
+		s[i] = tolower((unsigned char)s[i]);
+	return s;
+}
+
+static void initEntry(XMAManifestEntry &entry, int line)
+{
+	entry.scale = 1.0f;
+	entry.hasColor = false;
+	entry.color[0] = entry.color[1] = entry.color[2] = 1.0f;
+	entry.priority = 0;
+	entry.line = line;
+}
+
+bool XMAManifest::read(const std::string &directory, std::vector<XMAManifestEntry> &entries)
+{
+	entries.clear();
+	if (fileExists(directory + "Data.xml"))
+		return readXML(directory, directory + "Data.xml", entries);
+	return readCSV(directory, directory + "Data.csv", entries);
+}
+
+bool XMAManifest::readCSV(const std::string &directory, const std::string &filename, std::vector<XMAManifestEntry> &entries)
+{
+	std::ifstream in(filename.c_str());
+	if (!in)
+	{
+		std::cerr << "Could not open " << filename << std::endl;
+		return false;
+	}
+
+	std::vector<std::string> header(columns, columns + MANIFEST_COLUMNS);
+	std::string line;
+	int lineNumber = 0;
+	while (std::getline(in, line))
+	{
+		lineNumber++;
+		//skip a byte order mark left by spreadsheet programs
+		if (lineNumber == 1 && line.compare(0, 3, "\xEF\xBB\xBF") == 0)
+			line = line.substr(3);
+		if (!line.empty() && line[line.size() - 1] == '\r')
+			line.erase(line.size() - 1);
+		if (line.find_first_not_of(" \t") == std::string::npos || line[line.find_first_not_of(" \t")] == '#')
+			continue;
+
+		std::vector<std::string> fields = splitLine(line);
+		if (entries.empty() && lowerCase(fields[0]) == "obj")
+		{
+			header.clear();
+			for (size_t i = 0; i < fields.size(); i++)
+				header.push_back(lowerCase(fields[i]));
+			continue;
+		}
+
+		XMAManifestEntry entry;
+		initEntry(entry, lineNumber);
+		bool valid = true;
+		for (size_t i = 0; i < fields.size() && i < header.size(); i++)
+		{
+			if (!fields[i].empty() && !setField(entry, header[i], fields[i], directory))
+			{
+				std::cerr << "Invalid " << header[i] << " \"" << fields[i] << "\" in " << filename << " at line " << lineNumber << std::endl;
+				valid = false;
+			}
+		}
+		if (entry.objFile.empty() || entry.transformationFile.empty())
+		{
+			std::cerr << "Missing obj or transformation in " << filename << " at line " << lineNumber << std::endl;
+			continue;
+		}
+		if (valid)
+			entries.push_back(entry);
+	}
+	return !entries.empty();
+}
+
+bool XMAManifest::readXML(const std::string &directory, const std::string &filename, std::vector<XMAManifestEntry> &entries)
+{
+	tinyxml2::XMLDocument doc;
+	if (doc.LoadFile(filename.c_str()) != tinyxml2::XML_SUCCESS)
+	{
+		std::cerr << "Could not read " << filename << std::endl;
+		return false;
+	}
+
+	//bones are numbered from 1 in the messages, tinyxml2 does not keep line numbers
+	tinyxml2::XMLElement * root = doc.FirstChildElement();
+	int number = 0;
+	for (tinyxml2::XMLElement * bone = root ? root->FirstChildElement("Bone") : NULL; bone; bone = bone->NextSiblingElement("Bone"))
+	{
+		XMAManifestEntry entry;
+		initEntry(entry, ++number);
+		bool valid = true;
+		for (const tinyxml2::XMLAttribute * attribute = bone->FirstAttribute(); attribute; attribute = attribute->Next())
+		{
+			std::string column = lowerCase(attribute->Name());
+			if (!setField(entry, column, attribute->Value(), directory))
+			{
+				std::cerr << "Invalid " << column << " \"" << attribute->Value() << "\" in " << filename << " at bone " << entry.line << std::endl;
+				valid = false;
+			}
+		}
+		if (entry.objFile.empty() || entry.transformationFile.empty())
+		{
+			std::cerr << "Missing obj or transformation in " << filename << " at bone " << entry.line << std::endl;
+			continue;
+		}
+		if (valid)
+			entries.push_back(entry);
+	}
+	return !entries.empty();
+}
+
+bool XMAManifest::setField(XMAManifestEntry &entry, const std::string &column, const std::string &value, const std::string &directory)
+{
+	char * end;
+	if (value.empty())
+		return true;
+	if (column == "obj")
+		entry.objFile = resolve(directory, value);
+	else if (column == "transformation")
+		entry.transformationFile = resolve(directory, value);
+	else if (column == "binary")
+		entry.binaryFile = resolve(directory, value);
+	else if (column == "lod")
+	{
+		entry.lodDirectory = resolve(directory, value);
+		char last = entry.lodDirectory[entry.lodDirectory.size() - 1];
+		if (last != '/' && last != '\\')
+			entry.lodDirectory += "/";
+	}
+	else if (column == "scale")
+	{
+		entry.scale = strtod(value.c_str(), &end);
+		return *end == '\0' && entry.scale > 0;
+	}
+	else if (column == "priority")
+	{
+		entry.priority = strtol(value.c_str(), &end, 10);
+		return *end == '\0';
+	}
+	else if (column == "color")
+	{
+		if (value[0] == '#')
+		{
+			unsigned long rgb = strtoul(value.c_str() + 1, &end, 16);
+			if (value.size() != 7 || *end != '\0')
+				return false;
+			for (int k = 0; k < 3; k++)
+				entry.color[k] = ((rgb >> (16 - 8 * k)) & 0xff) / 255.0f;
+		}
+		else
+		{
+			std::istringstream rgb(value);
+			std::string rest;
+			if (!(rgb >> entry.color[0] >> entry.color[1] >> entry.color[2]) || (rgb >> rest))
+				return false;
+		}
+		entry.hasColor = true;
+	}
+	else
+	{
+		std::cerr << "Unknown column " << column << " in the manifest is ignored" << std::endl;
+	}
+	return true;
+}
+
+std::vector<std::string> XMAManifest::splitLine(const std::string &line)
+{
+	std::vector<std::string> fields(1);
+	bool quoted = false;
+	bool wasQuoted = false;
+	for (size_t i = 0; i < line.size(); i++)
+	{
+		char c = line[i];
+		if (quoted)
+		{
+			//a doubled quote within quotes is a quote
+			if (c == '"' && i + 1 < line.size() && line[i + 1] == '"')
+				fields.back() += line[++i];
+			else if (c == '"')
+				quoted = false;
+			else
+				fields.back() += c;
+		}
+		else if (c == '"' && fields.back().find_first_not_of(" \t") == std::string::npos)
+		{
+			fields.back().clear();
+			quoted = true;
+			wasQuoted = true;
+		}
+		else if (c == ',')
+		{
+			fields.push_back("");
+			wasQuoted = false;
+		}
+		else if (!wasQuoted)
+		{
+			fields.back() += c;
+		}
+	}
+
+	for (size_t i = 0; i < fields.size(); i++)
+	{
+		size_t first = fields[i].find_first_not_of(" \t");
+		size_t last = fields[i].find_last_not_of(" \t");
+		fields[i] = (first == std::string::npos) ? "" : fields[i].substr(first, last - first + 1);
+	}
+	return fields;
+}
+
+std::string XMAManifest::resolve(const std::string &directory, const std::string &path)
+{
+	bool absolute = path[0] == '/' || path[0] == '\\' || (path.size() > 1 && path[1] == ':');
+	return absolute ? path : directory + path;
+}
@@ -0,0 +1,54 @@
+#ifndef XMAMANIFEST_H
+#define XMAMANIFEST_H
+
+#include <string>
+#include <vector>
+
+//One bone of a trial. Relative paths of the manifest are resolved against the trial directory,
+//optional paths are empty when the manifest does not give them.
+struct XMAManifestEntry
+{
+	std::string objFile;
+	std::string transformationFile;
+	//binary copy of the transformations, read instead of the csv when it is up to date and
+	//written from the csv otherwise
+	std::string binaryFile;
+	//directory of the cached detail levels, next to the mesh if empty
+	std::string lodDirectory;
+	//multiplied with the scale of the trial
+	float scale;
+	bool hasColor;
+	float color[3];
+	//bones with a higher priority are loaded first
+	int priority;
+	//line of Data.csv or number of the Bone element of Data.xml
+	int line;
+};
+
+//Reads the list of bones of a trial. Data.xml is read if the trial has one, otherwise Data.csv.
+//
+//Data.csv has one bone per line. The columns are obj, transformation, scale, color, lod, binary
+//and priority in this order, and only the first two are required. A first line starting with
+//"obj" names the columns instead, so they can be given in any order and left out. Fields are
+//trimmed and can be quoted, so paths may contain spaces and, when quoted, commas. Colours are
+//given as #rrggbb or as three numbers between 0 and 1 separated by spaces. Lines starting
+//with # are comments.
+//
+//Data.xml has a Bone element per bone with the column names as attributes, e.g.
+//<Trial><Bone obj="Radius.obj" transformation="Radius.csv" color="#e0d0b0" priority="1"/></Trial>
+class XMAManifest
+{
+public:
+	//returns false if there is no manifest or it has errors, the errors are printed
+	static bool read(const std::string &directory, std::vector<XMAManifestEntry> &entries);
+
+private:
+	static bool readCSV(const std::string &directory, const std::string &filename, std::vector<XMAManifestEntry> &entries);
+	static bool readXML(const std::string &directory, const std::string &filename, std::vector<XMAManifestEntry> &entries);
+	//sets a column of the entry, returns false if the value is invalid
+	static bool setField(XMAManifestEntry &entry, const std::string &column, const std::string &value, const std::string &directory);
+	static std::vector<std::string> splitLine(const std::string &line);
+	static std::string resolve(const std::string &directory, const std::string &path);
+};
+
+#endif //XMAMANIFEST_H
@@ -0,0 +1,353 @@
+#include "XMAMesh.h"
+#include "glm.h"
+#include "VRTraceRecorder.h"
+#include "VRMemoryTracker.h"
+#include "XMABVH.h"
+#include <iostream>
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <functional>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+//meshes by key, NULL while a thread is loading the mesh
+static std::map<std::string, XMAMesh*> registry;
+static std::mutex registryMutex;
+static std::condition_variable registryLoaded;
+
+static int memoryCategory()
+{
+	static int category = VRMemoryTracker::getInstance()->addCategory("Meshes");
+	return category;
+}
+
+//64 bit FNV-1a hash of the file, with the scale and weld epsilon the mesh is loaded with.
+//Unreadable files are keyed by their path.
+static std::string meshKey(const std::string &obj_file, float scale, float weldEpsilon)
+{
+	char key[96];
+	FILE * file = fopen(obj_file.c_str(), "rb");
+	if (!file)
+		return obj_file;
+
+	unsigned long long hash = 14695981039346656037ULL;
+	unsigned char buf[65536];
+	size_t size;
+	while ((size = fread(buf, 1, sizeof(buf), file)) > 0)
+	{
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= buf[i];
+			hash *= 1099511628211ULL;
+		}
+	}
+	fclose(file);
+	snprintf(key, sizeof(key), "%016llx %.9g %.9g", hash, scale, weldEpsilon);
+	return key;
+}
+
+//the level is read from the cache next to the mesh if it is newer than the mesh, otherwise
+//it is simplified from the next finer level and written to the cache
+static GLMmodel* loadLevel(const std::string &obj_file, const std::string &filename, GLMmodel* finer, GLuint numtriangles)
+{
+	struct stat source, cached;
+	if (stat(obj_file.c_str(), &source) == 0 && stat(filename.c_str(), &cached) == 0 && cached.st_mtime >= source.st_mtime)
+		return glmReadOBJ((char*)filename.c_str());
+
+	GLMmodel* lod = glmSimplify(finer, numtriangles);
+	//written under a name of this process and thread and then moved into place, so that
+	//loaders of the same mesh never read a partially written level
+	std::string temporary = filename + "." + std::to_string((long long)getpid()) + "_"
+		+ std::to_string((unsigned long long)std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+	//glmWriteOBJ exits if it cannot open the file, read-only directories are not cached
+	FILE* file = fopen(temporary.c_str(), "w");
+	if (file)
+	{
+		fclose(file);
+		glmWriteOBJ(lod, (char*)temporary.c_str(), GLM_NONE);
+		//rename does not replace an existing file on Windows
+		if (rename(temporary.c_str(), filename.c_str()) != 0 && (remove(filename.c_str()) != 0 || rename(temporary.c_str(), filename.c_str()) != 0))
+			remove(temporary.c_str());
+	}
+	return lod;
+}
+
+XMAMesh * XMAMesh::acquire(const std::string &obj_file, float scale, float weldEpsilon, const std::string &lodDirectory)
+{
+	std::string key = meshKey(obj_file, scale, weldEpsilon);
+	{
+		std::unique_lock<std::mutex> lock(registryMutex);
+		std::map<std::string, XMAMesh*>::iterator it = registry.find(key);
+		if (it != registry.end())
+		{
+			while (!it->second)
+				registryLoaded.wait(lock);
+			XMAMesh * mesh = it->second;
+			mesh->references++;
+			std::cerr << "Shared mesh " << obj_file << std::endl;
+			return mesh;
+		}
+		registry[key] = NULL;
+	}
+
+	XMAMesh * mesh = new XMAMesh(obj_file, scale, weldEpsilon, lodDirectory);
+	mesh->key = key;
+	{
+		std::lock_guard<std::mutex> lock(registryMutex);
+		registry[key] = mesh;
+	}
+	registryLoaded.notify_all();
+	return mesh;
+}
+
+void XMAMesh::release(XMAMesh * mesh)
+{
+	if (!mesh)
+		return;
+	{
+		std::lock_guard<std::mutex> lock(registryMutex);
+		if (--mesh->references > 0)
+			return;
+		registry.erase(mesh->key);
+	}
+	delete mesh;
+}
+
+int XMAMesh::getShared()
+{
+	std::lock_guard<std::mutex> lock(registryMutex);
+	return registry.size();
+}
+
+XMAMesh::XMAMesh(const std::string &obj_file, float scale, float weldEpsilon, const std::string &lodDirectory) : uploadTriangle(0), radius(0), bvh(NULL), cpuBytes(0), gpuBytes(0), references(1)
+{
+	VRTraceRecorder::Scope trace("XMAMesh");
+
+	GLMmodel* pmodel = glmReadOBJ((char*) obj_file.c_str());
+
+	//glmUnitize(pmodel);
+	if (weldEpsilon > 0)
+	{
+		GLuint numvertices = pmodel->numvertices;
+		glmWeld(pmodel, weldEpsilon);
+		std::cerr << "Welded " << numvertices << " to " << pmodel->numvertices << " vertices" << std::endl;
+	}
+
+	models.push_back(pmodel);
+	for (int l = 1; l < XMA_LOD_LEVELS; l++)
+	{
+		GLuint numtriangles = pmodel->numtriangles >> (2 * l);
+		if (numtriangles < XMA_LOD_MIN_TRIANGLES)
+			break;
+		GLMmodel* lod = loadLevel(obj_file, getLevelFilename(obj_file, lodDirectory, weldEpsilon, l), models.back(), numtriangles);
+		//meshes which hardly simplify, e.g. triangle soups, get no further levels
+		if (lod->numtriangles > models.back()->numtriangles * 3 / 4)
+		{
+			glmDelete(lod);
+			break;
+		}
+		models.push_back(lod);
+	}
+
+	for (size_t l = 0; l < models.size(); l++)
+	{
+		glmFacetNormals(models[l]);
+		glmVertexNormals(models[l], 90.0);
+		glmScale(models[l], scale);
+		triangles.push_back(models[l]->numtriangles);
+		cpuBytes += glmSize(models[l]);
+	}
+
+	//the hierarchy for collision tests is built over the finest level as a triangle soup
+	std::vector<float> soup(9 * pmodel->numtriangles);
+	for (GLuint t = 0; t < pmodel->numtriangles; t++)
+	{
+		for (int v = 0; v < 3; v++)
+		{
+			for (int k = 0; k < 3; k++)
+				soup[9 * t + 3 * v + k] = pmodel->vertices[3 * pmodel->triangles[t].vindices[v] + k];
+		}
+	}
+	bvh = new XMABVH(soup.empty() ? NULL : &soup[0], pmodel->numtriangles);
+	cpuBytes += bvh->getBytes();
+	VRMemoryTracker::getInstance()->allocate(memoryCategory(), cpuBytes);
+	displayLists.resize(models.size(), 0);
+	uploadLevel = models.size() - 1;
+	finestLevel = models.size();
+	std::cerr << "Levels of detail:";
+	for (size_t l = 0; l < triangles.size(); l++)
+		std::cerr << " " << triangles[l];
+	std::cerr << " triangles" << std::endl;
+
+	//bounding sphere around the center of the bounding box
+	float min[3] = { pmodel->vertices[3], pmodel->vertices[4], pmodel->vertices[5] };
+	float max[3] = { min[0], min[1], min[2] };
+	for (GLuint i = 1; i <= pmodel->numvertices; i++)
+	{
+		for (int k = 0; k < 3; k++)
+		{
+			if (min[k] > pmodel->vertices[3 * i + k]) min[k] = pmodel->vertices[3 * i + k];
+			if (max[k] < pmodel->vertices[3 * i + k]) max[k] = pmodel->vertices[3 * i + k];
+		}
+	}
+	center = MinVR::VRPoint3(0.5 * (min[0] + max[0]), 0.5 * (min[1] + max[1]), 0.5 * (min[2] + max[2]));
+	for (GLuint i = 1; i <= pmodel->numvertices; i++)
+	{
+		MinVR::VRPoint3 p(pmodel->vertices[3 * i], pmodel->vertices[3 * i + 1], pmodel->vertices[3 * i + 2]);
+		float distance = (p - center).length();
+		if (distance > radius)
+			radius = distance;
+	}
+
+}
+
+XMAMesh::~XMAMesh()
+{
+	VRMemoryTracker::getInstance()->release(memoryCategory(), cpuBytes, gpuBytes);
+	for (size_t l = 0; l < displayLists.size(); l++)
+	{
+		if (displayLists[l])
+			glDeleteLists(displayLists[l], 1);
+	}
+	for (size_t c = 0; c < chunkLists.size(); c++)
+		glDeleteLists(chunkLists[c], 1);
+	for (size_t l = 0; l < models.size(); l++)
+	{
+		if (models[l])
+			glmDelete(models[l]);
+	}
+	delete bvh;
+}
+
+std::string XMAMesh::getLevelFilename(std::string obj_file, const std::string &lodDirectory, float weldEpsilon, int level)
+{
+	size_t sep = obj_file.find_last_of("\\/");
+	size_t dot = obj_file.find_last_of(".");
+	if (dot != std::string::npos && (sep == std::string::npos || dot > sep))
+		obj_file = obj_file.substr(0, dot);
+	if (!lodDirectory.empty())
+		obj_file = lodDirectory + (sep == std::string::npos ? obj_file : obj_file.substr(sep + 1));
+	//levels of welded meshes are simplified from other vertices, so they are cached per epsilon
+	if (weldEpsilon > 0)
+	{
+		char weld[32];
+		snprintf(weld, sizeof(weld), "_weld%g", weldEpsilon);
+		obj_file += weld;
+	}
+	return obj_file + "_lod" + std::to_string((long long)level) + ".obj";
+}
+
+bool XMAMesh::upload()
+{
+	if (uploadLevel < 0)
+		return false;
+
+	VRTraceRecorder::Scope trace("XMAMesh::upload");
+	GLMmodel* model = models[uploadLevel];
+	GLuint count = model->numtriangles - uploadTriangle;
+	if (count > XMA_UPLOAD_TRIANGLES)
+		count = XMA_UPLOAD_TRIANGLES;
+	GLuint list = glGenLists(1);
+	glNewList(list, GL_COMPILE);
+	glmDrawRange(model, GLM_SMOOTH, uploadTriangle, count);
+	glEndList();
+	chunkLists.push_back(list);
+	uploadTriangle += count;
+	gpuBytes += (long long)count * XMA_LIST_TRIANGLE_BYTES;
+	VRMemoryTracker::getInstance()->allocate(memoryCategory(), 0, (long long)count * XMA_LIST_TRIANGLE_BYTES);
+
+	//the level is drawn once all of its chunks are compiled
+	if (uploadTriangle >= model->numtriangles)
+	{
+		GLuint chunks = (model->numtriangles + XMA_UPLOAD_TRIANGLES - 1) / XMA_UPLOAD_TRIANGLES;
+		if (chunks == 0)
+			chunks = 1;
+		displayLists[uploadLevel] = glGenLists(1);
+		glNewList(displayLists[uploadLevel], GL_COMPILE);
+		for (size_t c = chunkLists.size() - chunks; c < chunkLists.size(); c++)
+			glCallList(chunkLists[c]);
+		glEndList();
+
+		long long size = glmSize(model);
+		cpuBytes -= size;
+		VRMemoryTracker::getInstance()->release(memoryCategory(), size);
+		glmDelete(model);
+		models[uploadLevel] = NULL;
+		finestLevel = uploadLevel;
+		uploadLevel--;
+		uploadTriangle = 0;
+	}
+	return uploadLevel >= 0;
+}
+
+bool XMAMesh::isUploaded()
+{
+	return uploadLevel < 0;
+}
+
+bool XMAMesh::isReady()
+{
+	return finestLevel < displayLists.size();
+}
+
+int XMAMesh::getFinestLevel()
+{
+	return finestLevel;
+}
+
+unsigned int XMAMesh::getDisplayList(int level)
+{
+	if (level < finestLevel)
+		level = finestLevel;
+	return displayLists[level < displayLists.size() ? level : displayLists.size() - 1];
+}
+
+int XMAMesh::getLevels()
+{
+	return displayLists.size();
+}
+
+int XMAMesh::getTriangles(int level)
+{
+	return triangles[level];
+}
+
+MinVR::VRPoint3 XMAMesh::getCenter()
+{
+	return center;
+}
+
+float XMAMesh::getRadius()
+{
+	return radius;
+}
+
+XMABVH * XMAMesh::getBVH()
+{
+	return bvh;
+}
+
+long long XMAMesh::getCPUBytes()
+{
+	return cpuBytes;
+}
+
+long long XMAMesh::getGPUBytes()
+{
+	return gpuBytes;
+}
+
+int XMAMesh::getReferences()
+{
+	std::lock_guard<std::mutex> lock(registryMutex);
+	return references;
+}
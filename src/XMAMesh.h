@@ -0,0 +1,82 @@
+#ifndef XMAMESH_H
+#define XMAMESH_H
+
+#include <string>
+#include <vector>
+#include <math/VRMath.h>
+
+//number of detail levels of a mesh, level 0 is the mesh as loaded and every further level has
+//about a quarter of the triangles of the one before
+#define XMA_LOD_LEVELS 4
+//meshes are not simplified below this number of triangles
+#define XMA_LOD_MIN_TRIANGLES 500
+//triangles compiled into a display list per call of upload
+#define XMA_UPLOAD_TRIANGLES 20000
+//bytes a display list holds per triangle, a normal and a position of 3 floats per vertex
+#define XMA_LIST_TRIANGLE_BYTES 72
+
+struct _GLMmodel;
+class XMABVH;
+
+//Detail levels and display lists of a bone mesh. Meshes are shared through a registry keyed by
+//a hash of the OBJ file and the scale and weld epsilon they are loaded with, so a mesh listed
+//in several rows of the manifest is parsed, processed and uploaded once.
+class XMAMesh
+{
+public:
+	//the mesh for the file, loaded if it is not in the registry yet. Makes no OpenGL calls and
+	//can be called from several threads, a thread asking for a mesh another one is loading waits for it.
+	//The detail levels are cached in lodDirectory, or next to the mesh if it is empty.
+	static XMAMesh * acquire(const std::string &obj_file, float scale, float weldEpsilon, const std::string &lodDirectory = "");
+	//the mesh is deleted with the last reference, on the OpenGL thread once it is uploaded
+	static void release(XMAMesh * mesh);
+	//number of meshes in the registry
+	static int getShared();
+
+	//compiles the next XMA_UPLOAD_TRIANGLES of the display lists, coarsest level first,
+	//returns false once all levels are uploaded
+	bool upload();
+	bool isUploaded();
+	//true once the coarsest level can be drawn
+	bool isReady();
+	//finest level that is uploaded, finer levels are drawn with it
+	int getFinestLevel();
+	unsigned int getDisplayList(int level);
+	int getLevels();
+	int getTriangles(int level);
+	//bounding sphere in the coordinates of the mesh
+	MinVR::VRPoint3 getCenter();
+	float getRadius();
+	//bounding volume hierarchy of the finest level for collision tests
+	XMABVH * getBVH();
+	//bytes of the levels which are not uploaded yet, the hierarchy and the display lists, counted in
+	//the Meshes category of the VRMemoryTracker
+	long long getCPUBytes();
+	long long getGPUBytes();
+	//number of objects sharing the mesh
+	int getReferences();
+
+private:
+	XMAMesh(const std::string &obj_file, float scale, float weldEpsilon, const std::string &lodDirectory);
+	~XMAMesh();
+
+	std::string getLevelFilename(std::string obj_file, const std::string &lodDirectory, float weldEpsilon, int level);
+
+	std::vector<unsigned int> displayLists;	//one per detail level
+	std::vector<int> triangles;
+	std::vector<_GLMmodel*> models;			//levels which are not uploaded yet
+	std::vector<unsigned int> chunkLists;	//called by the display lists of the levels
+	int uploadLevel;
+	unsigned int uploadTriangle;
+	int finestLevel;
+	MinVR::VRPoint3 center;
+	float radius;
+	XMABVH * bvh;
+	long long cpuBytes;
+	long long gpuBytes;
+
+	std::string key;
+	int references;
+};
+
+#endif //XMAMESH_H
@@ -1,134 +1,57 @@
 #include "XMAObject.h"
+#include "XMATransformTrack.h"
+#include "XMAFilter.h"
 #include "glm.h"
+#include "VRTraceRecorder.h"
+#include "VRMemoryTracker.h"
 #include <iostream>
-#include <fstream>
+#include <cstdio>
+#include <algorithm>
 #include <math/VRMath.h>
 
-std::istream& XMAObject::safeGetline(std::istream& is, std::string& t)
-{
-	t.clear();
-
-	// The characters in the stream are read one-by-one using a std::streambuf.
-	// That is faster than reading them one-by-one using the std::istream.
-	// Code that uses streambuf this way must be guarded by a sentry object.
-	// The sentry object performs various tasks,
-	// such as thread synchronization and updating the stream state.
-
-	std::istream::sentry se(is, true);
-	std::streambuf* sb = is.rdbuf();
+//screen height fractions below which the next coarser level is drawn, a level is kept while the
+//size is within XMA_LOD_HYSTERESIS of its limits so that it does not switch back and forth
+static const float lodSizes[XMA_LOD_LEVELS - 1] = { 0.3f, 0.1f, 0.035f };
+#define XMA_LOD_HYSTERESIS 0.15f
 
-	for (;;)
-	{
-		int c = sb->sbumpc();
-		switch (c)
-		{
-		case '\n':
-			return is;
-		case '\r':
-			if (sb->sgetc() == '\n')
-				sb->sbumpc();
-			return is;
-		case EOF:
-			// Also handle the case when the last line has no line ending
-			if (t.empty())
-			{
-				is.setstate(std::ios::eofbit);
-			}
-			return is;
-		default:
-			t += (char)c;
-		}
-	}
-}
-
-
-bool XMAObject::StartsWith(const std::string& text, const std::string& token)
+static int memoryCategory()
 {
-	if (text.length() < token.length())
-		return false;
-	return (text.compare(0, token.length(), token) == 0);
+	static int category = VRMemoryTracker::getInstance()->addCategory("Filters");
+	return category;
 }
 
+XMAObject::XMAObject(std::string obj_file, std::string  transformation_file, float scale, float weldEpsilon) : level(0), filterBytes(0), preparedBytes(0){
+	XMAManifestEntry entry;
+	entry.objFile = obj_file;
+	entry.transformationFile = transformation_file;
+	entry.scale = 1.0f;
+	entry.hasColor = false;
+	entry.priority = 0;
+	entry.line = 0;
+	load(entry, scale, weldEpsilon);
+}
 
-std::istream& XMAObject::comma(std::istream& in)
-{
-	if ((in >> std::ws).peek() != std::char_traits<char>::to_int_type(','))
-	{
-		in.setstate(std::ios_base::failbit);
-	}
-	return in.ignore();
+XMAObject::XMAObject(const XMAManifestEntry &entry, float scale, float weldEpsilon) : level(0), filterBytes(0), preparedBytes(0){
+	load(entry, scale, weldEpsilon);
 }
 
-XMAObject::XMAObject(std::string obj_file, std::string  transformation_file, float scale){
-	
-	GLMmodel* pmodel = glmReadOBJ((char*) obj_file.c_str());
+void XMAObject::load(const XMAManifestEntry &entry, float scale, float weldEpsilon)
+{
+	VRTraceRecorder::Scope trace("XMAObject");
 
-	name = getFilename(obj_file);
+	name = getFilename(entry.objFile);
 	std::cerr << "Load " << name << std::endl;
 
-	//glmUnitize(pmodel);
-	glmFacetNormals(pmodel);
-	glmVertexNormals(pmodel, 90.0);
-	glmScale(pmodel, scale);
-	displayList = glmList(pmodel, GLM_SMOOTH  );
-	glmDelete(pmodel);
+	colored = entry.hasColor;
+	for (int k = 0; k < 3; k++)
+		color[k] = colored ? entry.color[k] : 1.0f;
 
+	mesh = XMAMesh::acquire(entry.objFile, scale * entry.scale, weldEpsilon, entry.lodDirectory);
 
-	std::ifstream fin(transformation_file.c_str());
-	std::istringstream in;
-	std::string line;
-	safeGetline(fin, line);
-	while (!safeGetline(fin, line).eof())
-	{
-		in.clear();
-		in.str(line);
-		std::vector<double> tmp;
-		if (StartsWith(line, "NaN"))
-		{
-			visible.push_back(false);
-
-			float* trans = new float[16];
-			for (int x = 0; x < 16; x++)
-				trans[x] = 0;
-			trans[0] = 1;
-			trans[5] = 1;
-			trans[10] = 1;
-			trans[15] = 1;
-			transformation.push_back(trans);
-		}
-		else{
-			for (double value; in >> value; comma(in))
-			{
-				tmp.push_back(value);
-			}
-
-			if (tmp.size() == 16)
-			{
-				visible.push_back(true);
-				float* trans = new float[16];
-
-				for (int x = 0; x < 16; x++)trans[x] = tmp[x];
-				transformation.push_back(trans);
-			}
-			else
-			{
-				visible.push_back(false);
-
-				float* trans = new float[16];
-				for (int x = 0; x < 16; x++)
-					trans[x] = 0;
-				trans[0] = 1;
-				trans[5] = 1;
-				trans[10] = 1;
-				trans[15] = 1;
-				transformation.push_back(trans);
-			}
-		}
-		line.clear();
-		tmp.clear();
-	}
-	std::cerr << transformation.size() << std::endl;
-	fin.close();
+	//a csv is indexed in the background, which prints its frames when it is done
+	transformation = new XMATransformTrack(entry.transformationFile, entry.binaryFile);
+	if (transformation->isBinary())
+		std::cerr << transformation->size() << " frames from the binary track" << std::endl;
 }
 
 std::string XMAObject::getFilename(std::string path)
@@ -145,17 +68,88 @@ std::string XMAObject::getFilename(std::string path)
 }
 
 XMAObject::~XMAObject(){
-	glDeleteLists(displayList,1);
+	VRMemoryTracker::getInstance()->release(memoryCategory(), filterBytes + preparedBytes);
+	XMAMesh::release(mesh);
+	delete transformation;
 }
 
-void XMAObject::render(int frame){
-	if (visible[frame]){
+bool XMAObject::upload()
+{
+	return mesh->upload();
+}
+
+bool XMAObject::isUploaded()
+{
+	return mesh->isUploaded();
+}
+
+bool XMAObject::isReady()
+{
+	return mesh->isReady();
+}
+
+int XMAObject::getFinestLevel()
+{
+	return mesh->getFinestLevel();
+}
+
+bool XMAObject::render(int frame, int level){
+	if (transformation->isVisible(frame)){
+		float trans[16];
+		if (16 * (size_t)frame < filteredMatrices.size())
+			std::copy(&filteredMatrices[16 * frame], &filteredMatrices[16 * frame] + 16, trans);
+		else
+			transformation->getTransformation(frame, trans);
 		glPushMatrix();
-		glMultMatrixf(transformation[frame]);
-		glCallList(displayList);
+		glMultMatrixf(trans);
+		glCallList(getDisplayList(level));
 
 		glPopMatrix();
+		return true;
 	}
+	return false;
+}
+
+unsigned int XMAObject::getDisplayList(int level)
+{
+	return mesh->getDisplayList(level);
+}
+
+int XMAObject::selectLevel(float screenSize)
+{
+	//coarser while the object is clearly smaller than the limit of its level,
+	//finer while it is clearly larger than the limit of the next finer level
+	int levels = mesh->getLevels();
+	while (level + 1 < levels && screenSize < lodSizes[level] * (1.0f - XMA_LOD_HYSTERESIS))
+		level++;
+	while (level > 0 && screenSize > lodSizes[level - 1] * (1.0f + XMA_LOD_HYSTERESIS))
+		level--;
+	return level;
+}
+
+int XMAObject::getLevels()
+{
+	return mesh->getLevels();
+}
+
+int XMAObject::getTriangles(int level)
+{
+	return mesh->getTriangles(level);
+}
+
+MinVR::VRPoint3 XMAObject::getCenter()
+{
+	return mesh->getCenter();
+}
+
+float XMAObject::getRadius()
+{
+	return mesh->getRadius();
+}
+
+XMABVH* XMAObject::getBVH()
+{
+	return mesh->getBVH();
 }
 
 std::string XMAObject::getName()
@@ -163,17 +157,91 @@ std::string XMAObject::getName()
 	return name;
 }
 
+bool XMAObject::hasColor()
+{
+	return colored;
+}
+
+const float * XMAObject::getColor()
+{
+	return color;
+}
+
 MinVR::VRMatrix4 XMAObject::getTransformation(int frame)
 {
-	return MinVR::VRMatrix4(transformation[frame]);
+	if (frame >= 0 && 16 * (size_t)frame < filteredMatrices.size())
+		return MinVR::VRMatrix4(&filteredMatrices[16 * frame]);
+	float trans[16];
+	transformation->getTransformation(frame, trans);
+	return MinVR::VRMatrix4(trans);
 }
 
 int XMAObject::getTransformationSize()
 {
-	return transformation.size();
+	return transformation->size();
 }
 
 bool XMAObject::isVisible(int frame)
 {
-	return visible[frame];
+	return transformation->isVisible(frame);
+}
+
+void XMAObject::setPlayhead(int frame)
+{
+	transformation->setPlayhead(frame);
+}
+
+XMATransformTrack* XMAObject::getTrack()
+{
+	return transformation;
+}
+
+void XMAObject::prepareFilter(const XMAFilter &filter)
+{
+	VRTraceRecorder::Scope trace("XMAObject::prepareFilter");
+	int frames = transformation->size();
+	std::vector<unsigned char> visible(frames);
+	preparedMatrices.resize(16 * (size_t)frames);
+	if (frames > 0)
+	{
+		transformation->readRange(0, frames, &preparedMatrices[0], &visible[0]);
+		filter.filterTransforms(&preparedMatrices[0], &visible[0], frames);
+	}
+
+	long long bytes = preparedMatrices.capacity() * sizeof(float);
+	VRMemoryTracker::getInstance()->allocate(memoryCategory(), bytes - preparedBytes);
+	preparedBytes = bytes;
+}
+
+void XMAObject::applyFilter()
+{
+	filteredMatrices.swap(preparedMatrices);
+	std::vector<float>().swap(preparedMatrices);
+	VRMemoryTracker::getInstance()->release(memoryCategory(), filterBytes);
+	filterBytes = preparedBytes;
+	preparedBytes = 0;
+}
+
+void XMAObject::removeFilter()
+{
+	std::vector<float>().swap(filteredMatrices);
+	std::vector<float>().swap(preparedMatrices);
+	VRMemoryTracker::getInstance()->release(memoryCategory(), filterBytes + preparedBytes);
+	filterBytes = 0;
+	preparedBytes = 0;
+}
+
+bool XMAObject::isFiltered()
+{
+	return !filteredMatrices.empty();
+}
+
+long long XMAObject::getCPUBytes()
+{
+	return transformation->getBytes() + filterBytes + mesh->getCPUBytes() / mesh->getReferences();
+}
+
+long long XMAObject::getGPUBytes()
+{
+	return mesh->getGPUBytes() / mesh->getReferences();
 }
@@ -5,27 +5,79 @@
 #include <vector>
 #include <math/VRMath.h>
 
+#include "XMAMesh.h"
+#include "XMAManifest.h"
+
+class XMATransformTrack;
+class XMAFilter;
+
 class XMAObject                   // begin declaration of the class
 {
   public:
 	// begin public section
-	  XMAObject(std::string obj_file, std::string  transformation_file, float scale = 1.0);     // constructor
+	  //vertices closer than weldEpsilon are merged before the normals are computed, 0 disables welding.
+	  //Makes no OpenGL calls, so objects can be loaded on other threads and uploaded later. Objects
+	  //with the same mesh file, scale and weld epsilon share one XMAMesh.
+	  XMAObject(std::string obj_file, std::string  transformation_file, float scale = 1.0, float weldEpsilon = 0.0);     // constructor
+	  //a bone of the manifest, its scale is multiplied with scale
+	  XMAObject(const XMAManifestEntry &entry, float scale = 1.0, float weldEpsilon = 0.0);
     ~XMAObject();                  // destructor
-	void render(int frame);
+	//compiles the next XMA_UPLOAD_TRIANGLES of the display lists, coarsest level first,
+	//returns false once all levels are uploaded
+	bool upload();
+	bool isUploaded();
+	//true once the coarsest level can be drawn
+	bool isReady();
+	//finest level that is uploaded, finer levels are drawn with it
+	int getFinestLevel();
+	//returns false if the object is not tracked in this frame
+	bool render(int frame, int level = 0);
+	//display list of the mesh at a detail level, without the transformation of the frame
+	unsigned int getDisplayList(int level);
+	//detail level for the height of the object on screen as a fraction of the viewport height
+	int selectLevel(float screenSize);
+	int getLevels();
+	int getTriangles(int level);
+	//bounding sphere in the coordinates of the object
+	MinVR::VRPoint3 getCenter();
+	float getRadius();
+	//bounding volume hierarchy of the mesh in the coordinates of the object
+	XMABVH* getBVH();
 	std::string getName();
+	//colour given in the manifest, bones without one are drawn white
+	bool hasColor();
+	const float * getColor();
 	MinVR::VRMatrix4  getTransformation(int frame);
 	int getTransformationSize();
 	bool isVisible(int frame);
+	void setPlayhead(int frame);
+	//the track as read, not filtered
+	XMATransformTrack* getTrack();
+	//reads the track again and filters its transformations into a buffer kept aside, the bone is
+	//drawn as before until applyFilter. Can be called from a worker thread
+	void prepareFilter(const XMAFilter &filter);
+	//draws the bone with the transformations of the last prepareFilter
+	void applyFilter();
+	//draws the bone with the transformations as read again
+	void removeFilter();
+	bool isFiltered();
+	//bytes of the transformation track, the filtered transformations and the object's share of the mesh
+	long long getCPUBytes();
+	long long getGPUBytes();
  private:                   // begin private section
-    unsigned int displayList;              // member variable
-	std::vector<float*> transformation;
-	std::vector<bool> visible;
+	XMAMesh* mesh;
+	int level;
+	XMATransformTrack* transformation;
 	std::string name;
+	bool colored;
+	float color[3];
+	std::vector<float> filteredMatrices;
+	long long filterBytes;
+	std::vector<float> preparedMatrices;
+	long long preparedBytes;
 	
+	void load(const XMAManifestEntry &entry, float scale, float weldEpsilon);
 	std::string getFilename(std::string path);
-	std::istream& safeGetline(std::istream& is, std::string& t);
-	bool StartsWith(const std::string& text, const std::string& token);
-	std::istream& comma(std::istream& in);
 
 };
 
@@ -0,0 +1,558 @@
+// OpenGL platform-specific headers
+#if defined(WIN32)
+#define NOMINMAX
+#include <windows.h>
+#include <GL/gl.h>
+#elif defined(__APPLE__)
+#include <OpenGL/OpenGL.h>
+#else
+#include <GL/gl.h>
+#endif
+
+#include "XMARenderer.h"
+#include "XMAObject.h"
+#include "VRMenu.h"
+#include "VRProfiler.h"
+#include "VRTraceRecorder.h"
+#include "XMAAnalysis.h"
+#include "glm.h"
+
+using namespace MinVR;
+
+static float color_array[XMA_PARTICLE_COLORS][3] = {
+	{ 0, 1, 0 },
+	{ 0, 0, 1 },
+	{ 1, 1, 0 },
+	{ 1, 0, 1 },
+	{ 0, 1, 1 },
+	{ 0.5, 1, 0 },
+	{ 0, 1, 0.5 },
+	{ 0.5, 0, 1 },
+	{ 0, 0.5, 1 },
+	{ 1, 1, 0.5 },
+	{ 1, 0.5, 1 },
+	{ 0.5, 1, 1 },
+	{ 0, 0.5, 0 },
+	{ 0, 0, 0.5 },
+	{ 0.5, 1, 0 },
+	{ 1, 0.5, 0 },
+	{ 0.5, 0, 1 },
+	{ 1, 0, 0.5 },
+	{ 0, 0.5, 1 },
+	{ 0, 1, 0.5 },
+};
+
+XMARenderer::XMARenderer() : m_sphere(0), m_sphereRadius(0.1f), m_phase_prepare(-1), m_phase_objects(-1), m_phase_particles(-1), m_phase_projection(-1), m_phase_trails(-1), m_phase_menus(-1)
+{
+	m_packet.state.objects = NULL;
+	m_packet.lines[0] = m_packet.lines[1] = false;
+	resetStats();
+}
+
+XMARenderer::~XMARenderer()
+{
+	if (m_sphere)
+		glDeleteLists(m_sphere, 1);
+}
+
+bool XMARenderer::loadSphere(const char * filename)
+{
+	GLMmodel* pmodel = glmReadOBJ((char*)filename);
+	if (!pmodel)
+		return false;
+
+	glmUnitize(pmodel);
+	glmScale(pmodel, 0.1);
+	//bounding radius for culling, unitized meshes are centered at the origin
+	m_sphereRadius = 0;
+	for (GLuint i = 1; i <= pmodel->numvertices; i++)
+	{
+		GLfloat * v = &pmodel->vertices[3 * i];
+		float r = sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+		if (r > m_sphereRadius)
+			m_sphereRadius = r;
+	}
+	glmFacetNormals(pmodel);
+	glmVertexNormals(pmodel, 90.0);
+	m_sphere = glmList(pmodel, GLM_SMOOTH);
+	glmDelete(pmodel);
+	return true;
+}
+
+void XMARenderer::registerProfilerPhases()
+{
+	VRProfiler * profiler = VRProfiler::getInstance();
+	m_phase_prepare = profiler->addPhase("Prepare");
+	m_phase_objects = profiler->addPhase("Bones");
+	m_phase_particles = profiler->addPhase("Particles");
+	m_phase_projection = profiler->addPhase("Projection");
+	m_phase_trails = profiler->addPhase("Trails");
+	m_phase_menus = profiler->addPhase("Menus");
+}
+
+int XMARenderer::getMenuPhase()
+{
+	return m_phase_menus;
+}
+
+const XMARenderer::Stats &XMARenderer::getStats()
+{
+	return m_stats;
+}
+
+void XMARenderer::resetStats()
+{
+	m_stats.drawCalls = 0;
+	m_stats.vertices = 0;
+	m_stats.objects = 0;
+	m_stats.particles = 0;
+	m_stats.trails = 0;
+	m_stats.menus = 0;
+	m_stats.culledObjects = 0;
+	m_stats.culledParticles = 0;
+	m_stats.culledTrails = 0;
+}
+
+const float * XMARenderer::getColor(int color)
+{
+	return color_array[color % XMA_PARTICLE_COLORS];
+}
+
+void XMARenderer::prepare(const XMARenderState &s)
+{
+	VRProfiler::ScopedTimer timer(m_phase_prepare);
+	VRTraceRecorder::Scope trace("prepare");
+	std::vector<XMAObject*> &objects = *s.objects;
+	std::vector<XMAParticle> &particles = *s.particles;
+	int frame = s.frame;
+	XMARenderPacket &p = m_packet;
+	p.state = s;
+	p.objects.clear();
+	p.particles.clear();
+	p.projectedParticles.clear();
+	p.trailPoints.clear();
+	p.projectedStrips.clear();
+
+	p.room = s.roompose * VRMatrix4::scale(VRVector3(s.scale, s.scale, s.scale));
+	p.world = p.room;
+	//nothing is drawn of the bones while the fixed object is not tracked
+	bool objectsVisible = true;
+	if (s.fixed_obj != -1)
+	{
+		objectsVisible = objects[s.fixed_obj]->isVisible(frame);
+		p.world = p.world * s.object_fixpose * objects[s.fixed_obj]->getTransformation(frame).inverse();
+	}
+
+	//bones, the detail level is chosen here so that its hysteresis is updated once per frame
+	VRMatrix4 headView = s.headpose.inverse();
+	for (int i = 0; objectsVisible && i < objects.size(); i++)
+	{
+		//bones are drawn once they are loaded and their coarsest level is uploaded
+		if (!objects[i] || !objects[i]->isReady() || !objects[i]->isVisible(frame))
+			continue;
+		XMARenderPacket::Draw draw;
+		draw.index = i;
+		draw.model = p.world * objects[i]->getTransformation(frame);
+		draw.center = draw.model * objects[i]->getCenter();
+		draw.radius = objects[i]->getRadius() * s.scale;
+		//projected height of the bounding sphere, objects around the head count as full screen
+		draw.level = 0;
+		if (s.lod)
+		{
+			float depth = -(headView * draw.center).z;
+			draw.level = objects[i]->selectLevel(depth > draw.radius ? draw.radius * s.focalLength / depth : 1.0f);
+		}
+		if (draw.level < objects[i]->getFinestLevel())
+			draw.level = objects[i]->getFinestLevel();
+		p.objects.push_back(draw);
+	}
+
+	//particles at the current frame, the sphere keeps its size independent of the scale
+	VRMatrix4 unscale = VRMatrix4::scale(VRVector3(1.0 / s.scale, 1.0 / s.scale, 1.0 / s.scale));
+	for (int i = 0; i < particles.size(); i++)
+	{
+		if (!particles[i].visible[frame])
+			continue;
+		VRPoint3 &position = particles[i].position;
+		XMARenderPacket::Draw draw;
+		draw.index = i;
+		draw.model = (particles[i].object != -1) ? p.world * objects[particles[i].object]->getTransformation(frame) : p.world;
+		draw.center = draw.model * position;
+		draw.model = draw.model * VRMatrix4::translation(VRVector3(position.x, position.y, position.z)) * unscale;
+		draw.radius = m_sphereRadius;
+		p.particles.push_back(draw);
+	}
+
+	//particles and trails projected onto the controller plane
+	if (s.project)
+	{
+		VRMatrix4 toController = s.controllerpose.inverse();
+		VRVector3 controller_n = s.controllerpose * VRVector3(0, 1, 0);
+		VRMatrix4 size = VRMatrix4::scale(VRVector3(1.0 / s.scale * 0.01, 1.0 / s.scale * 0.01, 1.0 / s.scale * 0.01));
+		for (int i = 0; i < particles.size(); i++)
+		{
+			if (!particles[i].visible[frame])
+				continue;
+			VRPoint3 p_particle = p.room * particles[i].getPosition(frame);
+			double d = -(toController * p_particle).y;
+			XMARenderPacket::Draw draw;
+			draw.index = i;
+			draw.center = VRPoint3(p_particle.x + d * controller_n.x, p_particle.y + d * controller_n.y, p_particle.z + d * controller_n.z);
+			draw.model = VRMatrix4::translation(VRVector3(draw.center.x, draw.center.y, draw.center.z)) * size;
+			draw.radius = 0;
+			p.projectedParticles.push_back(draw);
+		}
+
+		//visible trail points of all particles, projected in one pass
+		for (int i = 0; i < particles.size(); i++)
+		{
+			int start = 0;
+			int end = particles[i].visible.size();
+			if (s.particle_trail != -1)
+			{
+				start = frame - s.particle_trail;
+				if (start < 0) start = 0;
+				end = frame;
+			}
+
+			XMARenderPacket::Strip strip;
+			strip.particle = i;
+			strip.first = 0;
+			strip.count = 0;
+			for (int j = start; j <= end; j++)
+			{
+				if (j < end && particles[i].visible[j])
+				{
+					if (strip.count == 0)
+						strip.first = p.trailPoints.size() / 3;
+					p.trailPoints.insert(p.trailPoints.end(), &particles[i].positions[3 * j], &particles[i].positions[3 * j + 3]);
+					strip.count++;
+				}
+				else if (strip.count > 0)
+				{
+					p.projectedStrips.push_back(strip);
+					strip.count = 0;
+				}
+			}
+		}
+		p.projectedTrails.resize(p.trailPoints.size());
+		VRMatrix4 toPlane = toController * p.room;
+		XMAAnalysis::projectToPlane(toPlane.getArray(), s.controllerpose.getArray(), p.trailPoints.data(), p.trailPoints.size() / 3,
+			p.projectedTrails.data(), p.projectedMin, p.projectedMax);
+	}
+
+	//line between two particles, or from a particle to the tool if the second one is not set yet
+	for (int l = 0; l < 2; l++)
+	{
+		int from = s.points[2 * l];
+		int to = s.points[2 * l + 1];
+		p.lines[l] = from != -1 && particles[from].visible[frame] && (to == -1 || particles[to].visible[frame]);
+		if (!p.lines[l])
+			continue;
+		p.lineEnds[2 * l] = p.room * particles[from].getPosition(frame);
+		p.lineEnds[2 * l + 1] = (to != -1) ? p.room * particles[to].getPosition(frame) : s.controllerpose * VRPoint3(0, 0, s.tool_dist);
+	}
+}
+
+void XMARenderer::render(const float * projection, const float * view)
+{
+	const XMARenderState &s = m_packet.state;
+	glClearColor(1.0, 1.0, 1.0, 1.0);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	//nothing to draw before the first packet
+	if (!s.objects)
+		return;
+	glEnable(GL_NORMALIZE);
+	glEnable(GL_DEPTH_TEST);
+	glEnable(GL_COLOR_MATERIAL);
+
+	glEnable(GL_LIGHTING);
+	glEnable(GL_LIGHT0);
+
+	glMatrixMode(GL_PROJECTION);
+	glLoadMatrixf(projection);
+
+	glMatrixMode(GL_MODELVIEW);
+	glLoadMatrixf(view);
+
+	//bounding spheres are tested in room coordinates, trail boxes in the coordinates of the positions
+	VRMatrix4 clip = VRMatrix4(projection) * VRMatrix4(view);
+	m_worldFrustum = XMAFrustum(clip);
+	m_sceneFrustum = XMAFrustum(clip * m_packet.room);
+
+	if (s.transparent){
+		//transparent
+		glDepthFunc(GL_ALWAYS); // The Type Of Depth Testing To Do
+		glEnable(GL_BLEND);
+		glBlendFunc(GL_ZERO, GL_SRC_COLOR);
+		glDisable(GL_CULL_FACE);
+	}
+
+	drawObjects();
+
+	if (s.transparent){
+		//transparent
+		glDisable(GL_BLEND);
+		glDepthFunc(GL_LESS); // The Type Of Depth Testing To Do
+	}
+
+	drawParticles();
+	drawTool();
+	drawProjectedParticles();
+
+	glDisable(GL_LIGHTING);
+
+	drawLines();
+	drawProjectedTrails();
+	drawTrails();
+
+	drawMenus();
+}
+
+void XMARenderer::setParticleColor(int i)
+{
+	const XMARenderState &s = m_packet.state;
+	if ((i == s.hover_particle && s.selected_particle == -1) ||
+		s.selected_particle == i) {
+		glColor3f(1.0, 0.0, 0.0);
+	}
+	else
+	{
+		glColor3fv(getColor((*s.particles)[i].color));
+	}
+}
+
+//bones
+void XMARenderer::drawObjects()
+{
+	VRProfiler::ScopedTimer timer(m_phase_objects);
+	VRTraceRecorder::Scope trace("drawObjects");
+	const XMARenderState &s = m_packet.state;
+	std::vector<XMAObject*> &objects = *s.objects;
+	for (size_t d = 0; d < m_packet.objects.size(); d++)
+	{
+		const XMARenderPacket::Draw &draw = m_packet.objects[d];
+		int i = draw.index;
+		if (!m_worldFrustum.isSphereVisible(draw.center, draw.radius))
+		{
+			m_stats.culledObjects++;
+			continue;
+		}
+
+		int level = draw.level;
+
+		if (i == s.current_obj) {
+			glColor3f(1.0, 1.0, 0.0);
+		}
+		else
+		{
+			glColor3fv(objects[i]->getColor());
+		}
+		glPushMatrix();
+		glMultMatrixf(draw.model.getArray());
+		glCallList(objects[i]->getDisplayList(level));
+		glPopMatrix();
+		m_stats.drawCalls++;
+		m_stats.objects++;
+		m_stats.vertices += 3 * objects[i]->getTriangles(level);
+	}
+}
+
+//particles at the current frame
+void XMARenderer::drawParticles()
+{
+	VRProfiler::ScopedTimer timer(m_phase_particles);
+	VRTraceRecorder::Scope trace("drawParticles");
+	for (size_t d = 0; d < m_packet.particles.size(); d++)
+	{
+		const XMARenderPacket::Draw &draw = m_packet.particles[d];
+		if (!m_worldFrustum.isSphereVisible(draw.center, draw.radius))
+		{
+			m_stats.culledParticles++;
+			continue;
+		}
+
+		setParticleColor(draw.index);
+		glPushMatrix();
+		glMultMatrixf(draw.model.getArray());
+		glCallList(m_sphere);
+		glPopMatrix();
+		m_stats.drawCalls++;
+		m_stats.particles++;
+	}
+}
+
+//ray of the controller and the sphere at the tool position
+void XMARenderer::drawTool()
+{
+	const XMARenderState &s = m_packet.state;
+	if (s.project || !s.showTool)
+		return;
+
+	glPushMatrix();
+	glMultMatrixf(s.controllerpose.getArray());
+	glBegin(GL_LINES);
+	glColor3f(0.1f, 0.1f, 0.0f);
+	glVertex3f(0.0f, 0.0f, -5.0f);
+	glVertex3f(0.0f, 0.0f, 0.0f);
+	glEnd();
+	m_stats.drawCalls++;
+	m_stats.vertices += 2;
+	if (s.showToolSphere){
+		glTranslatef(0, 0, s.tool_dist);
+		glScalef(1.0 / s.scale * 0.03, 1.0 / s.scale * 0.03, 1.0 / s.scale * 0.03);
+		glCallList(m_sphere);
+		m_stats.drawCalls++;
+	}
+	glPopMatrix();
+}
+
+//particles projected onto the controller plane
+void XMARenderer::drawProjectedParticles()
+{
+	VRProfiler::ScopedTimer timer(m_phase_projection);
+	VRTraceRecorder::Scope trace("drawProjectedParticles");
+	for (size_t d = 0; d < m_packet.projectedParticles.size(); d++)
+	{
+		const XMARenderPacket::Draw &draw = m_packet.projectedParticles[d];
+		setParticleColor(draw.index);
+		glPushMatrix();
+		glMultMatrixf(draw.model.getArray());
+		glCallList(m_sphere);
+		glPopMatrix();
+		m_stats.drawCalls++;
+		m_stats.particles++;
+	}
+}
+
+//distance and angle lines
+void XMARenderer::drawLines()
+{
+	static const float colors[2][3] = { { 1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 1.0f } };
+	for (int l = 0; l < 2; l++)
+	{
+		if (!m_packet.lines[l])
+			continue;
+		const VRPoint3 &pt1 = m_packet.lineEnds[2 * l];
+		const VRPoint3 &pt2 = m_packet.lineEnds[2 * l + 1];
+		glBegin(GL_LINES);
+		glColor3fv(colors[l]);
+		glVertex3f(pt1.x, pt1.y, pt1.z);
+		glVertex3f(pt2.x, pt2.y, pt2.z);
+		glEnd();
+		m_stats.drawCalls++;
+		m_stats.vertices += 2;
+	}
+}
+
+//particle trails projected onto the controller plane
+void XMARenderer::drawProjectedTrails()
+{
+	VRProfiler::ScopedTimer timer(m_phase_projection);
+	VRTraceRecorder::Scope trace("drawProjectedTrails");
+	const XMARenderState &s = m_packet.state;
+	if (!s.project || m_packet.projectedStrips.empty())
+		return;
+
+	const float * points = m_packet.projectedTrails.data();
+	int color = -1;
+	for (size_t i = 0; i < m_packet.projectedStrips.size(); i++)
+	{
+		const XMARenderPacket::Strip &strip = m_packet.projectedStrips[i];
+		if (strip.particle != color)
+		{
+			color = strip.particle;
+			setParticleColor(color);
+		}
+		glBegin(GL_LINE_STRIP);
+		for (int j = strip.first; j < strip.first + strip.count; j++)
+			glVertex3fv(&points[3 * j]);
+		glEnd();
+		m_stats.drawCalls++;
+		m_stats.vertices += strip.count;
+	}
+
+	const float * min = m_packet.projectedMin;
+	const float * max = m_packet.projectedMax;
+	glPushMatrix();
+	glMultMatrixf(s.controllerpose.getArray());
+	glBegin(GL_LINE_STRIP);
+	glColor3f(0.5f, 0.5f, 0.0f);     // Yellow
+	glVertex3f(min[0] - 0.1, 0.0f, max[1] + 0.1);
+	glVertex3f(max[0] + 0.1, 0.0f, max[1] + 0.1);
+	glVertex3f(max[0] + 0.1, 0.0f, min[1] - 0.1);
+	glVertex3f(min[0] - 0.1, 0.0f, min[1] - 0.1);
+	glVertex3f(min[0] - 0.1, 0.0f, max[1] + 0.1);
+	glEnd();
+	glPopMatrix();
+	m_stats.drawCalls++;
+	m_stats.vertices += 5;
+}
+
+//particle trails
+void XMARenderer::drawTrails()
+{
+	VRProfiler::ScopedTimer timer(m_phase_trails);
+	VRTraceRecorder::Scope trace("drawTrails");
+	const XMARenderState &s = m_packet.state;
+	std::vector<XMAParticle> &particles = *s.particles;
+	int frame = s.frame;
+	glPushMatrix();
+	glMultMatrixf(m_packet.room.getArray());
+	for (int i = 0; i < particles.size(); i++)
+	{
+		if (particles[i].hasTrailBounds && !m_sceneFrustum.isBoxVisible(particles[i].trailMin, particles[i].trailMax))
+		{
+			m_stats.culledTrails++;
+			continue;
+		}
+		m_stats.trails++;
+
+		setParticleColor(i);
+
+		glBegin(GL_LINE_STRIP);
+		m_stats.drawCalls++;
+		int start = 0;
+		int end = particles[i].visible.size();
+
+		if (s.particle_trail != -1)
+		{
+			start = frame - s.particle_trail;
+			if (start < 0) start = 0;
+			end = frame;
+		}
+
+		for (int j = start; j < end; j++)
+		{
+			if (particles[i].visible[j]){
+				glVertex3fv(&particles[i].positions[3 * j]);
+				m_stats.vertices++;
+			}
+			else
+			{
+				glEnd();
+				glBegin(GL_LINE_STRIP);
+				m_stats.drawCalls++;
+			}
+		}
+		glEnd();
+	}
+	glPopMatrix();
+}
+
+void XMARenderer::drawMenus()
+{
+	VRProfiler::ScopedTimer timer(m_phase_menus);
+	VRTraceRecorder::Scope trace("drawMenus");
+	const XMARenderState &s = m_packet.state;
+	if (!s.menus)
+		return;
+	for (std::vector<VRMenu*>::const_iterator it = s.menus->begin(); it != s.menus->end(); ++it)
+	{
+		if (!(*it)->isVisible())
+			continue;
+		(*it)->draw();
+		m_stats.drawCalls++;
+		m_stats.menus++;
+	}
+}
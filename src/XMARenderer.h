@@ -0,0 +1,183 @@
+#ifndef XMARENDERER_H
+#define XMARENDERER_H
+
+#include <vector>
+#include <math/VRMath.h>
+#include "XMAFrustum.h"
+
+class XMAObject;
+class VRMenu;
+
+//number of entries in the particle color table
+#define XMA_PARTICLE_COLORS 20
+
+struct XMAParticle
+{
+	MinVR::VRPoint3 position;
+	int object;
+	std::vector<float> positions;	//x,y,z per frame
+	std::vector<unsigned char> visible;
+	int color;
+	//box around the visible positions, trails are not culled before it is computed
+	bool hasTrailBounds;
+	float trailMin[3];
+	float trailMax[3];
+
+	XMAParticle() : object(-1), color(0), hasTrailBounds(false) {}
+
+	MinVR::VRPoint3 getPosition(int frame) const
+	{
+		return MinVR::VRPoint3(positions[3 * frame], positions[3 * frame + 1], positions[3 * frame + 2]);
+	}
+
+	//has to be called after the positions changed
+	void updateTrailBounds()
+	{
+		hasTrailBounds = true;
+		trailMin[0] = trailMin[1] = trailMin[2] = 1e30f;
+		trailMax[0] = trailMax[1] = trailMax[2] = -1e30f;
+		for (size_t f = 0; f < visible.size(); f++)
+		{
+			if (!visible[f])
+				continue;
+			for (int k = 0; k < 3; k++)
+			{
+				if (trailMin[k] > positions[3 * f + k]) trailMin[k] = positions[3 * f + k];
+				if (trailMax[k] < positions[3 * f + k]) trailMax[k] = positions[3 * f + k];
+			}
+		}
+	}
+};
+
+//Everything a frame is drawn from. The application fills it from its menu state, the
+//headless render benchmark from a scripted scene.
+struct XMARenderState
+{
+	std::vector<XMAObject*> * objects;
+	std::vector<XMAParticle> * particles;
+	std::vector<VRMenu*> * menus;
+
+	double frame;
+	double scale;
+	MinVR::VRMatrix4 roompose;
+	MinVR::VRMatrix4 controllerpose;
+	MinVR::VRMatrix4 object_fixpose;
+	int fixed_obj;		//-1 if the scene is not fixed to an object
+	int current_obj;
+	int hover_particle;
+	int selected_particle;
+	int particle_trail;	//-1 draws the full trails
+	int points[4];		//particles of the distance and angle lines, -1 if unset
+	double tool_dist;
+	bool transparent;
+	bool project;		//particles are projected onto the controller plane, the tool is hidden
+	bool showTool;		//ray of the controller
+	bool showToolSphere;
+	bool lod;			//bones are drawn at the detail level for their size on screen
+	//the detail level is chosen once per frame for the head, between the eyes, with the vertical
+	//focal length of the eye projection, projection[5]
+	MinVR::VRMatrix4 headpose;
+	float focalLength;
+};
+
+//The part of a frame that is the same for both eyes: final model matrices of the tracked
+//bones and particles, the particles visible in the frame and the projected positions.
+struct XMARenderPacket
+{
+	struct Draw
+	{
+		int index;					//object or particle
+		MinVR::VRMatrix4 model;		//transformation from the mesh to the room
+		MinVR::VRPoint3 center;		//bounding sphere in the room
+		float radius;
+		int level;					//detail level of a bone, the same for both eyes
+	};
+
+	//consecutive visible frames of a trail
+	struct Strip
+	{
+		int particle;
+		int first;
+		int count;
+	};
+
+	XMARenderState state;
+	MinVR::VRMatrix4 room;		//roompose * scale, the coordinates of the particle positions
+	MinVR::VRMatrix4 world;		//room, relative to the fixed object if the scene is fixed to one
+	std::vector<Draw> objects;
+	std::vector<Draw> particles;
+	std::vector<Draw> projectedParticles;
+	std::vector<float> trailPoints;			//visible trail points of the projection, x,y,z
+	std::vector<float> projectedTrails;		//the same points on the controller plane in the room
+	std::vector<Strip> projectedStrips;
+	float projectedMin[2];					//x and z range on the controller plane
+	float projectedMax[2];
+	bool lines[2];				//distance and angle lines
+	MinVR::VRPoint3 lineEnds[4];
+};
+
+//Draws bones, particles, trails, the tool and the menus. prepare builds the render packet once
+//per frame, render draws it for one eye.
+class XMARenderer
+{
+public:
+	//draw submissions of the frames since the last reset, bones, particles and trails outside
+	//of the view frustum of an eye are counted as culled instead of drawn
+	struct Stats
+	{
+		int drawCalls;
+		int vertices;
+		int objects;
+		int particles;
+		int trails;
+		int menus;
+		int culledObjects;
+		int culledParticles;
+		int culledTrails;
+	};
+
+	XMARenderer();
+	~XMARenderer();
+
+	//display list of the sphere used for particles and the tool
+	bool loadSphere(const char * filename);
+	void registerProfilerPhases();
+	//menu texture updates of the application are added to the same phase
+	int getMenuPhase();
+
+	void prepare(const XMARenderState &state);
+	void render(const float * projection, const float * view);
+
+	const Stats &getStats();
+	void resetStats();
+
+	static const float * getColor(int color);
+
+private:
+	void drawObjects();
+	void drawParticles();
+	void drawTool();
+	void drawProjectedParticles();
+	void drawLines();
+	void drawProjectedTrails();
+	void drawTrails();
+	void drawMenus();
+	void setParticleColor(int i);
+
+	unsigned int m_sphere;
+	float m_sphereRadius;
+	Stats m_stats;
+
+	XMARenderPacket m_packet;
+	XMAFrustum m_worldFrustum;	//of the current eye in room coordinates
+	XMAFrustum m_sceneFrustum;	//in the coordinates of the particle positions
+
+	int m_phase_prepare;
+	int m_phase_objects;
+	int m_phase_particles;
+	int m_phase_projection;
+	int m_phase_trails;
+	int m_phase_menus;
+};
+
+#endif //XMARENDERER_H
@@ -0,0 +1,722 @@
+#include "XMATransformTrack.h"
+#include "VRTraceRecorder.h"
+#include "VRMemoryTracker.h"
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <thread>
+#include <condition_variable>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+#define INDEX_CHUNK_SIZE (1 << 20)
+// magic, number of frames and 4 unused bytes which keep the frames aligned
+#define TRACK_BINARY_HEADER 16
+#define TRACK_BINARY_FRAME (16 * sizeof(float))
+
+static int seekFile(FILE * file, long long offset)
+{
+#ifdef _WIN32
+	return _fseeki64(file, offset, SEEK_SET);
+#else
+	return fseeko(file, offset, SEEK_SET);
+#endif
+}
+
+static int memoryCategory()
+{
+	static int category = VRMemoryTracker::getInstance()->addCategory("Transform tracks");
+	return category;
+}
+
+//the tracks served by the worker thread, which runs while there are tracks. It is never deleted,
+//bones which are not deleted before the application exits keep the thread running until then
+struct TrackWorker
+{
+	TrackWorker() : busy(NULL), thread(NULL) {}
+
+	std::mutex mutex;
+	std::condition_variable condition;
+	std::vector<XMATransformTrack *> tracks;
+	XMATransformTrack * busy;	//track the worker takes a step for
+	std::thread * thread;
+};
+
+static TrackWorker &trackWorker()
+{
+	static TrackWorker * worker = new TrackWorker();
+	return *worker;
+}
+
+static long long pageBytes(int frames)
+{
+	return (long long)frames * (16 * sizeof(float) + 1);
+}
+
+static void setIdentity(float * matrix)
+{
+	for (int x = 0; x < 16; x++)
+		matrix[x] = 0;
+	matrix[0] = 1;
+	matrix[5] = 1;
+	matrix[10] = 1;
+	matrix[15] = 1;
+}
+
+XMATransformTrack::XMATransformTrack(std::string transformation_file, std::string binary_file) : m_filename(transformation_file), m_fileSize(0), m_numFrames(0), m_numPages(0), m_binary(false), m_bytes(0),
+m_indexBytes(0), m_indexedBytes(0), m_indexed(true), m_binaryOut(NULL), m_binaryFrames(0), m_binaryPending(false),
+m_residentPages(0), m_playheadPage(0), m_direction(1), m_lastFrame(0), m_useCounter(0), m_playhead(NULL), m_prefetchPending(true)
+{
+	if (!binary_file.empty() && openBinary(binary_file, transformation_file))
+	{
+		m_filename = binary_file;
+		m_binary = true;
+		m_numPages = (m_numFrames + TRACK_PAGE_FRAMES - 1) / TRACK_PAGE_FRAMES;
+		m_pages.resize(m_numPages, NULL);
+	}
+	else
+	{
+		//the csv is indexed by the worker
+		struct stat source;
+		if (stat(m_filename.c_str(), &source) == 0)
+		{
+			m_fileSize = source.st_size;
+			m_indexed = false;
+			m_binaryFile = binary_file;
+		}
+		else
+		{
+			std::cerr << "Could not open " << m_filename << std::endl;
+		}
+	}
+	addToWorker();
+}
+
+XMATransformTrack::~XMATransformTrack()
+{
+	removeFromWorker();
+	//a binary copy which was not finished is removed
+	if (m_binaryOut)
+	{
+		fclose(m_binaryOut);
+		remove(m_binaryTemporary.c_str());
+	}
+
+	for (std::vector<Page*>::iterator it = m_pages.begin(); it != m_pages.end(); ++it)
+	{
+		if (*it)
+			deletePage(*it);
+	}
+	m_pages.clear();
+
+	m_bytes -= m_indexBytes;
+	VRMemoryTracker::getInstance()->release(memoryCategory(), m_indexBytes);
+}
+
+int XMATransformTrack::size()
+{
+	return m_numFrames;
+}
+
+bool XMATransformTrack::isIndexed()
+{
+	return m_indexed;
+}
+
+void XMATransformTrack::waitForIndex()
+{
+	//the worker notifies after every step
+	TrackWorker &worker = trackWorker();
+	std::unique_lock<std::mutex> lock(worker.mutex);
+	worker.condition.wait(lock, [this]{ return (bool)m_indexed; });
+}
+
+bool XMATransformTrack::isBinary()
+{
+	return m_binary;
+}
+
+long long XMATransformTrack::getBytes()
+{
+	return m_bytes;
+}
+
+bool XMATransformTrack::isVisible(int frame)
+{
+	if (frame < 0 || frame >= m_numFrames)
+		return false;
+
+	Page * page = m_playhead.load(std::memory_order_acquire);
+	if (page && frame >= page->first && frame < page->first + TRACK_PAGE_FRAMES)
+		return page->visible[frame - page->first] != 0;
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	return residentPage(lock, frame / TRACK_PAGE_FRAMES)->visible[frame % TRACK_PAGE_FRAMES] != 0;
+}
+
+void XMATransformTrack::getTransformation(int frame, float* matrix)
+{
+	if (frame < 0 || frame >= m_numFrames)
+	{
+		setIdentity(matrix);
+		return;
+	}
+
+	Page * page = m_playhead.load(std::memory_order_acquire);
+	if (page && frame >= page->first && frame < page->first + TRACK_PAGE_FRAMES)
+	{
+		memcpy(matrix, &page->matrices[16 * (frame - page->first)], 16 * sizeof(float));
+		return;
+	}
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	page = residentPage(lock, frame / TRACK_PAGE_FRAMES);
+	memcpy(matrix, &page->matrices[16 * (frame % TRACK_PAGE_FRAMES)], 16 * sizeof(float));
+}
+
+void XMATransformTrack::readRange(int first, int count, float * matrices, unsigned char * visible)
+{
+	VRTraceRecorder::Scope trace("XMATransformTrack::readRange");
+	FILE * file = NULL;
+	int end = first + count;
+	for (int frame = first; frame < end;)
+	{
+		float * m = matrices + 16 * (size_t)(frame - first);
+		unsigned char * v = visible + (frame - first);
+		if (frame < 0 || frame >= m_numFrames)
+		{
+			setIdentity(m);
+			*v = 0;
+			frame++;
+			continue;
+		}
+
+		//the frames of one page at a time
+		int page = frame / TRACK_PAGE_FRAMES;
+		int last = (page + 1) * TRACK_PAGE_FRAMES;
+		if (last > m_numFrames) last = m_numFrames;
+		if (last > end) last = end;
+
+		bool resident;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			resident = m_pages[page] != NULL;
+			if (resident)
+			{
+				int offset = frame - page * TRACK_PAGE_FRAMES;
+				memcpy(m, &m_pages[page]->matrices[16 * offset], 16 * sizeof(float) * (last - frame));
+				memcpy(v, &m_pages[page]->visible[offset], last - frame);
+			}
+		}
+		if (!resident)
+		{
+			if (!file)
+				file = fopen(m_filename.c_str(), "rb");
+			readFrames(file, frame, last, m, v);
+		}
+		frame = last;
+	}
+	if (file)
+		fclose(file);
+}
+
+void XMATransformTrack::setPlayhead(int frame)
+{
+	bool changed = false;
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		//no page of the csv is indexed yet, the worker prefetches the first ones when it is
+		if (m_numPages == 0)
+			return;
+
+		int delta = frame - m_lastFrame;
+		//a large jump is the playback wrapping around
+		if (abs(delta) > m_numFrames / 2)
+			delta = -delta;
+
+		int direction = m_direction;
+		if (delta > 0) direction = 1;
+		if (delta < 0) direction = -1;
+
+		int page = wrapPage(frame / TRACK_PAGE_FRAMES);
+		if (page != m_playheadPage || direction != m_direction)
+		{
+			m_playheadPage = page;
+			m_direction = direction;
+			m_prefetchPending = true;
+			changed = true;
+		}
+		m_lastFrame = frame;
+
+		//the playhead page is in the window, so it stays resident until the playhead leaves it
+		if (changed || !m_playhead.load(std::memory_order_relaxed))
+			m_playhead.store(residentPage(lock, page), std::memory_order_release);
+	}
+	if (changed)
+		wakeWorker();
+}
+
+void XMATransformTrack::indexChunk()
+{
+	VRTraceRecorder::Scope trace("XMATransformTrack::indexChunk");
+	std::vector<char> buffer((size_t)std::min<long long>(INDEX_CHUNK_SIZE, m_fileSize - m_indexedBytes));
+	size_t read = 0;
+	FILE * file = fopen(m_filename.c_str(), "rb");
+	if (file && !buffer.empty() && seekFile(file, m_indexedBytes) == 0)
+		read = fread(&buffer[0], 1, buffer.size(), file);
+	if (file)
+		fclose(file);
+	else
+		std::cerr << "Could not open " << m_filename << std::endl;
+
+	//every line ending starts the next frame, the first one ends the header
+	std::vector<long long> starts;
+	if (read > 0)
+	{
+		const char * start = &buffer[0];
+		const char * end = start + read;
+		const char * pos = start;
+		while ((pos = (const char *)memchr(pos, '\n', end - pos)) != NULL)
+		{
+			starts.push_back(m_indexedBytes + (pos - start) + 1);
+			pos++;
+		}
+	}
+	m_indexedBytes += read;
+	//a file which became shorter or cannot be read ends here
+	bool finished = m_indexedBytes >= m_fileSize || read < buffer.size();
+
+	int frames;
+	long long bytes;
+	{
+		std::lock_guard<std::mutex> lock(m_indexMutex);
+		m_lineOffsets.insert(m_lineOffsets.end(), starts.begin(), starts.end());
+		//also handle the case when the last line has no line ending
+		if (finished && !m_lineOffsets.empty() && m_lineOffsets.back() < m_indexedBytes)
+			m_lineOffsets.push_back(m_indexedBytes);
+		frames = m_lineOffsets.empty() ? 0 : m_lineOffsets.size() - 1;
+		bytes = m_lineOffsets.capacity() * sizeof(long long);
+	}
+	m_bytes += bytes - m_indexBytes;
+	VRMemoryTracker::getInstance()->allocate(memoryCategory(), bytes - m_indexBytes);
+	m_indexBytes = bytes;
+
+	//pages are only read once all of their frames are indexed
+	if (!finished)
+		frames -= frames % TRACK_PAGE_FRAMES;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		int pages = (frames + TRACK_PAGE_FRAMES - 1) / TRACK_PAGE_FRAMES;
+		if (pages > m_numPages)
+		{
+			m_numPages = pages;
+			m_pages.resize(m_numPages, NULL);
+			m_prefetchPending = true;
+		}
+		m_numFrames = frames;
+	}
+
+	if (finished)
+	{
+		m_fileSize = m_indexedBytes;
+		m_binaryPending = !m_binaryFile.empty() && frames > 0;
+		m_indexed = true;
+		std::cerr << "Indexed " << frames << " frames of " << m_filename << std::endl;
+	}
+}
+
+bool XMATransformTrack::openBinary(const std::string &binary_file, const std::string &transformation_file)
+{
+	struct stat source, binary;
+	if (stat(binary_file.c_str(), &binary) != 0)
+		return false;
+	if (stat(transformation_file.c_str(), &source) == 0 && binary.st_mtime < source.st_mtime)
+		return false;
+
+	FILE * file = fopen(binary_file.c_str(), "rb");
+	if (!file)
+		return false;
+	char header[TRACK_BINARY_HEADER];
+	bool valid = fread(header, 1, TRACK_BINARY_HEADER, file) == TRACK_BINARY_HEADER && memcmp(header, TRACK_BINARY_MAGIC, 8) == 0;
+	fclose(file);
+
+	int frames = 0;
+	memcpy(&frames, header + 8, sizeof(int));
+	//files which were not written completely are written again
+	if (!valid || frames < 0 || (long long)binary.st_size != TRACK_BINARY_HEADER + (long long)frames * (long long)TRACK_BINARY_FRAME)
+	{
+		std::cerr << "Ignoring the invalid binary track " << binary_file << std::endl;
+		return false;
+	}
+	m_numFrames = frames;
+	m_fileSize = binary.st_size;
+	return true;
+}
+
+void XMATransformTrack::writeBinaryPage()
+{
+	VRTraceRecorder::Scope trace("XMATransformTrack::writeBinaryPage");
+	bool written = true;
+	if (!m_binaryOut)
+	{
+		//written under a name of this process and then moved into place, so that a trial opened
+		//meanwhile never reads a partial copy
+		m_binaryTemporary = m_binaryFile + "." + std::to_string((long long)getpid()) + ".tmp";
+		m_binaryOut = fopen(m_binaryTemporary.c_str(), "wb");
+		if (!m_binaryOut)
+		{
+			//e.g. read-only trials, the csv is read every time
+			m_binaryPending = false;
+			return;
+		}
+		char header[TRACK_BINARY_HEADER] = { 0 };
+		int frames = m_numFrames;
+		memcpy(header, TRACK_BINARY_MAGIC, 8);
+		memcpy(header + 8, &frames, sizeof(int));
+		written = fwrite(header, 1, TRACK_BINARY_HEADER, m_binaryOut) == TRACK_BINARY_HEADER;
+	}
+
+	int first = m_binaryFrames;
+	int count = std::min(TRACK_PAGE_FRAMES, (int)m_numFrames - first);
+	if (written && count > 0)
+	{
+		std::vector<float> matrices(16 * count);
+		std::vector<unsigned char> visible(count);
+		FILE * source = fopen(m_filename.c_str(), "rb");
+		readFrames(source, first, first + count, &matrices[0], &visible[0]);
+		if (source)
+			fclose(source);
+		for (int i = 0; i < count; i++)
+		{
+			if (!visible[i])
+			{
+				for (int k = 0; k < 16; k++)
+					matrices[16 * i + k] = NAN;
+			}
+		}
+		written = fwrite(&matrices[0], TRACK_BINARY_FRAME, count, m_binaryOut) == (size_t)count;
+		m_binaryFrames += count;
+	}
+	if (written && m_binaryFrames < m_numFrames)
+		return;
+
+	m_binaryPending = false;
+	bool closed = fclose(m_binaryOut) == 0;
+	m_binaryOut = NULL;
+	//rename does not replace an existing file on Windows
+	if (!written || !closed || (rename(m_binaryTemporary.c_str(), m_binaryFile.c_str()) != 0 &&
+		(remove(m_binaryFile.c_str()) != 0 || rename(m_binaryTemporary.c_str(), m_binaryFile.c_str()) != 0)))
+	{
+		std::cerr << "Could not write " << m_binaryFile << std::endl;
+		remove(m_binaryTemporary.c_str());
+		return;
+	}
+	std::cerr << "Wrote " << m_binaryFile << std::endl;
+}
+
+void XMATransformTrack::readFrames(FILE * file, int first, int last, float * matrices, unsigned char * visible)
+{
+	if (m_binary)
+	{
+		size_t read = 0;
+		if (file && seekFile(file, TRACK_BINARY_HEADER + (long long)first * TRACK_BINARY_FRAME) == 0)
+			read = fread(matrices, TRACK_BINARY_FRAME, last - first, file);
+		if (read != (size_t)(last - first))
+			std::cerr << "Could not read frames " << first << " to " << last << " of " << m_filename << std::endl;
+		for (int i = 0; i < last - first; i++)
+		{
+			float * matrix = &matrices[16 * i];
+			visible[i] = (i < (int)read && matrix[0] == matrix[0]) ? 1 : 0;
+			if (!visible[i])
+				setIdentity(matrix);
+		}
+		return;
+	}
+
+	for (int i = 0; i < last - first; i++)
+	{
+		setIdentity(&matrices[16 * i]);
+		visible[i] = 0;
+	}
+
+	//the worker may extend the index meanwhile
+	std::vector<long long> offsets;
+	{
+		std::lock_guard<std::mutex> lock(m_indexMutex);
+		offsets.assign(m_lineOffsets.begin() + first, m_lineOffsets.begin() + last + 1);
+	}
+	long long base = offsets[0];
+	std::vector<char> buffer(offsets[last - first] - base + 1, '\0');
+	size_t read = 0;
+	if (file && seekFile(file, base) == 0)
+		read = fread(&buffer[0], 1, buffer.size() - 1, file);
+	if (read != buffer.size() - 1)
+	{
+		std::cerr << "Could not read frames " << first << " to " << last << " of " << m_filename << std::endl;
+		return;
+	}
+
+	for (int i = 0; i < last - first; i++)
+		parseLine(&buffer[offsets[i] - base], &buffer[offsets[i + 1] - base], &matrices[16 * i], &visible[i]);
+}
+
+XMATransformTrack::Page* XMATransformTrack::loadPage(int page)
+{
+	VRTraceRecorder::Scope trace("XMATransformTrack::loadPage");
+	int first = page * TRACK_PAGE_FRAMES;
+	int last = std::min(first + TRACK_PAGE_FRAMES, (int)m_numFrames);
+
+	Page * p = new Page();
+	p->matrices.resize(16 * TRACK_PAGE_FRAMES);
+	p->visible.resize(TRACK_PAGE_FRAMES, 0);
+	p->first = first;
+	p->lastUse = 0;
+	m_bytes += pageBytes(TRACK_PAGE_FRAMES);
+	VRMemoryTracker::getInstance()->allocate(memoryCategory(), pageBytes(TRACK_PAGE_FRAMES));
+	//frames past the end of the track are the identity
+	for (int i = last - first; i < TRACK_PAGE_FRAMES; i++)
+		setIdentity(&p->matrices[16 * i]);
+
+	//the file is opened for every page, tracks keep no file open between pages
+	FILE * file = fopen(m_filename.c_str(), "rb");
+	readFrames(file, first, last, &p->matrices[0], &p->visible[0]);
+	if (file)
+		fclose(file);
+	return p;
+}
+
+void XMATransformTrack::deletePage(Page * page)
+{
+	m_bytes -= pageBytes(TRACK_PAGE_FRAMES);
+	VRMemoryTracker::getInstance()->release(memoryCategory(), pageBytes(TRACK_PAGE_FRAMES));
+	delete page;
+}
+
+XMATransformTrack::Page* XMATransformTrack::residentPage(std::unique_lock<std::mutex> &lock, int page)
+{
+	if (!m_pages[page])
+	{
+		//parse outside of the lock so the worker is not blocked
+		lock.unlock();
+		Page * loaded = loadPage(page);
+		lock.lock();
+		insertPage(page, loaded);
+	}
+	m_pages[page]->lastUse = ++m_useCounter;
+	return m_pages[page];
+}
+
+void XMATransformTrack::insertPage(int page, Page * loaded)
+{
+	//the page may have been loaded by another thread meanwhile
+	if (m_pages[page])
+	{
+		deletePage(loaded);
+		return;
+	}
+	m_pages[page] = loaded;
+	m_residentPages++;
+	//only a new page can push the pages over the limit, the new one is used last
+	loaded->lastUse = ++m_useCounter;
+	evictPages();
+}
+
+void XMATransformTrack::evictPages()
+{
+	//drop the least recently used pages outside of the window
+	while (m_residentPages > TRACK_PAGES_AHEAD + TRACK_PAGES_BEHIND + 1 + TRACK_PAGES_SLACK)
+	{
+		int oldest = -1;
+		for (int i = 0; i < m_numPages; i++)
+		{
+			if (m_pages[i] && !isInWindow(i) && (oldest == -1 || m_pages[i]->lastUse < m_pages[oldest]->lastUse))
+				oldest = i;
+		}
+		if (oldest == -1)
+			return;
+
+		deletePage(m_pages[oldest]);
+		m_pages[oldest] = NULL;
+		m_residentPages--;
+	}
+}
+
+bool XMATransformTrack::isInWindow(int page)
+{
+	int d = wrapPage(page - m_playheadPage);
+	if (d > m_numPages / 2) d -= m_numPages;
+	d *= m_direction;
+	return d >= -TRACK_PAGES_BEHIND && d <= TRACK_PAGES_AHEAD;
+}
+
+int XMATransformTrack::wrapPage(int page)
+{
+	return ((page % m_numPages) + m_numPages) % m_numPages;
+}
+
+void XMATransformTrack::prefetchPage()
+{
+	//the playhead page first, then the pages ahead and finally the ones behind
+	std::unique_lock<std::mutex> lock(m_mutex);
+	int page = -1;
+	if (m_numPages == 0)
+	{
+		m_prefetchPending = false;
+		return;
+	}
+	for (int k = 0; k <= TRACK_PAGES_AHEAD + TRACK_PAGES_BEHIND && page == -1; k++)
+	{
+		int offset = (k <= TRACK_PAGES_AHEAD) ? k : TRACK_PAGES_AHEAD - k;
+		int p = wrapPage(m_playheadPage + offset * m_direction);
+		if (!m_pages[p])
+			page = p;
+	}
+	if (page == -1)
+	{
+		m_prefetchPending = false;
+		return;
+	}
+
+	lock.unlock();
+	Page * loaded = loadPage(page);
+	lock.lock();
+	insertPage(page, loaded);
+}
+
+void XMATransformTrack::addToWorker()
+{
+	TrackWorker &worker = trackWorker();
+	std::lock_guard<std::mutex> lock(worker.mutex);
+	worker.tracks.push_back(this);
+	if (!worker.thread)
+		worker.thread = new std::thread(&XMATransformTrack::work);
+	worker.condition.notify_all();
+}
+
+void XMATransformTrack::removeFromWorker()
+{
+	TrackWorker &worker = trackWorker();
+	std::thread * thread = NULL;
+	{
+		std::unique_lock<std::mutex> lock(worker.mutex);
+		//the worker finishes the step it takes for this track
+		worker.condition.wait(lock, [&]{ return worker.busy != this; });
+		worker.tracks.erase(std::find(worker.tracks.begin(), worker.tracks.end(), this));
+		//the thread ends with the last track, the next track starts a new one
+		if (worker.tracks.empty())
+		{
+			thread = worker.thread;
+			worker.thread = NULL;
+		}
+		worker.condition.notify_all();
+	}
+	if (thread)
+	{
+		thread->join();
+		delete thread;
+	}
+}
+
+void XMATransformTrack::wakeWorker()
+{
+	//taking the mutex orders the flag set by the caller before the worker's next look at it
+	TrackWorker &worker = trackWorker();
+	{
+		std::lock_guard<std::mutex> lock(worker.mutex);
+	}
+	worker.condition.notify_all();
+}
+
+void XMATransformTrack::work()
+{
+	VRTraceRecorder::getInstance()->setThreadName("Track prefetch");
+	TrackWorker &worker = trackWorker();
+	std::unique_lock<std::mutex> lock(worker.mutex);
+	size_t next = 0;
+	//a thread which was replaced after the last track was removed ends
+	while (worker.thread && worker.thread->get_id() == std::this_thread::get_id())
+	{
+		//a page to prefetch first, then a chunk of an index and last a page of a binary copy. The
+		//tracks are taken in turn, so every bone gets its playhead page early
+		XMATransformTrack * track = NULL;
+		int job = 0;
+		for (int j = 0; j < 3 && !track; j++)
+		{
+			for (size_t i = 0; i < worker.tracks.size() && !track; i++)
+			{
+				XMATransformTrack * t = worker.tracks[(next + i) % worker.tracks.size()];
+				bool pending = (j == 0) ? t->m_prefetchPending.load() : (j == 1) ? !t->m_indexed : t->m_binaryPending.load();
+				if (pending)
+				{
+					track = t;
+					job = j;
+					next = (next + i + 1) % worker.tracks.size();
+				}
+			}
+		}
+		if (!track)
+		{
+			worker.condition.wait(lock);
+			continue;
+		}
+
+		worker.busy = track;
+		lock.unlock();
+		if (job == 0)
+			track->prefetchPage();
+		else if (job == 1)
+			track->indexChunk();
+		else
+			track->writeBinaryPage();
+		lock.lock();
+		worker.busy = NULL;
+		worker.condition.notify_all();
+	}
+}
+
+void XMATransformTrack::parseLine(const char * line, const char * end, float * matrix, unsigned char * visible)
+{
+	*visible = 0;
+	if (end - line >= 3 && strncmp(line, "NaN", 3) == 0)
+		return;
+
+	float values[16];
+	int count = 0;
+	const char * pos = line;
+	while (pos < end)
+	{
+		while (pos < end && (*pos == ' ' || *pos == '\t'))
+			pos++;
+		if (pos >= end || *pos == '\r' || *pos == '\n')
+			break;
+
+		char * next;
+		double value = strtod(pos, &next);
+		if (next == pos || value != value)
+			break;
+		if (count < 16)
+			values[count] = value;
+		count++;
+
+		pos = next;
+		while (pos < end && (*pos == ' ' || *pos == '\t'))
+			pos++;
+		if (pos >= end || *pos != ',')
+			break;
+		pos++;
+	}
+
+	if (count == 16)
+	{
+		*visible = 1;
+		memcpy(matrix, values, 16 * sizeof(float));
+	}
+}
@@ -0,0 +1,128 @@
+#ifndef XMATRANSFORMTRACK_H
+#define XMATRANSFORMTRACK_H
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+
+// Number of frames parsed and kept together as one page
+#define TRACK_PAGE_FRAMES 256
+// Pages kept resident ahead of and behind the playhead (in playback direction)
+#define TRACK_PAGES_AHEAD 8
+#define TRACK_PAGES_BEHIND 2
+// Additional pages which may stay resident after random access outside of the window
+#define TRACK_PAGES_SLACK 4
+// First 8 bytes of a binary track
+#define TRACK_BINARY_MAGIC "XMATRK1\n"
+
+// A transformation track read from an XROMM transformation csv. The constructor does not read
+// the csv. The byte offset of every line is indexed in the background, and the frames grow as
+// complete pages are indexed. The 4x4 matrices are parsed in pages on demand and only a window
+// of pages around the playhead is kept in memory. One background thread shared by all tracks
+// prefetches the pages ahead of each playhead in its playback direction, indexes the csvs and
+// writes the binary copies, a step at a time for one track after the other. Prefetching comes
+// first. No file of a track is kept open.
+//
+// A track can also be read from a binary copy of the csv: a header of TRACK_BINARY_MAGIC and
+// the number of frames as 32 bit integer, followed by the 16 floats of every frame, NaN for
+// frames which are not tracked. The frames are read without parsing or an index. Values are
+// stored in the byte order of the machine which wrote the file.
+class XMATransformTrack
+{
+public:
+	//reads binary_file instead of the csv if it is at least as new as the csv. Otherwise the
+	//binary copy is written in the background once the csv is indexed, for the next time
+	XMATransformTrack(std::string transformation_file, std::string binary_file = "");
+	~XMATransformTrack();
+
+	//frames indexed so far, all frames once isIndexed is true
+	int size();
+	//true once the whole csv is indexed, always for binary tracks
+	bool isIndexed();
+	//blocks until isIndexed is true
+	void waitForIndex();
+	//true if the track is read from the binary copy
+	bool isBinary();
+	//bytes of the line index and the resident pages, counted in the Transform tracks
+	//category of the VRMemoryTracker
+	long long getBytes();
+	//frames of the playhead page are read without a lock, others as by readRange but keeping the
+	//page. Call them from the thread which moves the playhead, or while it does not move it
+	bool isVisible(int frame);
+	//copies the column major 4x4 matrix of the frame to matrix[16]
+	void getTransformation(int frame, float * matrix);
+	//copies count frames from first on to matrices[16 * count] and visible[count], for a pass over
+	//many frames. Resident pages are copied, the others are read with a file of the caller and
+	//not kept, so the pages around the playhead stay as they are. Frames outside of the track
+	//are the identity and not visible. Can be called from several threads at once
+	void readRange(int first, int count, float * matrices, unsigned char * visible);
+	//moves the playhead, once per frame before the frame is drawn. The direction for prefetching
+	//is derived from the last playhead. The page of the playhead is read here if the worker did
+	//not prefetch it, and stays resident until the playhead leaves it
+	void setPlayhead(int frame);
+
+private:
+	struct Page
+	{
+		std::vector<float> matrices;
+		std::vector<unsigned char> visible;
+		int first;	//frame
+		unsigned long long lastUse;
+	};
+
+	void indexChunk();
+	bool openBinary(const std::string &binary_file, const std::string &transformation_file);
+	void writeBinaryPage();
+	void readFrames(FILE * file, int first, int last, float * matrices, unsigned char * visible);
+	Page * loadPage(int page);
+	void deletePage(Page * page);
+	Page * residentPage(std::unique_lock<std::mutex> &lock, int page);
+	void insertPage(int page, Page * loaded);
+	void evictPages();
+	bool isInWindow(int page);
+	int wrapPage(int page);
+	void prefetchPage();
+	void addToWorker();
+	void removeFromWorker();
+	static void wakeWorker();
+	static void work();
+	static void parseLine(const char * line, const char * end, float * matrix, unsigned char * visible);
+
+	std::string m_filename;
+	long long m_fileSize;
+	std::atomic<int> m_numFrames;
+	int m_numPages;
+	bool m_binary;
+	std::atomic<long long> m_bytes;
+
+	//start of every line after the header, the last one ends the last frame
+	std::vector<long long> m_lineOffsets;
+	std::mutex m_indexMutex;
+	long long m_indexBytes;
+	long long m_indexedBytes;	//of the file, read by the worker only
+	std::atomic<bool> m_indexed;
+
+	//binary copy written by the worker
+	std::string m_binaryFile;
+	std::string m_binaryTemporary;
+	FILE * m_binaryOut;
+	int m_binaryFrames;
+	std::atomic<bool> m_binaryPending;
+
+	std::vector<Page *> m_pages;
+	int m_residentPages;
+	int m_playheadPage;
+	int m_direction;
+	int m_lastFrame;
+	unsigned long long m_useCounter;
+	//page of the playhead, which is never evicted
+	std::atomic<Page *> m_playhead;
+
+	std::mutex m_mutex;
+	//set with the playhead, cleared by the worker once the window around it is resident
+	std::atomic<bool> m_prefetchPending;
+};
+
+#endif //XMATRANSFORMTRACK_H
@@ -17,19 +17,80 @@ coordinate generation (spheremap and planar projections) + more.
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <vector>
+#include <thread>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <algorithm>
 #include "glm.h"
+#include "VRTraceRecorder.h"
 
 
 #define T(x) (model->triangles[(x)])
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define GLM_SSE2
+#include <emmintrin.h>
 
-/* _GLMnode: general purpose node
+/* glmLoad3, glmStore3: move the three floats of a vector without
+* touching the float after it, which may be past the end of an array.
 */
-typedef struct _GLMnode {
-	GLuint           index;
-	GLboolean        averaged;
-	struct _GLMnode* next;
-} GLMnode;
+static inline __m128
+	glmLoad3(const GLfloat* v)
+{
+	return _mm_movelh_ps(_mm_loadl_pi(_mm_setzero_ps(), (const __m64*)v), _mm_load_ss(v + 2));
+}
+
+static inline GLvoid
+	glmStore3(GLfloat* v, __m128 a)
+{
+	_mm_storel_pi((__m64*)v, a);
+	_mm_store_ss(v + 2, _mm_movehl_ps(a, a));
+}
+
+/* glmGather4: loads vertex j of four triangles and returns the x, y
+* and z coordinates of the four in separate vectors.
+*/
+static inline GLvoid
+	glmGather4(const GLfloat* vertices, const GLMtriangle* triangles, GLuint j, __m128& x, __m128& y, __m128& z)
+{
+	__m128 w;
+	x = glmLoad3(&vertices[3 * triangles[0].vindices[j]]);
+	y = glmLoad3(&vertices[3 * triangles[1].vindices[j]]);
+	z = glmLoad3(&vertices[3 * triangles[2].vindices[j]]);
+	w = glmLoad3(&vertices[3 * triangles[3].vindices[j]]);
+	_MM_TRANSPOSE4_PS(x, y, z, w);
+}
+#endif
+
+
+/* glmParallelFor: calls func(first, last) on consecutive ranges of
+* [begin, end) from one thread per core.  Small ranges run on the
+* calling thread.
+*/
+#define GLM_PARALLEL_MIN_ITEMS 16384
+
+static GLvoid
+	glmParallelFor(GLuint begin, GLuint end, const std::function<void(GLuint, GLuint)>& func)
+{
+	GLuint count = end > begin ? end - begin : 0;
+	GLuint threads = std::thread::hardware_concurrency();
+	if (threads > count / GLM_PARALLEL_MIN_ITEMS)
+		threads = count / GLM_PARALLEL_MIN_ITEMS;
+	if (threads <= 1) {
+		func(begin, end);
+		return;
+	}
+
+	std::vector<std::thread> workers;
+	GLuint chunk = (count + threads - 1) / threads;
+	for (GLuint first = begin + chunk; first < end; first += chunk)
+		workers.push_back(std::thread(func, first, first + chunk < end ? first + chunk : end));
+	func(begin, begin + chunk);
+	for (size_t t = 0; t < workers.size(); t++)
+		workers[t].join();
+}
 
 
 /* glmMax: returns the maximum of two floats */
@@ -115,46 +176,115 @@ static GLboolean
 	return GL_FALSE;
 }
 
-/* glmWeldVectors: eliminate (weld) vectors that are within an
-* epsilon of each other.
+/* glmWeldIndices: eliminate (weld) vectors that are within an
+* epsilon of each other.  Every vector is mapped to the first kept
+* vector it equals, as a pairwise comparison in order would.  Kept
+* vectors are entered into a hashed uniform grid with cells of the
+* size of epsilon, so a vector equal to another lies in the same or
+* one of the 26 neighbouring cells and only those are searched.
 *
 * vectors    - array of GLfloat[3]'s to be welded
-* numvectors - number of GLfloat[3]'s in vectors
-* epsilon    - maximum difference between vectors 
+* numvectors - number of GLfloat[3]'s in vectors, set to the number kept
+* epsilon    - maximum difference between vectors
+* map        - filled with the index of the kept copy of every vector
 *
+* Returns the kept vectors, starting at index 1.
 */
-GLfloat*
-	glmWeldVectors(GLfloat* vectors, GLuint* numvectors, GLfloat epsilon)
+static GLfloat*
+	glmWeldIndices(GLfloat* vectors, GLuint* numvectors, GLfloat epsilon, std::vector<GLuint>& map)
 {
 	GLfloat* copies;
 	GLuint   copied;
-	GLuint   i, j;
+	GLuint   n = *numvectors;
+	GLuint   i;
 
-	copies = (GLfloat*)malloc(sizeof(GLfloat) * 3 * (*numvectors + 1));
-	memcpy(copies, vectors, (sizeof(GLfloat) * 3 * (*numvectors + 1)));
+	copies = (GLfloat*)malloc(sizeof(GLfloat) * 3 * (n + 1));
+	memcpy(copies, vectors, (sizeof(GLfloat) * 3 * (n + 1)));
+	map.resize(n + 1);
+	map[0] = 0;
 
-	copied = 1;
-	for (i = 1; i <= *numvectors; i++) {
-		for (j = 1; j <= copied; j++) {
-			if (glmEqual(&vectors[3 * i], &copies[3 * j], epsilon)) {
-				goto duplicate;
+	/* nothing is equal for a non-positive epsilon */
+	if (epsilon <= 0) {
+		for (i = 1; i <= n; i++)
+			map[i] = i;
+		return copies;
+	}
+
+	/* grid cell of every vector */
+	std::vector<long long> cells(3 * (n + 1));
+	glmParallelFor(1, n + 1, [&](GLuint begin, GLuint end) {
+		for (GLuint k = begin; k < end; k++) {
+			cells[3 * k + 0] = (long long)floor((double)vectors[3 * k + 0] / epsilon);
+			cells[3 * k + 1] = (long long)floor((double)vectors[3 * k + 1] / epsilon);
+			cells[3 * k + 2] = (long long)floor((double)vectors[3 * k + 2] / epsilon);
+		}
+	});
+
+	/* open hash table of chains of kept vectors, different cells may
+	share a chain as the vectors are compared anyway */
+	GLuint buckets = 1;
+	while (buckets < 2 * n)
+		buckets <<= 1;
+	std::vector<GLuint> head(buckets, 0);
+	std::vector<GLuint> next(n + 1, 0);
+	auto bucket = [buckets](long long x, long long y, long long z) -> GLuint {
+		unsigned long long h = (unsigned long long)x * 73856093ULL ^ (unsigned long long)y * 19349663ULL ^ (unsigned long long)z * 83492791ULL;
+		return (GLuint)((h ^ (h >> 29)) & (buckets - 1));
+	};
+
+	copied = 0;
+	for (i = 1; i <= n; i++) {
+		GLfloat*  v = &vectors[3 * i];
+		long long* c = &cells[3 * i];
+		GLuint    found = 0;
+
+		for (int dx = -1; dx <= 1; dx++) {
+			for (int dy = -1; dy <= 1; dy++) {
+				for (int dz = -1; dz <= 1; dz++) {
+					for (GLuint k = head[bucket(c[0] + dx, c[1] + dy, c[2] + dz)]; k; k = next[k]) {
+						if ((!found || k < found) && glmEqual(v, &copies[3 * k], epsilon))
+							found = k;
+					}
+				}
 			}
 		}
 
-		/* must not be any duplicates -- add to the copies array */
-		copies[3 * copied + 0] = vectors[3 * i + 0];
-		copies[3 * copied + 1] = vectors[3 * i + 1];
-		copies[3 * copied + 2] = vectors[3 * i + 2];
-		j = copied;				/* pass this along for below */
-		copied++;
-
-duplicate:
-		/* set the first component of this vector to point at the correct
-		index into the new copies array */
-		vectors[3 * i + 0] = (GLfloat)j;
+		if (!found) {
+			/* must not be any duplicates -- add to the copies array */
+			copied++;
+			copies[3 * copied + 0] = v[0];
+			copies[3 * copied + 1] = v[1];
+			copies[3 * copied + 2] = v[2];
+			GLuint b = bucket(c[0], c[1], c[2]);
+			next[copied] = head[b];
+			head[b] = copied;
+			found = copied;
+		}
+		map[i] = found;
 	}
 
-	*numvectors = copied-1;
+	*numvectors = copied;
+	return copies;
+}
+
+/* glmWeldVectors: eliminate (weld) vectors that are within an
+* epsilon of each other.
+*
+* vectors    - array of GLfloat[3]'s to be welded
+* numvectors - number of GLfloat[3]'s in vectors
+* epsilon    - maximum difference between vectors 
+*
+* The first component of every vector is set to the index of its
+* kept copy.
+*/
+GLfloat*
+	glmWeldVectors(GLfloat* vectors, GLuint* numvectors, GLfloat epsilon)
+{
+	std::vector<GLuint> map;
+	GLuint n = *numvectors;
+	GLfloat* copies = glmWeldIndices(vectors, numvectors, epsilon, map);
+	for (GLuint i = 1; i <= n; i++)
+		vectors[3 * i + 0] = (GLfloat)map[i];
 	return copies;
 }
 
@@ -764,6 +894,110 @@ static GLvoid
 /* public functions */
 
 
+/* glmBoundsRange: grows min and max by the vertices [begin, end).
+* Four vertices are twelve consecutive floats, with SSE2 they are
+* compared as three vectors and split into x, y and z at the end.
+*/
+static GLvoid
+	glmBoundsRange(const GLfloat* vertices, GLuint begin, GLuint end, GLfloat* min, GLfloat* max)
+{
+	GLuint i = begin;
+
+#ifdef GLM_SSE2
+	if (end - begin >= 4) {
+		const GLfloat* v = &vertices[3 * i];
+		__m128 min0 = _mm_loadu_ps(v), min1 = _mm_loadu_ps(v + 4), min2 = _mm_loadu_ps(v + 8);
+		__m128 max0 = min0, max1 = min1, max2 = min2;
+		for (i += 4; i + 4 <= end; i += 4) {
+			v = &vertices[3 * i];
+			__m128 a = _mm_loadu_ps(v), b = _mm_loadu_ps(v + 4), c = _mm_loadu_ps(v + 8);
+			min0 = _mm_min_ps(min0, a); max0 = _mm_max_ps(max0, a);
+			min1 = _mm_min_ps(min1, b); max1 = _mm_max_ps(max1, b);
+			min2 = _mm_min_ps(min2, c); max2 = _mm_max_ps(max2, c);
+		}
+
+		GLfloat lo[12], hi[12];
+		_mm_storeu_ps(lo, min0); _mm_storeu_ps(lo + 4, min1); _mm_storeu_ps(lo + 8, min2);
+		_mm_storeu_ps(hi, max0); _mm_storeu_ps(hi + 4, max1); _mm_storeu_ps(hi + 8, max2);
+		for (GLuint k = 0; k < 12; k++) {
+			if (min[k % 3] > lo[k])
+				min[k % 3] = lo[k];
+			if (max[k % 3] < hi[k])
+				max[k % 3] = hi[k];
+		}
+	}
+#endif
+
+	for (; i < end; i++) {
+		for (GLuint k = 0; k < 3; k++) {
+			if (max[k] < vertices[3 * i + k])
+				max[k] = vertices[3 * i + k];
+			if (min[k] > vertices[3 * i + k])
+				min[k] = vertices[3 * i + k];
+		}
+	}
+}
+
+/* glmBounds: finds the minimum and maximum coordinates of the
+* vertices of a model.
+*/
+static GLvoid
+	glmBounds(GLMmodel* model, GLfloat* min, GLfloat* max)
+{
+	std::mutex lock;
+
+	min[0] = max[0] = model->vertices[3 + 0];
+	min[1] = max[1] = model->vertices[3 + 1];
+	min[2] = max[2] = model->vertices[3 + 2];
+	glmParallelFor(1, model->numvertices + 1, [&](GLuint begin, GLuint end) {
+		GLfloat lo[3], hi[3];
+		lo[0] = hi[0] = model->vertices[3 * begin + 0];
+		lo[1] = hi[1] = model->vertices[3 * begin + 1];
+		lo[2] = hi[2] = model->vertices[3 * begin + 2];
+		glmBoundsRange(model->vertices, begin, end, lo, hi);
+
+		std::lock_guard<std::mutex> guard(lock);
+		for (GLuint k = 0; k < 3; k++) {
+			if (min[k] > lo[k])
+				min[k] = lo[k];
+			if (max[k] < hi[k])
+				max[k] = hi[k];
+		}
+	});
+}
+
+/* glmTransformVertices: translates the vertices of a model by -offset
+* and then scales them by scale.
+*/
+static GLvoid
+	glmTransformVertices(GLMmodel* model, const GLfloat* offset, GLfloat scale)
+{
+	glmParallelFor(1, model->numvertices + 1, [&](GLuint begin, GLuint end) {
+		GLfloat* vertices = model->vertices;
+		GLuint i = begin;
+
+#ifdef GLM_SSE2
+		/* the offsets of four vertices, lined up with three vectors */
+		__m128 o0 = _mm_setr_ps(offset[0], offset[1], offset[2], offset[0]);
+		__m128 o1 = _mm_setr_ps(offset[1], offset[2], offset[0], offset[1]);
+		__m128 o2 = _mm_setr_ps(offset[2], offset[0], offset[1], offset[2]);
+		__m128 s = _mm_set1_ps(scale);
+		for (; i + 4 <= end; i += 4) {
+			GLfloat* v = &vertices[3 * i];
+			_mm_storeu_ps(v, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(v), o0), s));
+			_mm_storeu_ps(v + 4, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(v + 4), o1), s));
+			_mm_storeu_ps(v + 8, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(v + 8), o2), s));
+		}
+#endif
+
+		for (; i < end; i++) {
+			vertices[3 * i + 0] = (vertices[3 * i + 0] - offset[0]) * scale;
+			vertices[3 * i + 1] = (vertices[3 * i + 1] - offset[1]) * scale;
+			vertices[3 * i + 2] = (vertices[3 * i + 2] - offset[2]) * scale;
+		}
+	});
+}
+
 /* glmUnitize: "unitize" a model by translating it to the origin and
 * scaling it to fit in a unit cube around the origin.  Returns the
 * scalefactor used.
@@ -773,57 +1007,31 @@ static GLvoid
 GLfloat
 	glmUnitize(GLMmodel* model)
 {
-	GLuint  i;
-	GLfloat maxx, minx, maxy, miny, maxz, minz;
-	GLfloat cx, cy, cz, w, h, d;
+	GLfloat min[3], max[3], center[3];
+	GLfloat w, h, d;
 	GLfloat scale;
 
 	assert(model);
 	assert(model->vertices);
 
 	/* get the max/mins */
-	maxx = minx = model->vertices[3 + 0];
-	maxy = miny = model->vertices[3 + 1];
-	maxz = minz = model->vertices[3 + 2];
-	for (i = 1; i <= model->numvertices; i++) {
-		if (maxx < model->vertices[3 * i + 0])
-			maxx = model->vertices[3 * i + 0];
-		if (minx > model->vertices[3 * i + 0])
-			minx = model->vertices[3 * i + 0];
-
-		if (maxy < model->vertices[3 * i + 1])
-			maxy = model->vertices[3 * i + 1];
-		if (miny > model->vertices[3 * i + 1])
-			miny = model->vertices[3 * i + 1];
-
-		if (maxz < model->vertices[3 * i + 2])
-			maxz = model->vertices[3 * i + 2];
-		if (minz > model->vertices[3 * i + 2])
-			minz = model->vertices[3 * i + 2];
-	}
+	glmBounds(model, min, max);
 
 	/* calculate model width, height, and depth */
-	w = glmAbs(maxx) + glmAbs(minx);
-	h = glmAbs(maxy) + glmAbs(miny);
-	d = glmAbs(maxz) + glmAbs(minz);
+	w = glmAbs(max[0]) + glmAbs(min[0]);
+	h = glmAbs(max[1]) + glmAbs(min[1]);
+	d = glmAbs(max[2]) + glmAbs(min[2]);
 
 	/* calculate center of the model */
-	cx = (maxx + minx) / 2.0;
-	cy = (maxy + miny) / 2.0;
-	cz = (maxz + minz) / 2.0;
+	center[0] = (max[0] + min[0]) / 2.0;
+	center[1] = (max[1] + min[1]) / 2.0;
+	center[2] = (max[2] + min[2]) / 2.0;
 
 	/* calculate unitizing scale factor */
 	scale = 2.0 / glmMax(glmMax(w, h), d);
 
 	/* translate around center then scale */
-	for (i = 1; i <= model->numvertices; i++) {
-		model->vertices[3 * i + 0] -= cx;
-		model->vertices[3 * i + 1] -= cy;
-		model->vertices[3 * i + 2] -= cz;
-		model->vertices[3 * i + 0] *= scale;
-		model->vertices[3 * i + 1] *= scale;
-		model->vertices[3 * i + 2] *= scale;
-	}
+	glmTransformVertices(model, center, scale);
 
 	return scale;
 }
@@ -837,38 +1045,19 @@ GLfloat
 GLvoid
 	glmDimensions(GLMmodel* model, GLfloat* dimensions)
 {
-	GLuint i;
-	GLfloat maxx, minx, maxy, miny, maxz, minz;
+	GLfloat min[3], max[3];
 
 	assert(model);
 	assert(model->vertices);
 	assert(dimensions);
 
 	/* get the max/mins */
-	maxx = minx = model->vertices[3 + 0];
-	maxy = miny = model->vertices[3 + 1];
-	maxz = minz = model->vertices[3 + 2];
-	for (i = 1; i <= model->numvertices; i++) {
-		if (maxx < model->vertices[3 * i + 0])
-			maxx = model->vertices[3 * i + 0];
-		if (minx > model->vertices[3 * i + 0])
-			minx = model->vertices[3 * i + 0];
-
-		if (maxy < model->vertices[3 * i + 1])
-			maxy = model->vertices[3 * i + 1];
-		if (miny > model->vertices[3 * i + 1])
-			miny = model->vertices[3 * i + 1];
-
-		if (maxz < model->vertices[3 * i + 2])
-			maxz = model->vertices[3 * i + 2];
-		if (minz > model->vertices[3 * i + 2])
-			minz = model->vertices[3 * i + 2];
-	}
+	glmBounds(model, min, max);
 
 	/* calculate model width, height, and depth */
-	dimensions[0] = glmAbs(maxx) + glmAbs(minx);
-	dimensions[1] = glmAbs(maxy) + glmAbs(miny);
-	dimensions[2] = glmAbs(maxz) + glmAbs(minz);
+	dimensions[0] = glmAbs(max[0]) + glmAbs(min[0]);
+	dimensions[1] = glmAbs(max[1]) + glmAbs(min[1]);
+	dimensions[2] = glmAbs(max[2]) + glmAbs(min[2]);
 }
 
 /* glmScale: Scales a model by a given amount.
@@ -879,13 +1068,9 @@ GLvoid
 GLvoid
 	glmScale(GLMmodel* model, GLfloat scale)
 {
-	GLuint i;
+	GLfloat origin[3] = { 0, 0, 0 };
 
-	for (i = 1; i <= model->numvertices; i++) {
-		model->vertices[3 * i + 0] *= scale;
-		model->vertices[3 * i + 1] *= scale;
-		model->vertices[3 * i + 2] *= scale;
-	}
+	glmTransformVertices(model, origin, scale);
 }
 
 /* glmReverseWinding: Reverse the polygon winding for all polygons in
@@ -943,42 +1128,81 @@ GLvoid
 GLvoid
 	glmFacetNormals(GLMmodel* model)
 {
-	GLuint  i;
-	GLfloat u[3];
-	GLfloat v[3];
+	VRTraceRecorder::Scope trace("glmFacetNormals");
 
 	assert(model);
 	assert(model->vertices);
 
-	/* clobber any old facetnormals */
-	if (model->facetnorms)
-		free(model->facetnorms);
-
-	/* allocate memory for the new facet normals */
+	/* allocate memory for the new facet normals, reusing the old ones */
 	model->numfacetnorms = model->numtriangles;
-	model->facetnorms = (GLfloat*)malloc(sizeof(GLfloat) *
+	model->facetnorms = (GLfloat*)realloc(model->facetnorms, sizeof(GLfloat) *
 		3 * (model->numfacetnorms + 1));
 
-	for (i = 0; i < model->numtriangles; i++) {
-		model->triangles[i].findex = i+1;
+	glmParallelFor(0, model->numtriangles, [&](GLuint begin, GLuint end) {
+		const GLfloat* vertices = model->vertices;
+		GLMtriangle* triangles = model->triangles;
+		GLfloat* facetnorms = model->facetnorms;
+		GLuint i = begin;
+
+#ifdef GLM_SSE2
+		/* four triangles at a time with x, y and z in separate
+		   vectors; the operations are those of the scalar code so
+		   the normals come out the same */
+		for (; i + 4 <= end; i += 4) {
+			__m128 x0, y0, z0, x1, y1, z1, x2, y2, z2;
+			glmGather4(vertices, &triangles[i], 0, x0, y0, z0);
+			glmGather4(vertices, &triangles[i], 1, x1, y1, z1);
+			glmGather4(vertices, &triangles[i], 2, x2, y2, z2);
+			triangles[i + 0].findex = i + 1;
+			triangles[i + 1].findex = i + 2;
+			triangles[i + 2].findex = i + 3;
+			triangles[i + 3].findex = i + 4;
+
+			__m128 ux = _mm_sub_ps(x1, x0), uy = _mm_sub_ps(y1, y0), uz = _mm_sub_ps(z1, z0);
+			__m128 vx = _mm_sub_ps(x2, x0), vy = _mm_sub_ps(y2, y0), vz = _mm_sub_ps(z2, z0);
+
+			__m128 nx = _mm_sub_ps(_mm_mul_ps(uy, vz), _mm_mul_ps(uz, vy));
+			__m128 ny = _mm_sub_ps(_mm_mul_ps(uz, vx), _mm_mul_ps(ux, vz));
+			__m128 nz = _mm_sub_ps(_mm_mul_ps(ux, vy), _mm_mul_ps(uy, vx));
+			__m128 l = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, nx), _mm_mul_ps(ny, ny)), _mm_mul_ps(nz, nz)));
+			nx = _mm_div_ps(nx, l);
+			ny = _mm_div_ps(ny, l);
+			nz = _mm_div_ps(nz, l);
+
+			__m128 nw = _mm_setzero_ps();
+			_MM_TRANSPOSE4_PS(nx, ny, nz, nw);
+			glmStore3(&facetnorms[3 * (i + 1)], nx);
+			glmStore3(&facetnorms[3 * (i + 2)], ny);
+			glmStore3(&facetnorms[3 * (i + 3)], nz);
+			glmStore3(&facetnorms[3 * (i + 4)], nw);
+		}
+#endif
 
-		u[0] = model->vertices[3 * T(i).vindices[1] + 0] -
-			model->vertices[3 * T(i).vindices[0] + 0];
-		u[1] = model->vertices[3 * T(i).vindices[1] + 1] -
-			model->vertices[3 * T(i).vindices[0] + 1];
-		u[2] = model->vertices[3 * T(i).vindices[1] + 2] -
-			model->vertices[3 * T(i).vindices[0] + 2];
+		for (; i < end; i++) {
+			const GLfloat* p0 = &vertices[3 * triangles[i].vindices[0]];
+			const GLfloat* p1 = &vertices[3 * triangles[i].vindices[1]];
+			const GLfloat* p2 = &vertices[3 * triangles[i].vindices[2]];
+			GLfloat* n = &facetnorms[3 * (i + 1)];
+			GLfloat u[3], v[3], l;
 
-		v[0] = model->vertices[3 * T(i).vindices[2] + 0] -
-			model->vertices[3 * T(i).vindices[0] + 0];
-		v[1] = model->vertices[3 * T(i).vindices[2] + 1] -
-			model->vertices[3 * T(i).vindices[0] + 1];
-		v[2] = model->vertices[3 * T(i).vindices[2] + 2] -
-			model->vertices[3 * T(i).vindices[0] + 2];
+			triangles[i].findex = i + 1;
 
-		glmCross(u, v, &model->facetnorms[3 * (i+1)]);
-		glmNormalize(&model->facetnorms[3 * (i+1)]);
-	}
+			u[0] = p1[0] - p0[0];
+			u[1] = p1[1] - p0[1];
+			u[2] = p1[2] - p0[2];
+
+			v[0] = p2[0] - p0[0];
+			v[1] = p2[1] - p0[1];
+			v[2] = p2[2] - p0[2];
+
+			glmCross(u, v, n);
+
+			l = (GLfloat)sqrt(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+			n[0] /= l;
+			n[1] /= l;
+			n[2] /= l;
+		}
+	});
 }
 
 /* glmVertexNormals: Generates smooth vertex normals for a model.
@@ -994,20 +1218,20 @@ GLvoid
 * the facet normal.  This tends to preserve hard edges.  The angle to
 * use depends on the model, but 90 degrees is usually a good start.
 *
+* The lists are stored in one array (compressed sparse row), each
+* vertex holding its triangles in descending order, and the vertices
+* are processed in parallel.  Normals are numbered in vertex order, so
+* the result does not depend on the number of threads.
+*
 * model - initialized GLMmodel structure
 * angle - maximum angle (in degrees) to smooth across
 */
 GLvoid
 	glmVertexNormals(GLMmodel* model, GLfloat angle)
 {
-	GLMnode*  node;
-	GLMnode*  tail;
-	GLMnode** members;
-	GLfloat*  normals;
-	GLuint    numnormals;
-	GLfloat   average[3];
-	GLfloat   dot, cos_angle;
-	GLuint    i, avg;
+	VRTraceRecorder::Scope trace("glmVertexNormals");
+	GLfloat   cos_angle;
+	GLuint    i, v, numnormals, orphans;
 
 	assert(model);
 	assert(model->facetnorms);
@@ -1019,131 +1243,128 @@ GLvoid
 	if (model->normals)
 		free(model->normals);
 
-	/* allocate space for new normals */
-	model->numnormals = model->numtriangles * 3; /* 3 normals per triangle */
-	model->normals = (GLfloat*)malloc(sizeof(GLfloat)* 3* (model->numnormals+1));
-
-	/* allocate a structure that will hold a linked list of triangle
-	indices for each vertex */
-	members = (GLMnode**)malloc(sizeof(GLMnode*) * (model->numvertices + 1));
-	for (i = 1; i <= model->numvertices; i++)
-		members[i] = NULL;
-
-	/* for every triangle, create a node for each vertex in it */
+	/* count the triangles of every vertex, the prefix sum gives where
+	the triangles of a vertex start in the member array */
+	std::vector<GLuint> first(model->numvertices + 2, 0);
 	for (i = 0; i < model->numtriangles; i++) {
-		node = (GLMnode*)malloc(sizeof(GLMnode));
-		node->index = i;
-		node->next  = members[T(i).vindices[0]];
-		members[T(i).vindices[0]] = node;
-
-		node = (GLMnode*)malloc(sizeof(GLMnode));
-		node->index = i;
-		node->next  = members[T(i).vindices[1]];
-		members[T(i).vindices[1]] = node;
-
-		node = (GLMnode*)malloc(sizeof(GLMnode));
-		node->index = i;
-		node->next  = members[T(i).vindices[2]];
-		members[T(i).vindices[2]] = node;
+		first[T(i).vindices[0] + 1]++;
+		first[T(i).vindices[1] + 1]++;
+		first[T(i).vindices[2] + 1]++;
+	}
+	for (v = 1; v <= model->numvertices + 1; v++)
+		first[v] += first[v - 1];
+
+	/* fill in the triangles, last triangle first, in the order the
+	linked lists used to hold them */
+	std::vector<GLuint> members(3 * model->numtriangles);
+	std::vector<GLuint> cursor(first.begin(), first.end() - 1);
+	for (i = model->numtriangles; i-- > 0;) {
+		members[cursor[T(i).vindices[0]]++] = i;
+		members[cursor[T(i).vindices[1]]++] = i;
+		members[cursor[T(i).vindices[2]]++] = i;
 	}
 
-	/* calculate the average normal for each vertex */
-	numnormals = 1;
-	for (i = 1; i <= model->numvertices; i++) {
-		/* calculate an average normal for this vertex by averaging the
-		facet normal of every triangle this vertex is in */
-		node = members[i];
-		if (!node)
-			fprintf(stderr, "glmVertexNormals(): vertex w/o a triangle\n");
-		average[0] = 0.0; average[1] = 0.0; average[2] = 0.0;
-		avg = 0;
-		while (node) {
+	/* calculate the average normal for each vertex and count the
+	normals it adds: one for the average and one for every triangle
+	that was not averaged */
+	std::vector<GLboolean> averaged(3 * model->numtriangles);
+	std::vector<GLfloat>   averages(3 * (model->numvertices + 1));
+	std::vector<GLuint>    counts(model->numvertices + 2, 0);
+	glmParallelFor(1, model->numvertices + 1, [&](GLuint begin, GLuint end) {
+		for (GLuint v = begin; v < end; v++) {
+			GLfloat* average = &averages[3 * v];
+			GLfloat* reference;
+			GLuint   j, avg = 0, count = 0;
+
+			average[0] = 0.0; average[1] = 0.0; average[2] = 0.0;
+			if (first[v] == first[v + 1])
+				continue;
+
 			/* only average if the dot product of the angle between the two
 			facet normals is greater than the cosine of the threshold
 			angle -- or, said another way, the angle between the two
 			facet normals is less than (or equal to) the threshold angle */
-			dot = glmDot(&model->facetnorms[3 * T(node->index).findex],
-				&model->facetnorms[3 * T(members[i]->index).findex]);
-			if (dot > cos_angle) {
-				node->averaged = GL_TRUE;
-				average[0] += model->facetnorms[3 * T(node->index).findex + 0];
-				average[1] += model->facetnorms[3 * T(node->index).findex + 1];
-				average[2] += model->facetnorms[3 * T(node->index).findex + 2];
-				avg = 1;			/* we averaged at least one normal! */
-			} else {
-				node->averaged = GL_FALSE;
+			reference = &model->facetnorms[3 * T(members[first[v]]).findex];
+			for (j = first[v]; j < first[v + 1]; j++) {
+				GLfloat* facetnorm = &model->facetnorms[3 * T(members[j]).findex];
+				if (glmDot(facetnorm, reference) > cos_angle) {
+					averaged[j] = GL_TRUE;
+					average[0] += facetnorm[0];
+					average[1] += facetnorm[1];
+					average[2] += facetnorm[2];
+					avg = 1;			/* we averaged at least one normal! */
+				} else {
+					averaged[j] = GL_FALSE;
+					count++;
+				}
 			}
-			node = node->next;
-		}
 
-		if (avg) {
-			/* normalize the averaged normal */
-			glmNormalize(average);
-
-			/* add the normal to the vertex normals list */
-			model->normals[3 * numnormals + 0] = average[0];
-			model->normals[3 * numnormals + 1] = average[1];
-			model->normals[3 * numnormals + 2] = average[2];
-			avg = numnormals;
-			numnormals++;
-		}
-
-		/* set the normal of this vertex in each triangle it is in */
-		node = members[i];
-		while (node) {
-			if (node->averaged) {
-				/* if this node was averaged, use the average normal */
-				if (T(node->index).vindices[0] == i)
-					T(node->index).nindices[0] = avg;
-				else if (T(node->index).vindices[1] == i)
-					T(node->index).nindices[1] = avg;
-				else if (T(node->index).vindices[2] == i)
-					T(node->index).nindices[2] = avg;
-			} else {
-				/* if this node wasn't averaged, use the facet normal */
-				model->normals[3 * numnormals + 0] = 
-					model->facetnorms[3 * T(node->index).findex + 0];
-				model->normals[3 * numnormals + 1] = 
-					model->facetnorms[3 * T(node->index).findex + 1];
-				model->normals[3 * numnormals + 2] = 
-					model->facetnorms[3 * T(node->index).findex + 2];
-				if (T(node->index).vindices[0] == i)
-					T(node->index).nindices[0] = numnormals;
-				else if (T(node->index).vindices[1] == i)
-					T(node->index).nindices[1] = numnormals;
-				else if (T(node->index).vindices[2] == i)
-					T(node->index).nindices[2] = numnormals;
-				numnormals++;
+			if (avg) {
+				/* normalize the averaged normal */
+				glmNormalize(average);
+				count++;
 			}
-			node = node->next;
+			counts[v + 1] = count;
 		}
-	}
-
-	model->numnormals = numnormals - 1;
+	});
 
-	/* free the member information */
-	for (i = 1; i <= model->numvertices; i++) {
-		node = members[i];
-		while (node) {
-			tail = node;
-			node = node->next;
-			free(tail);
-		}
+	orphans = 0;
+	for (v = 1; v <= model->numvertices; v++) {
+		if (first[v] == first[v + 1])
+			orphans++;
+		counts[v + 1] += counts[v];
 	}
-	free(members);
+	if (orphans)
+		fprintf(stderr, "glmVertexNormals(): %u vertices w/o a triangle\n", orphans);
 
-	/* pack the normals array (we previously allocated the maximum
-	number of normals that could possibly be created (numtriangles *
-	3), so get rid of some of them (usually alot unless none of the
-	facet normals were averaged)) */
-	normals = model->normals;
+	/* normals start at index 1 */
+	numnormals = counts[model->numvertices + 1];
+	model->numnormals = numnormals;
 	model->normals = (GLfloat*)malloc(sizeof(GLfloat)* 3* (model->numnormals+1));
-	for (i = 1; i <= model->numnormals; i++) {
-		model->normals[3 * i + 0] = normals[3 * i + 0];
-		model->normals[3 * i + 1] = normals[3 * i + 1];
-		model->normals[3 * i + 2] = normals[3 * i + 2];
-	}
-	free(normals);
+
+	/* store the normals and set the normal of every vertex in each
+	triangle it is in.  A triangle corner belongs to exactly one
+	vertex, so the vertices can be written in parallel */
+	glmParallelFor(1, model->numvertices + 1, [&](GLuint begin, GLuint end) {
+		for (GLuint v = begin; v < end; v++) {
+			GLuint next = counts[v] + 1;
+			GLuint avg = 0;
+			GLuint j, index;
+
+			for (j = first[v]; j < first[v + 1]; j++) {
+				if (averaged[j]) {
+					avg = next++;
+					break;
+				}
+			}
+			if (avg) {
+				/* add the normal to the vertex normals list */
+				model->normals[3 * avg + 0] = averages[3 * v + 0];
+				model->normals[3 * avg + 1] = averages[3 * v + 1];
+				model->normals[3 * avg + 2] = averages[3 * v + 2];
+			}
+
+			for (j = first[v]; j < first[v + 1]; j++) {
+				GLMtriangle* triangle = &T(members[j]);
+				if (averaged[j]) {
+					/* if this triangle was averaged, use the average normal */
+					index = avg;
+				} else {
+					/* if this triangle wasn't averaged, use the facet normal */
+					index = next++;
+					model->normals[3 * index + 0] = model->facetnorms[3 * triangle->findex + 0];
+					model->normals[3 * index + 1] = model->facetnorms[3 * triangle->findex + 1];
+					model->normals[3 * index + 2] = model->facetnorms[3 * triangle->findex + 2];
+				}
+				if (triangle->vindices[0] == v)
+					triangle->nindices[0] = index;
+				else if (triangle->vindices[1] == v)
+					triangle->nindices[1] = index;
+				else if (triangle->vindices[2] == v)
+					triangle->nindices[2] = index;
+			}
+		}
+	});
 }
 
 
@@ -1296,6 +1517,33 @@ GLvoid
 	free(model);
 }
 
+/* glmSize: Returns the number of bytes held by the arrays of a model,
+ * without the names and the allocator's overhead.
+ *
+ * model - initialized GLMmodel structure
+ */
+size_t
+	glmSize(GLMmodel* model)
+{
+	GLMgroup* group;
+	size_t size;
+
+	assert(model);
+
+	/* the arrays are indexed from 1 */
+	size = sizeof(GLMmodel);
+	if (model->vertices)   size += 3 * sizeof(GLfloat) * (model->numvertices + 1);
+	if (model->normals)    size += 3 * sizeof(GLfloat) * (model->numnormals + 1);
+	if (model->texcoords)  size += 2 * sizeof(GLfloat) * (model->numtexcoords + 1);
+	if (model->facetnorms) size += 3 * sizeof(GLfloat) * (model->numfacetnorms + 1);
+	if (model->triangles)  size += sizeof(GLMtriangle) * model->numtriangles;
+	if (model->materials)  size += sizeof(GLMmaterial) * model->nummaterials;
+	for (group = model->groups; group; group = group->next)
+		size += sizeof(GLMgroup) + sizeof(GLuint) * group->numtriangles;
+
+	return size;
+}
+
 /* glmReadOBJ: Reads a model description from a Wavefront .OBJ file.
 * Returns a pointer to the created object which should be free'd with
 * glmDelete().
@@ -1305,6 +1553,7 @@ GLvoid
 GLMmodel* 
 	glmReadOBJ(char* filename)
 {
+	VRTraceRecorder::Scope trace("glmReadOBJ");
 	GLMmodel* model;
 	FILE*     file;
 
@@ -1578,11 +1827,26 @@ GLvoid
 */
 GLvoid
 	glmDraw(GLMmodel* model, GLuint mode)
+{
+	glmDrawRange(model, mode, 0, model->numtriangles);
+}
+
+/* glmDrawRange: Renders the triangles [first, first + count) of the
+* model, numbered through the groups in their order.
+*
+* model    - initialized GLMmodel structure
+* mode     - see glmDraw
+* first    - index of the first triangle
+* count    - number of triangles
+*/
+GLvoid
+	glmDrawRange(GLMmodel* model, GLuint mode, GLuint first, GLuint count)
 {
 	static GLuint i;
 	static GLMgroup* group;
 	static GLMtriangle* triangle;
 	static GLMmaterial* material;
+	GLuint start, begin, end;
 
 	assert(model);
 	assert(model->vertices);
@@ -1634,7 +1898,17 @@ GLvoid
 	wouldn't gain too much?  */
 
 	group = model->groups;
-	while (group) {
+	start = 0;
+	while (group && start < first + count) {
+		/* part of the range in this group */
+		begin = first > start ? first - start : 0;
+		end = first + count - start < group->numtriangles ? first + count - start : group->numtriangles;
+		start += group->numtriangles;
+		if (begin >= end) {
+			group = group->next;
+			continue;
+		}
+
 		if (mode & GLM_MATERIAL) {
 			material = &model->materials[group->material];
 			glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT, material->ambient);
@@ -1648,7 +1922,7 @@ GLvoid
 		}
 
 		glBegin(GL_TRIANGLES);
-		for (i = 0; i < group->numtriangles; i++) {
+		for (i = begin; i < end; i++) {
 			triangle = &T(group->triangles[i]);
 
 			if (mode & GLM_FLAT)
@@ -1695,6 +1969,7 @@ GLvoid
 GLuint
 	glmList(GLMmodel* model, GLuint mode)
 {
+	VRTraceRecorder::Scope trace("glmList");
 	GLuint list;
 
 	list = glGenLists(1);
@@ -1716,43 +1991,416 @@ GLuint
 GLvoid
 	glmWeld(GLMmodel* model, GLfloat epsilon)
 {
-	GLfloat* vectors;
-	GLfloat* copies;
+	VRTraceRecorder::Scope trace("glmWeld");
+	std::vector<GLuint> map;
 	GLuint   numvectors;
-	GLuint   i;
 
 	/* vertices */
 	numvectors = model->numvertices;
-	vectors    = model->vertices;
-	copies = glmWeldVectors(vectors, &numvectors, epsilon);
+	GLfloat* copies = glmWeldIndices(model->vertices, &numvectors, epsilon, map);
 
 #if 0
 	printf("glmWeld(): %d redundant vertices.\n", 
-		model->numvertices - numvectors - 1);
+		model->numvertices - numvectors);
 #endif
 
+	glmParallelFor(0, model->numtriangles, [&](GLuint begin, GLuint end) {
+		for (GLuint i = begin; i < end; i++) {
+			T(i).vindices[0] = map[T(i).vindices[0]];
+			T(i).vindices[1] = map[T(i).vindices[1]];
+			T(i).vindices[2] = map[T(i).vindices[2]];
+		}
+	});
+
+	/* replace the old vertices by the kept ones */
+	free(model->vertices);
+	model->numvertices = numvectors;
+	model->vertices = (GLfloat*)realloc(copies, sizeof(GLfloat) * 
+		3 * (model->numvertices + 1));
+}
+
+/* glmQuadric: error quadric of a vertex, the sum of the squared
+* distances to a set of planes as the symmetric 4x4 matrix
+* (a2 ab ac ad, b2 bc bd, c2 cd, d2).
+*/
+typedef struct _GLMquadric {
+	double q[10];
+} GLMquadric;
+
+/* glmQuadricAdd: adds the plane n.x + d = 0 with a weight to q */
+static GLvoid
+	glmQuadricAdd(GLMquadric* q, const double* n, double d, double weight)
+{
+	q->q[0] += weight * n[0] * n[0];
+	q->q[1] += weight * n[0] * n[1];
+	q->q[2] += weight * n[0] * n[2];
+	q->q[3] += weight * n[0] * d;
+	q->q[4] += weight * n[1] * n[1];
+	q->q[5] += weight * n[1] * n[2];
+	q->q[6] += weight * n[1] * d;
+	q->q[7] += weight * n[2] * n[2];
+	q->q[8] += weight * n[2] * d;
+	q->q[9] += weight * d * d;
+}
+
+/* glmQuadricError: returns the error of the position p under q */
+static double
+	glmQuadricError(const GLMquadric* q, const double* p)
+{
+	const double* m = q->q;
+	return m[0] * p[0] * p[0] + 2 * m[1] * p[0] * p[1] + 2 * m[2] * p[0] * p[2] + 2 * m[3] * p[0]
+		+ m[4] * p[1] * p[1] + 2 * m[5] * p[1] * p[2] + 2 * m[6] * p[1]
+		+ m[7] * p[2] * p[2] + 2 * m[8] * p[2] + m[9];
+}
+
+/* GLMcollapse: a candidate edge collapse of a simplification, valid
+* as long as the stamps of its vertices have not changed.
+*/
+typedef struct _GLMcollapse {
+	double cost;
+	double position[3];
+	GLuint a, b;
+	GLuint stampa, stampb;
+
+	bool operator<(const struct _GLMcollapse& other) const
+	{
+		/* std::priority_queue pops the largest, the cheapest is wanted */
+		return cost > other.cost;
+	}
+} GLMcollapse;
+
+/* glmSimplifyTriangleNormal: unnormalized normal of the triangle
+* (p0, p1, p2).
+*/
+static GLvoid
+	glmSimplifyTriangleNormal(const double* p0, const double* p1, const double* p2, double* n)
+{
+	double u[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+	double v[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+	n[0] = u[1] * v[2] - u[2] * v[1];
+	n[1] = u[2] * v[0] - u[0] * v[2];
+	n[2] = u[0] * v[1] - u[1] * v[0];
+}
+
+/* glmSimplify: creates a simplified copy of a model with about
+* numtriangles triangles.  Vertices at the same position are merged
+* first, then edges are collapsed in the order of the quadric error of
+* the merged vertex (Garland and Heckbert 1997).  Boundary edges are
+* held in place by planes perpendicular to their triangle, collapses
+* that would flip a triangle or pinch the surface are skipped.
+*
+* The copy has a single group and only vertices, normals have to be
+* generated for it.  Returns a new model which should be free'd with
+* glmDelete().
+*
+* model        - initialized GLMmodel structure
+* numtriangles - number of triangles to reduce to
+*/
+GLMmodel*
+	glmSimplify(GLMmodel* model, GLuint numtriangles)
+{
+	VRTraceRecorder::Scope trace("glmSimplify");
+	std::vector<GLuint> map;
+	GLuint   numvertices;
+	GLuint   i, j, k;
+
+	assert(model);
+	assert(model->vertices);
+
+	/* merge vertices at the same position, e.g. at texture seams */
+	GLfloat min[3], max[3];
+	glmBounds(model, min, max);
+	GLfloat diagonal = (GLfloat)sqrt((max[0] - min[0]) * (max[0] - min[0]) +
+		(max[1] - min[1]) * (max[1] - min[1]) + (max[2] - min[2]) * (max[2] - min[2]));
+	numvertices = model->numvertices;
+	GLfloat* welded = glmWeldIndices(model->vertices, &numvertices, diagonal * 1e-6f, map);
+
+	std::vector<double> positions(3 * (numvertices + 1));
+	for (i = 3; i < 3 * (numvertices + 1); i++)
+		positions[i] = welded[i];
+	free(welded);
+
+	std::vector<GLuint> triangles(3 * model->numtriangles);
+	std::vector<bool> removed(model->numtriangles, false);
 	for (i = 0; i < model->numtriangles; i++) {
-		T(i).vindices[0] = (GLuint)vectors[3 * T(i).vindices[0] + 0];
-		T(i).vindices[1] = (GLuint)vectors[3 * T(i).vindices[1] + 0];
-		T(i).vindices[2] = (GLuint)vectors[3 * T(i).vindices[2] + 0];
+		for (j = 0; j < 3; j++)
+			triangles[3 * i + j] = map[T(i).vindices[j]];
+		if (triangles[3 * i] == triangles[3 * i + 1] || triangles[3 * i + 1] == triangles[3 * i + 2] ||
+			triangles[3 * i + 2] == triangles[3 * i])
+			removed[i] = true;
 	}
 
-	/* free space for old vertices */
-	free(vectors);
+	/* triangles around every vertex and plane quadrics weighted by area */
+	std::vector<std::vector<GLuint> > around(numvertices + 1);
+	std::vector<GLMquadric> quadrics(numvertices + 1);
+	memset(&quadrics[0], 0, sizeof(GLMquadric) * quadrics.size());
+	GLuint live = 0;
+	for (i = 0; i < model->numtriangles; i++) {
+		if (removed[i])
+			continue;
+		const GLuint* t = &triangles[3 * i];
+		double n[3];
+		glmSimplifyTriangleNormal(&positions[3 * t[0]], &positions[3 * t[1]], &positions[3 * t[2]], n);
+		double area = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+		if (area > 0) {
+			n[0] /= area; n[1] /= area; n[2] /= area;
+		}
+		double d = -(n[0] * positions[3 * t[0] + 0] + n[1] * positions[3 * t[0] + 1] + n[2] * positions[3 * t[0] + 2]);
+		for (j = 0; j < 3; j++) {
+			glmQuadricAdd(&quadrics[t[j]], n, d, area * 0.5);
+			around[t[j]].push_back(i);
+		}
+		live++;
+	}
 
-	/* allocate space for the new vertices */
-	model->numvertices = numvectors;
-	model->vertices = (GLfloat*)malloc(sizeof(GLfloat) * 
-		3 * (model->numvertices + 1));
+	/* the edges, sorted so that edges used by only one triangle
+	   are found as unpaired entries */
+	std::vector<std::pair<GLuint, GLuint> > edges;
+	std::vector<GLuint> edgetriangles;
+	edges.reserve(3 * live);
+	for (i = 0; i < model->numtriangles; i++) {
+		if (removed[i])
+			continue;
+		for (j = 0; j < 3; j++) {
+			GLuint a = triangles[3 * i + j], b = triangles[3 * i + (j + 1) % 3];
+			edges.push_back(a < b ? std::make_pair(a, b) : std::make_pair(b, a));
+			edgetriangles.push_back(i);
+		}
+	}
+	std::vector<GLuint> order(edges.size());
+	for (i = 0; i < order.size(); i++)
+		order[i] = i;
+	std::sort(order.begin(), order.end(), [&](GLuint x, GLuint y) { return edges[x] < edges[y]; });
+
+	/* boundary planes, weighted strongly so that open borders keep
+	   their shape */
+	for (i = 0; i < order.size(); i = j) {
+		for (j = i + 1; j < order.size() && edges[order[j]] == edges[order[i]]; j++);
+		if (j - i != 1)
+			continue;
+		const GLuint* t = &triangles[3 * edgetriangles[order[i]]];
+		GLuint a = edges[order[i]].first, b = edges[order[i]].second;
+		double n[3], e[3], p[3];
+		glmSimplifyTriangleNormal(&positions[3 * t[0]], &positions[3 * t[1]], &positions[3 * t[2]], n);
+		for (k = 0; k < 3; k++)
+			e[k] = positions[3 * b + k] - positions[3 * a + k];
+		p[0] = e[1] * n[2] - e[2] * n[1];
+		p[1] = e[2] * n[0] - e[0] * n[2];
+		p[2] = e[0] * n[1] - e[1] * n[0];
+		double length = sqrt(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+		if (length <= 0)
+			continue;
+		p[0] /= length; p[1] /= length; p[2] /= length;
+		double d = -(p[0] * positions[3 * a + 0] + p[1] * positions[3 * a + 1] + p[2] * positions[3 * a + 2]);
+		double weight = 10.0 * (e[0] * e[0] + e[1] * e[1] + e[2] * e[2]);
+		glmQuadricAdd(&quadrics[a], p, d, weight);
+		glmQuadricAdd(&quadrics[b], p, d, weight);
+	}
 
-	/* copy the optimized vertices into the actual vertex list */
-	for (i = 1; i <= model->numvertices; i++) {
-		model->vertices[3 * i + 0] = copies[3 * i + 0];
-		model->vertices[3 * i + 1] = copies[3 * i + 1];
-		model->vertices[3 * i + 2] = copies[3 * i + 2];
+	std::vector<GLuint> stamps(numvertices + 1, 0);
+	std::vector<bool> merged(numvertices + 1, false);
+	std::priority_queue<GLMcollapse> heap;
+
+	/* the position of a merged vertex minimizes the summed quadric,
+	   unless that is ill-conditioned or far off the edge, then the
+	   best of the end points and the midpoint is taken */
+	auto candidate = [&](GLuint a, GLuint b) {
+		GLMcollapse c;
+		GLMquadric q;
+		GLuint k;
+		const double* pa = &positions[3 * a];
+		const double* pb = &positions[3 * b];
+		for (k = 0; k < 10; k++)
+			q.q[k] = quadrics[a].q[k] + quadrics[b].q[k];
+		c.a = a;
+		c.b = b;
+		c.stampa = stamps[a];
+		c.stampb = stamps[b];
+		c.cost = -1;
+
+		const double* m = q.q;
+		double det = m[0] * (m[4] * m[7] - m[5] * m[5]) - m[1] * (m[1] * m[7] - m[5] * m[2]) + m[2] * (m[1] * m[5] - m[4] * m[2]);
+		double trace = m[0] + m[4] + m[7];
+		if (fabs(det) > 1e-9 * trace * trace * trace) {
+			double x[3];
+			x[0] = (-m[3] * (m[4] * m[7] - m[5] * m[5]) + m[6] * (m[1] * m[7] - m[5] * m[2]) - m[8] * (m[1] * m[5] - m[4] * m[2])) / det;
+			x[1] = (m[0] * (-m[6] * m[7] + m[8] * m[5]) - m[1] * (-m[3] * m[7] + m[8] * m[2]) + m[2] * (-m[3] * m[5] + m[6] * m[2])) / det;
+			x[2] = (m[0] * (-m[4] * m[8] + m[5] * m[6]) - m[1] * (-m[1] * m[8] + m[5] * m[3]) + m[2] * (-m[1] * m[6] + m[4] * m[3])) / det;
+			double e2 = 0, o2 = 0;
+			for (k = 0; k < 3; k++) {
+				e2 += (pb[k] - pa[k]) * (pb[k] - pa[k]);
+				o2 += (x[k] - 0.5 * (pa[k] + pb[k])) * (x[k] - 0.5 * (pa[k] + pb[k]));
+			}
+			if (o2 <= e2) {
+				c.cost = glmQuadricError(&q, x);
+				for (k = 0; k < 3; k++)
+					c.position[k] = x[k];
+			}
+		}
+		if (c.cost < 0) {
+			double mid[3] = { 0.5 * (pa[0] + pb[0]), 0.5 * (pa[1] + pb[1]), 0.5 * (pa[2] + pb[2]) };
+			const double* options[3] = { pa, pb, mid };
+			for (GLuint o = 0; o < 3; o++) {
+				double cost = glmQuadricError(&q, options[o]);
+				if (c.cost < 0 || cost < c.cost) {
+					c.cost = cost;
+					for (k = 0; k < 3; k++)
+						c.position[k] = options[o][k];
+				}
+			}
+		}
+		if (c.cost < 0)
+			c.cost = 0;
+		heap.push(c);
+	};
+
+	for (i = 0; i < order.size(); i = j) {
+		for (j = i + 1; j < order.size() && edges[order[j]] == edges[order[i]]; j++);
+		candidate(edges[order[i]].first, edges[order[i]].second);
+	}
+	std::vector<std::pair<GLuint, GLuint> >().swap(edges);
+	std::vector<GLuint>().swap(edgetriangles);
+	std::vector<GLuint>().swap(order);
+
+	std::vector<GLuint> neighboursa, neighboursb;
+	auto neighbours = [&](GLuint v, std::vector<GLuint>& out) {
+		out.clear();
+		for (GLuint t : around[v]) {
+			for (GLuint k = 0; k < 3; k++) {
+				if (triangles[3 * t + k] != v)
+					out.push_back(triangles[3 * t + k]);
+			}
+		}
+		std::sort(out.begin(), out.end());
+		out.erase(std::unique(out.begin(), out.end()), out.end());
+	};
+
+	while (live > numtriangles && !heap.empty()) {
+		GLMcollapse c = heap.top();
+		heap.pop();
+		if (merged[c.a] || merged[c.b] || c.stampa != stamps[c.a] || c.stampb != stamps[c.b])
+			continue;
+
+		/* the edge must still exist and the vertices may share no
+		   neighbours besides the third vertices of its triangles */
+		GLuint shared = 0;
+		for (GLuint t : around[c.a]) {
+			if (triangles[3 * t] == c.b || triangles[3 * t + 1] == c.b || triangles[3 * t + 2] == c.b)
+				shared++;
+		}
+		if (shared == 0)
+			continue;
+		neighbours(c.a, neighboursa);
+		neighbours(c.b, neighboursb);
+		GLuint common = 0;
+		for (GLuint x = 0, y = 0; x < neighboursa.size() && y < neighboursb.size();) {
+			if (neighboursa[x] < neighboursb[y]) x++;
+			else if (neighboursa[x] > neighboursb[y]) y++;
+			else { common++; x++; y++; }
+		}
+		if (common != shared)
+			continue;
+
+		/* no remaining triangle may flip */
+		bool flips = false;
+		for (GLuint side = 0; side < 2 && !flips; side++) {
+			GLuint v = side ? c.b : c.a, other = side ? c.a : c.b;
+			for (GLuint t : around[v]) {
+				const GLuint* tv = &triangles[3 * t];
+				if (tv[0] == other || tv[1] == other || tv[2] == other)
+					continue;
+				const double* p[3];
+				double before[3], after[3];
+				for (k = 0; k < 3; k++)
+					p[k] = &positions[3 * tv[k]];
+				glmSimplifyTriangleNormal(p[0], p[1], p[2], before);
+				for (k = 0; k < 3; k++) {
+					if (tv[k] == v)
+						p[k] = c.position;
+				}
+				glmSimplifyTriangleNormal(p[0], p[1], p[2], after);
+				if (before[0] * after[0] + before[1] * after[1] + before[2] * after[2] <= 0) {
+					flips = true;
+					break;
+				}
+			}
+		}
+		if (flips)
+			continue;
+
+		/* merge b into a */
+		for (GLuint t : around[c.b]) {
+			GLuint* tv = &triangles[3 * t];
+			if (tv[0] == c.a || tv[1] == c.a || tv[2] == c.a) {
+				removed[t] = true;
+				live--;
+			}
+			else {
+				for (k = 0; k < 3; k++) {
+					if (tv[k] == c.b)
+						tv[k] = c.a;
+				}
+				around[c.a].push_back(t);
+			}
+		}
+		std::vector<GLuint>& aroundb = around[c.b];
+		std::vector<GLuint>().swap(aroundb);
+		std::vector<GLuint>& arounda = around[c.a];
+		arounda.erase(std::remove_if(arounda.begin(), arounda.end(), [&](GLuint t) { return (bool)removed[t]; }), arounda.end());
+		for (GLuint v : neighboursb) {
+			std::vector<GLuint>& aroundv = around[v];
+			aroundv.erase(std::remove_if(aroundv.begin(), aroundv.end(), [&](GLuint t) { return (bool)removed[t]; }), aroundv.end());
+		}
+
+		for (k = 0; k < 3; k++)
+			positions[3 * c.a + k] = c.position[k];
+		for (k = 0; k < 10; k++)
+			quadrics[c.a].q[k] += quadrics[c.b].q[k];
+		merged[c.b] = true;
+		stamps[c.a]++;
+
+		neighbours(c.a, neighboursa);
+		for (GLuint v : neighboursa)
+			candidate(c.a, v);
 	}
 
-	free(copies);
+	/* copy the remaining vertices and triangles into a new model */
+	GLMmodel* simplified = (GLMmodel*)calloc(1, sizeof(GLMmodel));
+	simplified->pathname = strdup(model->pathname ? model->pathname : "");
+	std::vector<GLuint> index(numvertices + 1, 0);
+	GLuint used = 0;
+	for (i = 0; i < model->numtriangles; i++) {
+		if (removed[i])
+			continue;
+		for (j = 0; j < 3; j++) {
+			if (!index[triangles[3 * i + j]])
+				index[triangles[3 * i + j]] = ++used;
+		}
+	}
+	simplified->numvertices = used;
+	simplified->vertices = (GLfloat*)malloc(sizeof(GLfloat) * 3 * (used + 1));
+	for (i = 1; i <= numvertices; i++) {
+		if (!index[i])
+			continue;
+		for (k = 0; k < 3; k++)
+			simplified->vertices[3 * index[i] + k] = (GLfloat)positions[3 * i + k];
+	}
+
+	simplified->numtriangles = live;
+	simplified->triangles = (GLMtriangle*)calloc(live, sizeof(GLMtriangle));
+	GLMgroup* group = glmAddGroup(simplified, (char*)"default");
+	group->numtriangles = live;
+	group->triangles = (GLuint*)malloc(sizeof(GLuint) * live);
+	for (i = 0, j = 0; i < model->numtriangles; i++) {
+		if (removed[i])
+			continue;
+		for (k = 0; k < 3; k++)
+			simplified->triangles[j].vindices[k] = index[triangles[3 * i + k]];
+		group->triangles[j] = j;
+		j++;
+	}
+
+	return simplified;
 }
 
 
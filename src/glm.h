@@ -195,6 +195,14 @@ glmSpheremapTexture(GLMmodel* model);
 GLvoid
 glmDelete(GLMmodel* model);
 
+/* glmSize: Returns the number of bytes held by the arrays of a model,
+ * without the names and the allocator's overhead.
+ *
+ * model - initialized GLMmodel structure
+ */
+size_t
+glmSize(GLMmodel* model);
+
 /* glmReadOBJ: Reads a model description from a Wavefront .OBJ file.
  * Returns a pointer to the created object which should be free'd with
  * glmDelete().
@@ -233,6 +241,14 @@ glmWriteOBJ(GLMmodel* model, char* filename, GLuint mode);
 GLvoid
 glmDraw(GLMmodel* model, GLuint mode);
 
+/* glmDrawRange: Renders the triangles [first, first + count) of the
+ * model, numbered through the groups in their order, with the modes of
+ * glmDraw.  Large models can be compiled into several display lists
+ * this way.
+ */
+GLvoid
+glmDrawRange(GLMmodel* model, GLuint mode, GLuint first, GLuint count);
+
 /* glmList: Generates and returns a display list for the model using
  * the mode specified.
  *
@@ -257,3 +273,15 @@ glmList(GLMmodel* model, GLuint mode);
  */
 GLvoid
 glmWeld(GLMmodel* model, GLfloat epsilon);
+
+/* glmSimplify: creates a simplified copy of a model with about
+ * numtriangles triangles by quadric error edge collapses.  The copy
+ * has one group and no normals, texture coordinates or materials.
+ * Returns a pointer to the created object which should be free'd
+ * with glmDelete().
+ *
+ * model        - initialized GLMmodel structure
+ * numtriangles - number of triangles to reduce to
+ */
+GLMmodel*
+glmSimplify(GLMmodel* model, GLuint numtriangles);
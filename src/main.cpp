@@ -3,18 +3,24 @@
 #if defined(WIN32)
 #define NOMINMAX
 #include <windows.h>
+#include <GL/glew.h>
 #include <GL/gl.h>
 #include <gl/GLU.h>
 #elif defined(__APPLE__)
+#include <GL/glew.h>
 #include <OpenGL/OpenGL.h>
 #include <OpenGL/glu.h>
 #else
 #define GL_GLEXT_PROTOTYPES
+#include <GL/glew.h>
 #include <GL/gl.h>
 #include <GL/glu.h>
 #endif
 
 #include <math.h>
+#include <chrono>
+#include <algorithm>
+#include <map>
 // MinVR header
 #include <api/MinVR.h>
 #include "main/VREventInternal.h"
@@ -27,8 +33,21 @@
 #include "VRTextBox.h"
 #include "VRToggle.h"
 #include "VRGraph.h"
+#include "VREventDispatcher.h"
+#include "XMAInputEvent.h"
+#include "XMAInputLog.h"
+#include "VRProfiler.h"
+#include "VRMemoryTracker.h"
+#include "VRTraceRecorder.h"
 
 #include "XMAObject.h"
+#include "XMATransformTrack.h"
+#include "XMALoader.h"
+#include "XMAInterpenetration.h"
+#include "XMAFilter.h"
+#include "XMAFilterTask.h"
+#include "XMARenderer.h"
+#include "XMAAnalysis.h"
 #include "glm.h"
 
 using namespace MinVR;
@@ -43,45 +62,25 @@ using namespace MinVR;
 #define slash "/"
 #endif
 
-struct particle
-{
-	VRPoint3 position;
-	int object;
-	std::vector<VRPoint3> positions;
-	std::vector<bool> visible;
-	int color;
-	
-};
-
 int current_color = 0;
-float color_array[20][3] = { 
-	{ 0, 1, 0 },
-	{ 0, 0, 1 }, 
-	{ 1, 1, 0 }, 
-	{ 1, 0, 1 }, 
-	{ 0, 1, 1 }, 
-	{0.5, 1, 0},
-	{0, 1, 0.5 },
-	{ 0.5, 0, 1 },
-	{ 0, 0.5, 1 },
-	{ 1, 1, 0.5 },
-	{ 1, 0.5, 1 },
-	{ 0.5, 1, 1 },
-	{ 0, 0.5, 0 },
-	{ 0, 0, 0.5 },
-	{ 0.5, 1, 0 },
-	{ 1, 0.5, 0 },
-	{ 0.5, 0, 1 },
-	{ 1, 0, 0.5 },
-	{ 0, 0.5, 1 },
-	{ 0, 1, 0.5 },
-};
 
 // deg2rad * degrees = radians
 #define deg2rad (3.14159265/180.0)
 // rad2deg * radians = degrees
 #define rad2deg (180.0/3.14159265)
 
+//frames between updates of the profiler page
+#define PROFILER_HUD_INTERVAL 30
+//length of a trace started from the profiler page
+#define TRACE_SECONDS 5.0
+//time per frame for compiling display lists of loaded bones
+#define UPLOAD_BUDGET_MS 4.0
+//bones listed on the memory page, the ones holding the most memory
+#define MEMORY_PAGE_BONES 8
+//initial cutoff and sample rate of the low-pass filter in Hz
+#define FILTER_CUTOFF 15.0
+#define FILTER_SAMPLE_RATE 250.0
+
 bool StartsWith(const std::string& text, const std::string& token)
 {
 	if (text.length() < token.length())
@@ -92,7 +91,7 @@ bool StartsWith(const std::string& text, const std::string& token)
 class MyVRApp : public VRApp, VRMenuHandler
 {
 public:
-	MyVRApp(int argc, char** argv, const std::string& configFile) : VRApp(argc, argv), menuVisible(false), clicked(false), movement_x(0.0), movement_y(0.0), rotateObj(false), current_obj(-1), tool_dist(-0.8), hover_particle(-1), selected_particle(-1), particle_trail(-1), currentMenu(0), objscale(1.0)
+	MyVRApp(int argc, char** argv, const std::string& configFile) : VRApp(argc, argv), current_obj(-1), hover_particle(-1), selected_particle(-1), objscale(1.0), weldEpsilon(0.0), loader(NULL), loadingMenu(NULL), clicked(false), tool_dist(-0.8), rotateObj(false), focal_length(1.0f), movement_x(0.0), movement_y(0.0), menuVisible(false), menusDirty(false), currentMenu(0), particle_trail(-1), eventDispatcher(this), replayDispatcher(this), inputFrame(0), profiler_refresh(0), memory_refresh(0), particleBytes(0), collisionCheck(NULL), collision_refresh(0), collision_event(-1), filter(NULL), filterTask(NULL), filter_refresh(0), filter_cutoff(FILTER_CUTOFF), filter_sample_rate(FILTER_SAMPLE_RATE)
 	{
 		std::cerr << "start" << std::endl;
 		initXROMM(argv[3]);
@@ -102,6 +101,12 @@ public:
 			objscale = std::atof(argv[4]);
 		}
 
+		//vertices of the bone meshes closer than this are merged, 0 keeps the meshes as they are
+		if (argc >= 6)
+		{
+			weldEpsilon = std::atof(argv[5]);
+		}
+
 		light_pos[0] = 0.0;
 		light_pos[1] = 4.0;
 		light_pos[2] = 0.0;
@@ -113,12 +118,36 @@ public:
 		points[3] = -1;
 
 		rotateObj = 0;
+
+		registerEventHandlers(eventDispatcher);
+		registerEventHandlers(replayDispatcher);
+		registerProfilerPhases();
+		registerMemoryCategories();
+
+		//XROMM_TRACE=<seconds> records a trace from startup, e.g. to capture loading
+		VRTraceRecorder::getInstance()->setThreadName("Main");
+		const char * traceSeconds = std::getenv("XROMM_TRACE");
+		if (traceSeconds)
+			VRTraceRecorder::getInstance()->start(std::atof(traceSeconds), filename + "trace.json");
+
+		//XROMM_RECORD=<file> records the input of the session, XROMM_REPLAY=<file> plays it back
+		//instead of the devices and writes a profile of the run when it is over
+		const char * recordFile = std::getenv("XROMM_RECORD");
+		const char * replayFile = std::getenv("XROMM_REPLAY");
+		if (replayFile && inputLog.loadReplay(replayFile))
+			VRProfiler::getInstance()->setEnabled(true);
+		else if (recordFile)
+			inputLog.startRecording(recordFile);
 	}
 
 	virtual ~MyVRApp()
 	{
 		std::cerr << "Delete" << std::endl;
-		glDeleteLists(sphere, 1);
+		dumpMemory();
+		delete collisionCheck;
+		delete filterTask;
+		delete filter;
+		delete loader;
 	}
 
 	void initXROMM(const string& mySetup){
@@ -130,466 +159,702 @@ public:
 		filename = mySetup + slash;
 	}
 
-	void loadData(std::string directory, float scale) {
-		initialised = true;
-		FILE *file;
-		std::string filename = directory;
-		file = std::fopen(filename.append("Data.csv").c_str(), "r"); // open a file
+	//starts loading the bones on background threads, the frames until they are loaded show
+	//the bones loaded so far and a progress panel in front of the head
+	void startLoading(std::string directory, float scale) {
+		renderer.loadSphere("sphere.obj");
+
+		loadStart = std::chrono::steady_clock::now();
+		loader = new XMALoader(directory, scale, weldEpsilon);
+		if (!loader->start())
+			std::cerr << "No bones to load in " << directory << std::endl;
+
+		loadingMenu = new VRMenu(1.0, 0.5, 1, 4, "Loading " + directory);
+		textbox_loading = new VRMultiLineTextBox("textbox_loading", std::vector<std::string>(1, "Reading the manifest"), VRFontHandler::LEFT);
+		loadingMenu->addElement(textbox_loading, 1, 1, 1, 4);
+		loadingMenu->setVisible(true);
+		loadingMenus.push_back(loadingMenu);
+	}
 
-		char buf[256];
+	//takes the bones the loader finished, the application starts once all of them are there
+	void updateLoading()
+	{
+		VRTraceRecorder::Scope trace("updateLoading");
+		//bones keep their index in the manifest, the slots of the others stay empty until they are loaded
+		std::vector<int> loaded = loader->takeLoaded(objects);
+		for (size_t i = 0; i < loaded.size(); i++)
+			objects[loaded[i]]->setPlayhead(0);
+		uploadObjects();
+
+		std::vector<std::string> status;
+		int count = loader->getCount();
+		status.push_back("Bones loaded: " + std::to_string((long long)loader->getLoaded()) + " of " + std::to_string((long long)count));
+		int uploaded = 0;
+		int indexed = 0;
+		for (size_t i = 0; i < objects.size(); i++)
+		{
+			uploaded += (objects[i] && objects[i]->isReady()) ? 1 : 0;
+			indexed += (objects[i] && objects[i]->getTrack()->isIndexed()) ? 1 : 0;
+		}
+		status.push_back("Bones shown: " + std::to_string((long long)uploaded) + " of " + std::to_string((long long)count));
+		status.push_back("Tracks indexed: " + std::to_string((long long)indexed) + " of " + std::to_string((long long)count));
+		std::vector<std::string> loading = loader->getLoading();
+		for (size_t i = 0; i < loading.size(); i++)
+			status.push_back("Loading " + loading[i]);
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - loadStart).count();
+		status.push_back(std::to_string((long long)seconds) + " s");
+		textbox_loading->setText(status);
+
+		VRMatrix4 pose = headpose * VRMatrix4::translation(VRVector3(0, -0.25, -1.2));
+		loadingMenu->setTransformation(pose);
+		loadingMenu->updateTexture();
+
+		//the length of the trial is known once every track is indexed
+		if (loader->isFinished() && indexed == count)
+			finishLoading();
+	}
 
-		while (std::fscanf(file, "%s", buf) != EOF)
+	//compiles display lists of the loaded bones for at most UPLOAD_BUDGET_MS per frame, the
+	//coarsest level of every bone is compiled before the finer ones so all bones appear early
+	void uploadObjects()
+	{
+		typedef std::chrono::steady_clock Clock;
+		Clock::time_point start = Clock::now();
+		for (int pass = 0; pass < 2; pass++)
 		{
-			// read an entire line into memory
-			char *obj_file = std::strtok(buf, ",");
-			char * trans_file = std::strtok(NULL, "\n");
-			std::string obj_filename = directory;
-			std::string trans_filename = directory;
-			XMAObject * obj = new XMAObject(obj_filename.append(obj_file), trans_filename.append(trans_file),objscale);
-			objects.push_back(obj);
+			for (size_t i = 0; i < objects.size(); i++)
+			{
+				if (!objects[i] || objects[i]->isUploaded() || (pass == 0 && objects[i]->isReady()))
+					continue;
+				while (objects[i]->upload() && (pass == 1 || !objects[i]->isReady()))
+				{
+					if (std::chrono::duration<double, std::milli>(Clock::now() - start).count() > UPLOAD_BUDGET_MS)
+						return;
+				}
+				if (std::chrono::duration<double, std::milli>(Clock::now() - start).count() > UPLOAD_BUDGET_MS)
+					return;
+			}
 		}
+	}
 
-		std::fclose(file);
-
-		GLMmodel* pmodel = glmReadOBJ("sphere.obj");
-
-		glmUnitize(pmodel);
-		glmScale(pmodel, 0.1);
-		glmFacetNormals(pmodel);
-		glmVertexNormals(pmodel, 90.0);
-		sphere = glmList(pmodel, GLM_SMOOTH);
-		glmDelete(pmodel);
-
-		max_Frame = 1000000000;
+	void finishLoading() {
+		max_Frame = objects.empty() ? 1 : 1000000000;
 
 		for (std::vector<XMAObject*>::const_iterator it = objects.begin(); it != objects.end(); ++it)
 		{
 			max_Frame = (max_Frame > (*it)->getTransformationSize()) ? (*it)->getTransformationSize() : max_Frame;
 		}
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - loadStart).count();
+		std::cerr << "Loaded " << objects.size() << " bones in " << seconds << " s" << std::endl;
+
+		delete loader;
+		loader = NULL;
+		loadingMenus.clear();
+		delete loadingMenu;
+		loadingMenu = NULL;
 
 		createMenu();
+		initialised = true;
 	}
 
 	void updateParticles()
 	{
-		for (int j = 0; j < particles.size(); j++)
+		VRTraceRecorder::Scope trace("updateParticles");
+		//the particles of a bone are computed together, so its track is read once for all of them
+		std::map<int, std::vector<int> > byObject;
+		for (size_t j = 0; j < particles.size(); j++)
 		{
-			particles[j].positions.clear();
-			particles[j].visible.clear();
-			for (int i = 0; i < max_Frame; i++)
+			particles[j].positions.resize(3 * max_Frame);
+			particles[j].visible.resize(max_Frame);
+			byObject[particles[j].object].push_back(j);
+		}
+
+		XMATransformTrack * fixedTrack = toggle_fix_current_Object->isToggled() ? objects[fixed_obj]->getTrack() : NULL;
+		for (std::map<int, std::vector<int> >::const_iterator it = byObject.begin(); it != byObject.end(); ++it)
+		{
+			std::vector<float> points;
+			std::vector<float *> positions;
+			std::vector<unsigned char *> visible;
+			for (size_t k = 0; k < it->second.size(); k++)
 			{
-				particles[j].visible.push_back(true);
-				VRPoint3 p_frame = particles[j].position;
-				if (particles[j].object != -1){
-					if (!objects[particles[j].object]->isVisible(i))
-						particles[j].visible[i] = false;
-					p_frame = objects[particles[j].object]->getTransformation(i) * p_frame;
-				}
-				else
-				{
-					
-				}
-				if (toggle_fix_current_Object->isToggled())
-				{
-					if (!objects[fixed_obj]->isVisible(i))
-						particles[j].visible[i] = false;
-					p_frame = object_fixpose * objects[fixed_obj]->getTransformation(i).inverse() * p_frame;
-				}
-				particles[j].positions.push_back(p_frame);
+				XMAParticle &p = particles[it->second[k]];
+				points.push_back(p.position.x);
+				points.push_back(p.position.y);
+				points.push_back(p.position.z);
+				positions.push_back(&p.positions[0]);
+				visible.push_back(&p.visible[0]);
 			}
-		}
+			XMATransformTrack * track = (it->first != -1) ? objects[it->first]->getTrack() : NULL;
+			XMAAnalysis::computeTrajectories(&points[0], it->second.size(), track, fixedTrack, object_fixpose.getArray(), max_Frame,
+				&positions[0], &visible[0]);
+		}
+		for (size_t j = 0; j < particles.size(); j++)
+			particles[j].updateTrailBounds();
+		filterTrajectories();
+		countParticleMemory();
 	}
 
-	void setDistanceData()
+	//filters the trajectories of all particles together
+	void filterTrajectories()
 	{
-		std::vector <double> data;		
-		for (int i = 0; i < max_Frame; i++)
-		if (particles[points[0]].visible[i] && particles[points[1]].visible[i]){
-			data.push_back((particles[points[0]].positions[i] - particles[points[1]].positions[i]).length());
+		if (!filter || particles.empty())
+			return;
+
+		std::vector<float *> positions;
+		std::vector<const unsigned char *> visible;
+		for (size_t j = 0; j < particles.size(); j++)
+		{
+			positions.push_back(&particles[j].positions[0]);
+			visible.push_back(&particles[j].visible[0]);
 		}
-		else
+		filter->filterTrajectories(&positions[0], &visible[0], particles.size(), max_Frame);
+		for (size_t j = 0; j < particles.size(); j++)
+			particles[j].updateTrailBounds();
+	}
+
+	//trajectories of the particles, counted whenever particles are added, removed or recomputed
+	void countParticleMemory()
+	{
+		long long bytes = 0;
+		for (size_t j = 0; j < particles.size(); j++)
+			bytes += particles[j].positions.capacity() * sizeof(float) + particles[j].visible.capacity();
+		VRMemoryTracker::getInstance()->allocate(memory_particles, bytes - particleBytes);
+		particleBytes = bytes;
+	}
+
+	//positions of the particle in all frames, relative to the fixed object if one is set. They are
+	//computed from the tracks as read and then filtered
+	void computeTrajectory(XMAParticle &p)
+	{
+		p.positions.resize(3 * max_Frame);
+		p.visible.resize(max_Frame);
+		float position[3] = { p.position.x, p.position.y, p.position.z };
+		XMATransformTrack * track = (p.object != -1) ? objects[p.object]->getTrack() : NULL;
+		XMATransformTrack * fixedTrack = toggle_fix_current_Object->isToggled() ? objects[fixed_obj]->getTrack() : NULL;
+		XMAAnalysis::computeTrajectory(position, track, fixedTrack, object_fixpose.getArray(), max_Frame, &p.positions[0], &p.visible[0]);
+		if (filter)
 		{
-			data.push_back(GRAPHSKIPDVALUE);
+			float * positions = &p.positions[0];
+			const unsigned char * visible = &p.visible[0];
+			filter->filterTrajectories(&positions, &visible, 1, max_Frame);
 		}
-		
-		graph_distance->setData(data);
+		p.updateTrailBounds();
+	}
+
+	void setDistanceData()
+	{
+		VRTraceRecorder::Scope trace("setDistanceData");
+		std::vector <double> data;
+		const XMAParticle &a = particles[points[0]];
+		const XMAParticle &b = particles[points[1]];
+		XMAAnalysis::distanceSeries(&a.positions[0], &a.visible[0], &b.positions[0], &b.visible[0], max_Frame, GRAPHSKIPDVALUE, data);
+		graph_distance->setData(std::move(data));
 	}
 
 	void setAngleData()
 	{
+		VRTraceRecorder::Scope trace("setAngleData");
 		if (points[0] == -1 || points[1] == -1 || points[2] == -1 || points[3] == -1)
 			return;
 
 		std::vector <double> data;
-		for (int i = 0; i < max_Frame; i++)
-		if (particles[points[0]].visible[i] && particles[points[1]].visible[i] &&
-			particles[points[2]].visible[i] && particles[points[3]].visible[i]){
-			data.push_back(
-			(particles[points[0]].positions[i] - particles[points[1]].positions[i]).dot(
-			(particles[points[2]].positions[i] - particles[points[3]].positions[i]))
-			);
-		}
-		else
-		{
-			data.push_back(GRAPHSKIPDVALUE);
-		}
-		graph_angle->setData(data);
+		const XMAParticle &a = particles[points[0]];
+		const XMAParticle &b = particles[points[1]];
+		const XMAParticle &c = particles[points[2]];
+		const XMAParticle &d = particles[points[3]];
+		XMAAnalysis::angleSeries(&a.positions[0], &a.visible[0], &b.positions[0], &b.visible[0],
+			&c.positions[0], &c.visible[0], &d.positions[0], &d.visible[0], max_Frame, GRAPHSKIPDVALUE, data);
+		graph_angle->setData(std::move(data));
 	}
 
 	virtual void onVREvent(const VREvent &event) {
 		//event.print();
+		//MinVR returns the name by value, it is read once for all lookups of the event
+		const std::string &name = event.getName();
 		if(!initialised)
+		{
+			//while loading only the head is followed, to keep the progress panel in view
+			if (loader && (name == "HTC_HMD_1" || name == "Head_Move"))
+				eventDispatcher.dispatch(name, event);
 			return;
-		if (event.getName() == "HTC_HMD_1")
+		}
+		VRProfiler::ScopedTimer timer(phase_events);
+		VRTraceRecorder::Scope trace("onVREvent");
+
+		//live input is ignored while a recorded session is replayed
+		if (inputLog.isReplaying())
+			return;
+
+		//the handlers read a live event directly, only a recording needs a copy of its data
+		if (!inputLog.isRecording())
 		{
-			headpose = event.getDataAsFloatArray("Pose");
+			eventDispatcher.dispatch(name, event);
+			return;
 		}
-		else if (event.getName() == "Head_Move"){
-			headpose = event.getDataAsFloatArray("Transform");
+
+		//only events somebody handles are copied with their data, the others are recorded by name.
+		//The copy is handled, so the recorded session runs on the same values as its replay
+		XMAInputEvent input(name);
+		int id = replayDispatcher.lookup(name);
+		if (replayDispatcher.hasHandler(id))
+			readEventData(event, input);
+		inputLog.record(inputFrame, input);
+		replayDispatcher.dispatch(id, input);
+	}
+
+	//copies the values the handlers read from a VREvent
+	void readEventData(const VREvent &event, XMAInputEvent &input)
+	{
+		static const char * matrixFields[] = { "Pose", "Transform" };
+		static const char * valueFields[] = { "AnalogValue" };
+		static const char * statePaths[] = {
+			"/HTC_Controller_Left/State/Axis0/XPos",
+			"/HTC_Controller_Right/State/Axis0Button_Pressed",
+			"/HTC_Controller_Right/State/Axis0/XPos",
+			"/HTC_Controller_Right/State/Axis0/YPos" };
+
+		VRDataIndex * index = event.getInternal()->getDataIndex();
+		std::string prefix = "/" + event.getName() + "/";
+		for (int i = 0; i < sizeof(matrixFields) / sizeof(matrixFields[0]); i++)
+		{
+			if (index->exists(prefix + matrixFields[i]))
+				input.setData(prefix + matrixFields[i], event.getDataAsFloatArray(matrixFields[i]));
+		}
+		for (int i = 0; i < sizeof(valueFields) / sizeof(valueFields[0]); i++)
+		{
+			if (index->exists(prefix + valueFields[i]))
+				input.setData(prefix + valueFields[i], std::vector<float>(1, event.getDataAsFloat(valueFields[i])));
 		}
-		else if (event.getName() == "HTC_Controller_Right_Axis1Button_Pressed" ||
-			event.getName() == "Wand_Right_Btn_Down"){
-			if (!clickMenus(true)){
-				clicked = true;
+		for (int i = 0; i < sizeof(statePaths) / sizeof(statePaths[0]); i++)
+		{
+			if (index->exists(statePaths[i]))
+				input.setData(statePaths[i], std::vector<float>(1, (float)index->getValue(statePaths[i])));
+		}
+	}
 
-				if (currentMenu == 1)
-				{
-					if (hover_particle != -1){
-						points[0] = hover_particle;
-						points[1] = -1;
+	//hands the recorded events of this frame to the handlers, and ends the application with a
+	//profile of the run once the recording is over
+	void replayEvents()
+	{
+		{
+			VRProfiler::ScopedTimer timer(phase_events);
+			XMAInputEvent input;
+			while (inputLog.next(inputFrame, input))
+				replayDispatcher.dispatch(input);
+		}
 
-						std::vector <double> data;
-						for (int i = 0; i < max_Frame; i++)
-							data.push_back(0);
-						graph_distance->setData(data);
-					}
-				}
-				else if (currentMenu == 2)
-				{
-					if (hover_particle != -1){
-						if (toggle_angle_light1->isToggled()){
-							points[0] = hover_particle;
-							points[1] = -1;
-							std::vector <double> data;
-							for (int i = 0; i < max_Frame; i++)
-								data.push_back(0);
-							graph_angle->setData(data);
-						}
-						else if (toggle_angle_light2->isToggled()){
-							points[2] = hover_particle;
-							points[3] = -1;
-							std::vector <double> data;
-							for (int i = 0; i < max_Frame; i++)
-								data.push_back(0);
-							graph_angle->setData(data);
-						}
-					}
-				}
-				else if (!toggle_move_light->isToggled() && !toggle_add_Particle->isToggled()
-					&& !toggle_move_Particle->isToggled() && !toggle_delete_Particle->isToggled() && !toggle_project_Particle->isToggled())
-				{
-					obj_rotation = controllerpose;
-					rotateObj = true;
-				}
-				else if (toggle_add_Particle->isToggled())
-				{
-					particle p;
-					p.object = current_obj;
+		if (inputLog.isReplayFinished())
+		{
+			inputLog.stopReplay();
+			std::vector<std::string> report = VRProfiler::getInstance()->getReport();
+			for (size_t i = 0; i < report.size(); i++)
+				std::cerr << report[i] << std::endl;
+			VRProfiler::getInstance()->dumpCSV(filename + "replay_profile.csv");
+			std::cerr << "Replay finished, profile written to " << filename << "replay_profile.csv" << std::endl;
+			shutdown();
+		}
+	}
 
-					VRPoint3 p_tmp = roompose.inverse() * controllerpose * VRPoint3(0, 0, tool_dist);
+	//the owners add the other categories when they first allocate, registering them here
+	//keeps the order of the report fixed
+	void registerMemoryCategories()
+	{
+		VRMemoryTracker * memory = VRMemoryTracker::getInstance();
+		memory->addCategory("Meshes");
+		memory->addCategory("Transform tracks");
+		memory_particles = memory->addCategory("Particles");
+		memory->addCategory("Graphs");
+		memory->addCategory("Menus");
+	}
 
-					p_tmp.x = p_tmp.x / scale;
-					p_tmp.y = p_tmp.y / scale;
-					p_tmp.z = p_tmp.z / scale;
+	//Context and Render include the time of the phases nested in them
+	void registerProfilerPhases()
+	{
+		VRProfiler * profiler = VRProfiler::getInstance();
+		phase_events = profiler->addPhase("Events");
+		phase_context = profiler->addPhase("Context");
+		phase_playback = profiler->addPhase("Playback");
+		phase_hover = profiler->addPhase("Hover");
+		phase_render = profiler->addPhase("Render");
+		renderer.registerProfilerPhases();
+	}
 
-					if (toggle_fix_current_Object->isToggled())
-					{
-						p_tmp = objects[fixed_obj]->getTransformation(frame) * object_fixpose.inverse() * p_tmp;
-					}
-					if (current_obj != -1)
-						p_tmp = objects[current_obj]->getTransformation(frame).inverse() * p_tmp;
-					p.position = p_tmp;
+	//values at absolute data paths, read from a live event through its data index
+	static bool hasEventData(const VREvent &event, const std::string &path)
+	{
+		return event.getInternal()->getDataIndex()->exists(path);
+	}
 
-					for (int i = 0; i < max_Frame; i++)
-					{
-						p.visible.push_back(true);
-						VRPoint3 p_frame = p.position;
-						if (current_obj != -1){
-							if (!objects[current_obj]->isVisible(i))
-								p.visible[i] = false;
-							p_frame = objects[current_obj]->getTransformation(i) * p_frame;
-						}
-						if (toggle_fix_current_Object->isToggled())
-						{
-							if (!objects[fixed_obj]->isVisible(i))
-								p.visible[i] = false;
-							p_frame = object_fixpose * objects[fixed_obj]->getTransformation(i).inverse() * p_frame;
-						}
-						p.positions.push_back(p_frame);
-					}
+	static double getEventValue(const VREvent &event, const std::string &path)
+	{
+		return event.getInternal()->getDataIndex()->getValue(path);
+	}
 
-					p.color = current_color;
-					current_color++;
-					current_color = current_color % 20;
-					particles.push_back(p);
-					
-				}
-				else if (toggle_move_Particle->isToggled())
-				{
-					if (hover_particle != -1)
-					{
-						selected_particle = hover_particle;
-					}
-				}
-				else if (toggle_delete_Particle->isToggled())
-				{
-					
-					if (hover_particle != -1)
-					{
-						if (hover_particle <= points[0] || hover_particle <= points[1])
-						{
-							points[0] = -1;
-							points[1] = -1;
-						}
-						if (hover_particle <= points[2] || hover_particle <= points[3])
-						{
-							points[2] = -1;
-							points[3] = -1;
-						}
-						particles.erase(particles.begin() + hover_particle);
-					}
+	static bool hasEventData(const XMAInputEvent &event, const std::string &path)
+	{
+		return event.exists(path);
+	}
 
-				}
-			}
-		}
-		else if (event.getName() == "HTC_Controller_Right_Axis1Button_Released" ||
-			event.getName() == "Wand_Right_Btn_Up"){
-			clickMenus(false);
-			clicked = false;
-			rotateObj = false;
+	static double getEventValue(const XMAInputEvent &event, const std::string &path)
+	{
+		return event.getValue(path);
+	}
+
+	//the handlers are instantiated for live events and for their copies
+	template <class E>
+	void registerEventHandlers(VREventDispatcher<MyVRApp, E> &dispatcher)
+	{
+		dispatcher.addHandler("HTC_HMD_1", &MyVRApp::onHeadPose<E>);
+		dispatcher.addHandler("Head_Move", &MyVRApp::onHeadMove<E>);
+		dispatcher.addHandler("HTC_Controller_Right_Axis1Button_Pressed", &MyVRApp::onToolDown<E>);
+		dispatcher.addHandler("Wand_Right_Btn_Down", &MyVRApp::onToolDown<E>);
+		dispatcher.addHandler("HTC_Controller_Right_Axis1Button_Released", &MyVRApp::onToolUp<E>);
+		dispatcher.addHandler("Wand_Right_Btn_Up", &MyVRApp::onToolUp<E>);
+		dispatcher.addHandler("HTC_Controller_Left_Axis0Button_Pressed", &MyVRApp::onMenuAxisPressed<E>);
+		dispatcher.addHandler("B11_Down", &MyVRApp::onPreviousMenu<E>);
+		dispatcher.addHandler("B12_Down", &MyVRApp::onNextMenu<E>);
+		dispatcher.addHandler("HTC_Controller_Left_Axis1Button_Pressed", &MyVRApp::onShowMenu<E>);
+		dispatcher.addHandler("B13_Down", &MyVRApp::onShowMenu<E>);
+		dispatcher.addHandler("HTC_Controller_Left_Axis1Button_Released", &MyVRApp::onHideMenu<E>);
+		dispatcher.addHandler("B13_Up", &MyVRApp::onHideMenu<E>);
+		dispatcher.addHandler("Wand1_Move", &MyVRApp::onWandMenuMove<E>);
+		dispatcher.addHandler("HTC_Controller_Left", &MyVRApp::onControllerLeft<E>);
+		dispatcher.addHandler("Wand0_Move", &MyVRApp::onWandToolMove<E>);
+		dispatcher.addHandler("Wand_Joystick_Y_Change", &MyVRApp::onJoystickY<E>);
+		dispatcher.addHandler("Wand_Joystick_X_Change", &MyVRApp::onJoystickX<E>);
+		dispatcher.addHandler("HTC_Controller_Right", &MyVRApp::onControllerRight<E>);
+	}
+
+	template <class E>
+	void onHeadPose(const E &event)
+	{
+		headpose = event.getDataAsFloatArray("Pose");
+	}
+
+	template <class E>
+	void onHeadMove(const E &event)
+	{
+		headpose = event.getDataAsFloatArray("Transform");
+	}
+
+	template <class E>
+	void onToolDown(const E &event)
+	{
+		flushMenus();
+		if (!clickMenus(true)){
+			clicked = true;
 
 			if (currentMenu == 1)
 			{
 				if (hover_particle != -1){
-					points[1] = hover_particle;
-					setDistanceData();
+					points[0] = hover_particle;
+					points[1] = -1;
+
+					std::vector <double> data;
+					for (int i = 0; i < max_Frame; i++)
+						data.push_back(0);
+					graph_distance->setData(std::move(data));
 				}
 			}
-			else if (currentMenu == 2){
+			else if (currentMenu == 2)
+			{
 				if (hover_particle != -1){
 					if (toggle_angle_light1->isToggled()){
-						points[1] = hover_particle;
+						points[0] = hover_particle;
+						points[1] = -1;
+						std::vector <double> data;
+						for (int i = 0; i < max_Frame; i++)
+							data.push_back(0);
+						graph_angle->setData(std::move(data));
 					}
 					else if (toggle_angle_light2->isToggled()){
-						points[3] = hover_particle;
-					}
-
-					if (points[0] == -1 || points[1] == -1)
-					{
-						toggle_angle_light1->setToggled(true);
-						toggle_angle_light2->setToggled(false);
-					}
-					else if (points[2] == -1 || points[3] == -1)
-					{
-						toggle_angle_light1->setToggled(false);
-						toggle_angle_light2->setToggled(true);
+						points[2] = hover_particle;
+						points[3] = -1;
+						std::vector <double> data;
+						for (int i = 0; i < max_Frame; i++)
+							data.push_back(0);
+						graph_angle->setData(std::move(data));
 					}
-					else
-					{
-						toggle_angle_light1->setToggled(false);
-						toggle_angle_light2->setToggled(false);		
-					}	
-					setAngleData();
 				}
 			}
-			else if (selected_particle != -1)
+			else if (!toggle_move_light->isToggled() && !toggle_add_Particle->isToggled()
+				&& !toggle_move_Particle->isToggled() && !toggle_delete_Particle->isToggled() && !toggle_project_Particle->isToggled())
 			{
-				if (particles[selected_particle].visible[frame]){
-					VRPoint3 p_tmp = roompose.inverse() * controllerpose * VRPoint3(0, 0, tool_dist);
-
-					p_tmp.x = p_tmp.x / scale;
-					p_tmp.y = p_tmp.y / scale;
-					p_tmp.z = p_tmp.z / scale;
-
-					if (toggle_fix_current_Object->isToggled())
-					{
-						p_tmp = objects[fixed_obj]->getTransformation(frame) * object_fixpose.inverse() * p_tmp;
-					}
-
-					if (particles[selected_particle].object != -1)
-						p_tmp = objects[particles[selected_particle].object]->getTransformation(frame).inverse() * p_tmp;
+				obj_rotation = controllerpose;
+				rotateObj = true;
+			}
+			else if (toggle_add_Particle->isToggled())
+			{
+				XMAParticle p;
+				p.object = current_obj;
 
-					particles[selected_particle].position = p_tmp;
+				VRPoint3 p_tmp = roompose.inverse() * controllerpose * VRPoint3(0, 0, tool_dist);
 
-					particles[selected_particle].positions.clear();
-					for (int i = 0; i < max_Frame; i++)
-					{
-						p_tmp = particles[selected_particle].position;
-						if (particles[selected_particle].object != -1)
-							p_tmp = objects[particles[selected_particle].object]->getTransformation(i) * p_tmp;
-						VRPoint3 p_frame = p_tmp;
-
-						if (toggle_fix_current_Object->isToggled())
-						{
-							p_frame = object_fixpose * objects[fixed_obj]->getTransformation(i).inverse() * p_frame;
-						}
-						particles[selected_particle].positions.push_back(p_frame);
-					}
+				p_tmp.x = p_tmp.x / scale;
+				p_tmp.y = p_tmp.y / scale;
+				p_tmp.z = p_tmp.z / scale;
 
-					selected_particle = -1;
-				}
-			}
-		}
-		else if (event.getName() == "HTC_Controller_Left_Axis0Button_Pressed"){
-			if (menuVisible){
-				double val = event.getInternal()->getDataIndex()->getValue("/HTC_Controller_Left/State/Axis0/XPos");
-				if (val > 0){
-					currentMenu++;
-				}
-				else
+				if (toggle_fix_current_Object->isToggled())
 				{
-					currentMenu--;
+					p_tmp = objects[fixed_obj]->getTransformation(frame) * object_fixpose.inverse() * p_tmp;
 				}
-				currentMenu = currentMenu % menus.size();
-				displayMenu(currentMenu);
-				if (currentMenu == 2)
-				{
-					if (points[0] == -1 || points[1] == -1)
-					{
-						toggle_angle_light1->setToggled(true);
-						toggle_angle_light2->setToggled(false);
-					}
-					else if (points[2] == -1 || points[3] == -1)
-					{
-						toggle_angle_light1->setToggled(false);
-						toggle_angle_light2->setToggled(true);
-					}
-					else
-					{
-						toggle_angle_light1->setToggled(false);
-						toggle_angle_light2->setToggled(false);
-					}
-				}
-			}
-		}
-		else if (event.getName() == "B11_Down"){
-			if (menuVisible){			
-				currentMenu--;
+				if (current_obj != -1)
+					p_tmp = objects[current_obj]->getTransformation(frame).inverse() * p_tmp;
+				p.position = p_tmp;
+				computeTrajectory(p);
+
+				p.color = current_color;
+				current_color++;
+				current_color = current_color % XMA_PARTICLE_COLORS;
+				particles.push_back(p);
+				countParticleMemory();
 				
-				currentMenu = currentMenu % menus.size();
-				displayMenu(currentMenu);
-				if (currentMenu == 2)
+			}
+			else if (toggle_move_Particle->isToggled())
+			{
+				if (hover_particle != -1)
 				{
-					if (points[0] == -1 || points[1] == -1)
-					{
-						toggle_angle_light1->setToggled(true);
-						toggle_angle_light2->setToggled(false);
-					}
-					else if (points[2] == -1 || points[3] == -1)
-					{
-						toggle_angle_light1->setToggled(false);
-						toggle_angle_light2->setToggled(true);
-					}
-					else
-					{
-						toggle_angle_light1->setToggled(false);
-						toggle_angle_light2->setToggled(false);
-					}
+					selected_particle = hover_particle;
 				}
 			}
-		}
-		else if (event.getName() == "B12_Down"){
-			if (menuVisible){			
-				currentMenu++;
+			else if (toggle_delete_Particle->isToggled())
+			{
 				
-				currentMenu = currentMenu % menus.size();
-				displayMenu(currentMenu);
-				if (currentMenu == 2)
+				if (hover_particle != -1)
 				{
-					if (points[0] == -1 || points[1] == -1)
+					if (hover_particle <= points[0] || hover_particle <= points[1])
 					{
-						toggle_angle_light1->setToggled(true);
-						toggle_angle_light2->setToggled(false);
-					}
-					else if (points[2] == -1 || points[3] == -1)
-					{
-						toggle_angle_light1->setToggled(false);
-						toggle_angle_light2->setToggled(true);
+						points[0] = -1;
+						points[1] = -1;
 					}
-					else
+					if (hover_particle <= points[2] || hover_particle <= points[3])
 					{
-						toggle_angle_light1->setToggled(false);
-						toggle_angle_light2->setToggled(false);
+						points[2] = -1;
+						points[3] = -1;
 					}
+					particles.erase(particles.begin() + hover_particle);
+					countParticleMemory();
 				}
+
 			}
 		}
-		else if (event.getName() == "HTC_Controller_Left_Axis1Button_Pressed" ||
-			event.getName() == "B13_Down")
-{
-			displayMenu(currentMenu);
-		}
-		else if (event.getName() == "HTC_Controller_Left_Axis1Button_Released" ||
-			event.getName() == "B13_Up"){
-			displayMenu(-1);
+	}
+
+	template <class E>
+	void onToolUp(const E &event)
+	{
+		flushMenus();
+		clickMenus(false);
+		clicked = false;
+		rotateObj = false;
+
+		if (currentMenu == 1)
+		{
+			if (hover_particle != -1){
+				points[1] = hover_particle;
+				setDistanceData();
+			}
 		}
-		else if (event.getName() == "Wand1_Move"){
-			menupose = event.getDataAsFloatArray("Transform");
-			menupose = menupose * VRMatrix4::rotationY(deg2rad * -180)  * VRMatrix4::translation(VRVector3(0, 0.6,0));		
-			updateMenus();
+		else if (currentMenu == 2){
+			if (hover_particle != -1){
+				if (toggle_angle_light1->isToggled()){
+					points[1] = hover_particle;
+				}
+				else if (toggle_angle_light2->isToggled()){
+					points[3] = hover_particle;
+				}
+
+				updateAngleToggles();
+				setAngleData();
+			}
 		}
-		else if (event.getName() == "HTC_Controller_Left")
+		else if (selected_particle != -1)
 		{
-			if (event.getInternal()->getDataIndex()->exists("/HTC_Controller_Left/Pose")){
-				menupose = event.getDataAsFloatArray("Pose");
-				menupose = menupose *VRMatrix4::translation(VRVector3(0, 0.0, -0.3));// VRMatrix4::rotationX(deg2rad * -90) * VRMatrix4::translation(VRVector3(0, -0.2, 0));
-				updateMenus();
+			if (particles[selected_particle].visible[frame]){
+				VRPoint3 p_tmp = roompose.inverse() * controllerpose * VRPoint3(0, 0, tool_dist);
+
+				p_tmp.x = p_tmp.x / scale;
+				p_tmp.y = p_tmp.y / scale;
+				p_tmp.z = p_tmp.z / scale;
+
+				if (toggle_fix_current_Object->isToggled())
+				{
+					p_tmp = objects[fixed_obj]->getTransformation(frame) * object_fixpose.inverse() * p_tmp;
+				}
+
+				if (particles[selected_particle].object != -1)
+					p_tmp = objects[particles[selected_particle].object]->getTransformation(frame).inverse() * p_tmp;
+
+				particles[selected_particle].position = p_tmp;
+
+				computeTrajectory(particles[selected_particle]);
+				countParticleMemory();
+
+				selected_particle = -1;
 			}
 		}
-		else if (event.getName() == "Wand0_Move"){
-			controllerpose = event.getDataAsFloatArray("Transform");
-			updateMenus();
-		}
-		else if(event.getName() == "Wand_Joystick_Y_Change") {
-			movement_y = event.getDataAsFloat("AnalogValue");
+	}
+
+	template <class E>
+	void onMenuAxisPressed(const E &event)
+	{
+		static const std::string xPos("/HTC_Controller_Left/State/Axis0/XPos");
+		double val = getEventValue(event, xPos);
+		switchMenu((val > 0) ? 1 : -1);
+	}
+
+	template <class E>
+	void onPreviousMenu(const E &event)
+	{
+		switchMenu(-1);
+	}
+
+	template <class E>
+	void onNextMenu(const E &event)
+	{
+		switchMenu(1);
+	}
+
+	template <class E>
+	void onShowMenu(const E &event)
+	{
+		displayMenu(currentMenu);
+	}
+
+	template <class E>
+	void onHideMenu(const E &event)
+	{
+		displayMenu(-1);
+	}
+
+	template <class E>
+	void onWandMenuMove(const E &event)
+	{
+		menupose = event.getDataAsFloatArray("Transform");
+		menupose = menupose * VRMatrix4::rotationY(deg2rad * -180)  * VRMatrix4::translation(VRVector3(0, 0.6,0));		
+		menusDirty = true;
+	}
+
+	template <class E>
+	void onControllerLeft(const E &event)
+	{
+		static const std::string pose("/HTC_Controller_Left/Pose");
+		if (hasEventData(event, pose)){
+			menupose = event.getDataAsFloatArray("Pose");
+			menupose = menupose *VRMatrix4::translation(VRVector3(0, 0.0, -0.3));// VRMatrix4::rotationX(deg2rad * -90) * VRMatrix4::translation(VRVector3(0, -0.2, 0));
+			menusDirty = true;
 		}
-		else if(event.getName() == "Wand_Joystick_X_Change") {
-			movement_x = event.getDataAsFloat("AnalogValue");
+	}
+
+	template <class E>
+	void onWandToolMove(const E &event)
+	{
+		controllerpose = event.getDataAsFloatArray("Transform");
+		menusDirty = true;
+	}
+
+	template <class E>
+	void onJoystickY(const E &event)
+	{
+		movement_y = event.getDataAsFloat("AnalogValue");
+	}
+
+	template <class E>
+	void onJoystickX(const E &event)
+	{
+		movement_x = event.getDataAsFloat("AnalogValue");
+	}
+
+	template <class E>
+	void onControllerRight(const E &event)
+	{
+		//the paths are built once, this event arrives every frame
+		static const std::string pose("/HTC_Controller_Right/Pose");
+		static const std::string pressed("/HTC_Controller_Right/State/Axis0Button_Pressed");
+		static const std::string xPos("/HTC_Controller_Right/State/Axis0/XPos");
+		static const std::string yPos("/HTC_Controller_Right/State/Axis0/YPos");
+		if (hasEventData(event, pose)){
+			controllerpose = event.getDataAsFloatArray("Pose");
+			menusDirty = true;
+		}
+		if (hasEventData(event, pressed) && (int)getEventValue(event, pressed)){
+			movement_x = getEventValue(event, xPos);
+			movement_y = getEventValue(event, yPos);
 		}
-		else if (event.getName() == "HTC_Controller_Right")
+		else
 		{
-			if (event.getInternal()->getDataIndex()->exists("/HTC_Controller_Right/Pose")){
-				controllerpose = event.getDataAsFloatArray("Pose");
-				updateMenus();
-			}
-			if (event.getInternal()->getDataIndex()->exists("/HTC_Controller_Right/State/Axis0Button_Pressed") &&
-				(int)event.getInternal()->getDataIndex()->getValue("/HTC_Controller_Right/State/Axis0Button_Pressed")){
-				movement_x = event.getInternal()->getDataIndex()->getValue("/HTC_Controller_Right/State/Axis0/XPos");
-				movement_y = event.getInternal()->getDataIndex()->getValue("/HTC_Controller_Right/State/Axis0/YPos");
-			}
-			else
-			{
-				movement_y = 0;
-				movement_x = 0;
-			}
+			movement_y = 0;
+			movement_x = 0;
 		}
+	}
 
-		if (event.getName() == "KbdEsc_Down") {
-			//shutdown();
+	void switchMenu(int step)
+	{
+		if (!menuVisible)
 			return;
+
+		currentMenu += step;
+		currentMenu = currentMenu % menus.size();
+		displayMenu(currentMenu);
+		if (currentMenu == 2)
+			updateAngleToggles();
+	}
+
+	void updateAngleToggles()
+	{
+		if (points[0] == -1 || points[1] == -1)
+		{
+			toggle_angle_light1->setToggled(true);
+			toggle_angle_light2->setToggled(false);
+		}
+		else if (points[2] == -1 || points[3] == -1)
+		{
+			toggle_angle_light1->setToggled(false);
+			toggle_angle_light2->setToggled(true);
+		}
+		else
+		{
+			toggle_angle_light1->setToggled(false);
+			toggle_angle_light2->setToggled(false);
 		}
 	}
 
 	virtual void onVRRenderGraphicsContext(const VRGraphicsState& state)
 	{
 		if (!initialised) {
-			loadData(filename, objscale);
-			glLightfv(GL_LIGHT0, GL_POSITION, light_pos);
+			if (!loader) {
+				GLenum err = glewInit();
+				if (err != GLEW_OK){
+					std::cerr << "GLEW init error: " << glewGetErrorString(err) << std::endl;
+				}
+				startLoading(filename, objscale);
+				glLightfv(GL_LIGHT0, GL_POSITION, light_pos);
+			}
+			updateLoading();
+			if (!initialised) {
+				renderer.prepare(getLoadingRenderState());
+				return;
+			}
 			glLightModeli(GL_LIGHT_MODEL_TWO_SIDE, toggle_display_transparent->isToggled());
 		}
 
+		if (inputLog.isReplaying())
+			replayEvents();
+		inputFrame++;
+
+		VRProfiler::getInstance()->endFrame();
+		VRTraceRecorder::getInstance()->update();
+		updateProfilerPage();
+		updateMemoryPage();
+		updateCollisionCheck();
+		updateFilter();
+		renderer.resetStats();
+		VRProfiler::ScopedTimer timer(phase_context);
+		VRTraceRecorder::Scope trace("onVRRenderGraphicsContext");
+
 		graph_distance->setCurrent(frame);
 		graph_angle->setCurrent(frame);
+		graph_collision->setCurrent(frame);
 
 		if (toggle_play->isToggled()){
 			frame += speed;
@@ -598,8 +863,25 @@ public:
 			
 		}
 
-		for (std::vector<VRMenu*>::const_iterator it = menus.begin(); it != menus.end(); ++it){
-			(*it)->updateIteration();
+		//levels of detail of the last bones are still compiled after the application started
+		uploadObjects();
+
+		{
+			VRProfiler::ScopedTimer timer(phase_playback);
+			VRTraceRecorder::Scope trace("playback");
+			for (std::vector<XMAObject*>::const_iterator it = objects.begin(); it != objects.end(); ++it){
+				(*it)->setPlayhead((int)frame);
+			}
+		}
+
+		{
+			VRProfiler::ScopedTimer timer(renderer.getMenuPhase());
+			VRTraceRecorder::Scope trace("updateMenus");
+			flushMenus();
+			for (std::vector<VRMenu*>::const_iterator it = menus.begin(); it != menus.end(); ++it){
+				(*it)->updateIteration();
+				(*it)->updateTexture();
+			}
 		}
 
 		if (clicked)
@@ -642,363 +924,98 @@ public:
 
 		if (toggle_delete_Particle->isToggled() || toggle_move_Particle->isToggled() || currentMenu == 1 || currentMenu == 2)
 		{
-			VRPoint3 pos = controllerpose * VRPoint3(0, 0, tool_dist);
+			VRProfiler::ScopedTimer timer(phase_hover);
+			VRTraceRecorder::Scope trace("hover");
+			//search in trajectory space. roompose is rigid, so only the radius has to be scaled
 			hover_particle = -1;
-			double d = 0.15;
-			for (int i = 0; i < particles.size(); i++)
+			if (scale > 0)
 			{
-				VRPoint3 p_particle = particles[i].position;
-				if (particles[i].object != -1)
-					p_particle = objects[particles[i].object]->getTransformation(frame) * p_particle;
-
-				if (toggle_fix_current_Object->isToggled())
-				{
-					p_particle = object_fixpose * objects[fixed_obj]->getTransformation(frame).inverse() * p_particle;
-				}
-				p_particle.x = p_particle.x * scale;
-				p_particle.y = p_particle.y * scale;
-				p_particle.z = p_particle.z * scale;
-				p_particle = roompose.getArray() * p_particle;
+				VRPoint3 pos = roompose.inverse() * controllerpose * VRPoint3(0, 0, tool_dist);
+				float target[3] = { (float)(pos.x / scale), (float)(pos.y / scale), (float)(pos.z / scale) };
 
-				if ((p_particle - pos).length() < d)
+				int f = (int)frame;
+				hover_points.resize(3 * particles.size());
+				for (int i = 0; i < particles.size(); i++)
 				{
-					d = (p_particle - pos).length();
-					hover_particle = i;
+					hover_points[3 * i] = particles[i].positions[3 * f];
+					hover_points[3 * i + 1] = particles[i].positions[3 * f + 1];
+					hover_points[3 * i + 2] = particles[i].positions[3 * f + 2];
 				}
-
+				hover_particle = XMAAnalysis::findNearest(hover_points.data(), particles.size(), target, 0.15 / scale);
 			}
 		}
+
+		//everything of the frame both eyes share
+		renderer.prepare(getRenderState());
 	}
 
 	virtual void onVRRenderGraphics(const VRGraphicsState &state) {
-		glClearColor(1.0, 1.0, 1.0, 1.0);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-		glEnable(GL_NORMALIZE);
-		glEnable(GL_DEPTH_TEST);
-		glEnable(GL_COLOR_MATERIAL);
-
-		glEnable(GL_LIGHTING);
-		glEnable(GL_LIGHT0);
-
-		glMatrixMode(GL_PROJECTION);
-		glLoadMatrixf(state.getProjectionMatrix());
-
-		glMatrixMode(GL_MODELVIEW);
-		glLoadMatrixf(state.getViewMatrix());
-
-		if (toggle_display_transparent->isToggled()){
-			//transparent
-			glDepthFunc(GL_ALWAYS); // The Type Of Depth Testing To Do
-			glEnable(GL_BLEND);
-			glBlendFunc(GL_ZERO, GL_SRC_COLOR);
-			glDisable(GL_CULL_FACE);
-		}
-		//Do Rendereing
-		glPushMatrix();
-		glMultMatrixf(roompose.getArray());
-		glScaled(scale, scale, scale);
-		if (toggle_fix_current_Object->isToggled())
-		{
-			glMultMatrixf(object_fixpose.getArray());
-			glMultMatrixf(objects[fixed_obj]->getTransformation(frame).inverse().getArray());
-		}
-		for (int i = 0; i < objects.size(); i++)
-		{	
-			if (i == current_obj) {
-				glColor3f(1.0, 1.0, 0.0);
-			}
-			else
-			{
-				glColor3f(1.0, 1.0, 1.0);
-			}
-			if (toggle_fix_current_Object->isToggled())
-			{
-				if (objects[fixed_obj]->isVisible(frame))
-				{
-					objects[i]->render((int)frame);
-				}
-			}
-			else{
-				objects[i]->render((int)frame);
-			}
-		}
-		glPopMatrix();
-
-		
-		if (toggle_display_transparent->isToggled()){
-			//transparent
-			glDisable(GL_BLEND);
-			glDepthFunc(GL_LESS); // The Type Of Depth Testing To Do
-		}
-
-		//Do other rendering
-		glPushMatrix();
-		glMultMatrixf(roompose.getArray());
-		glScaled(scale, scale, scale);
-		if (toggle_fix_current_Object->isToggled())
-		{
-			glMultMatrixf(object_fixpose.getArray());
-			glMultMatrixf(objects[fixed_obj]->getTransformation(frame).inverse().getArray());
-		}
-
-		//draw Particles
-		for (int i = 0; i < particles.size(); i++)
-		{
-			if (particles[i].visible[frame]){
-				if ((i == hover_particle && selected_particle == -1) ||
-					selected_particle == i) {
-					glColor3f(1.0, 0.0, 0.0);
-				}
-				else
-				{
-					glColor3f(color_array[particles[i].color][0], color_array[particles[i].color][1], color_array[particles[i].color][2]);
-				}
-
-				glPushMatrix();
-				if (particles[i].object != -1)
-					glMultMatrixf(objects[particles[i].object]->getTransformation(frame).getArray());
-				glTranslatef(particles[i].position.x, particles[i].position.y, particles[i].position.z);
-				glScaled(1.0 / scale, 1.0 / scale, 1.0 / scale);
-				glCallList(sphere);
-				glPopMatrix();
-			}
-		}
-		glPopMatrix();
-
-		//draw tool
-		if (!toggle_project_Particle->isToggled() || !clicked){
-			glPushMatrix();
-			glMultMatrixf(controllerpose.getArray());
-			glBegin(GL_LINES);                // Begin drawing the color cube with 6 quads
-			// Back face (z = -1.0f)
-			glColor3f(0.1f, 0.1f, 0.0f);     // Yellow
-			glVertex3f(0.0f, 0.0f, -5.0f);
-			glVertex3f(0.0f, 0.0f, 0.0f);
-			glEnd();  // End of drawing color-cube
-			if (toggle_add_Particle->isToggled() || toggle_move_Particle->isToggled() ||
-				toggle_delete_Particle->isToggled() || toggle_move_light->isToggled() || currentMenu == 1 || currentMenu == 2){
-				glTranslatef(0, 0, tool_dist);
-				glScalef(1.0 / scale * 0.03, 1.0 / scale * 0.03, 1.0 / scale * 0.03);
-				glCallList(sphere);
-			}
-			glPopMatrix();
-		} 
-
-		//draw projected particle
-		if (toggle_project_Particle->isToggled() && clicked)
-		{
-			VRVector3 controller_n = controllerpose * VRVector3(0, 1, 0);
-
-			for (int i = 0; i < particles.size(); i++)
-			{
-				if (particles[i].visible[frame]){
-					if ((i == hover_particle && selected_particle == -1) ||
-						selected_particle == i) {
-						glColor3f(1.0, 0.0, 0.0);
-					}
-					else
-					{
-						glColor3f(color_array[particles[i].color][0], color_array[particles[i].color][1], color_array[particles[i].color][2]);
-					}
-
-					VRPoint3 p_particle = particles[i].positions[frame];
-					p_particle.x = p_particle.x * scale;
-					p_particle.y = p_particle.y * scale;
-					p_particle.z = p_particle.z * scale;
-					p_particle = roompose * p_particle;
-					VRPoint3 p_particle2 = controllerpose.inverse()* p_particle;
-					double d = -p_particle2.y;
-					glPushMatrix();
-					glTranslatef(p_particle.x + d * controller_n.x, p_particle.y + d * controller_n.y, p_particle.z + d * controller_n.z);
-					glScalef(1.0 / scale * 0.01, 1.0 / scale * 0.01, 1.0 / scale * 0.01);
-					glCallList(sphere);
-					glPopMatrix();
-				}
-			}
-		}
-
-		glDisable(GL_LIGHTING);
-
-		//draw lines
-		if (points[0] != -1 && particles[points[0]].visible[frame] &&
-			(points[1] == -1 || (points[1] != -1 && particles[points[1]].visible[frame])))
-			{
-				VRPoint3 pt1 = particles[points[0]].positions[frame];
-				pt1.x = pt1.x *scale;
-				pt1.y = pt1.y *scale;
-				pt1.z = pt1.z *scale;
-				pt1 = roompose * pt1;
-
-				VRPoint3 pt2;
-
-				if (points[1] != -1)
-				{
-					pt2 = particles[points[1]].positions[frame];
-					pt2.x = pt2.x *scale;
-					pt2.y = pt2.y *scale;
-					pt2.z = pt2.z *scale;
-					pt2 = roompose * pt2;
-				}
-				else
-				{
-					pt2 = controllerpose * VRPoint3(0, 0, tool_dist);
-				}
-				glPushMatrix();
-				glBegin(GL_LINES);                // Begin drawing the color cube with 6 quads
-				// Back face (z = -1.0f)
-				glColor3f(1.0f, 0.0f, 0.0f);     // Yellow
-				glVertex3f(pt1.x, pt1.y, pt1.z);
-				glVertex3f(pt2.x, pt2.y, pt2.z);
-				glEnd();  // End of drawing color-cube
-				glPopMatrix();
-		}
-
-		if (points[2] != -1 && particles[points[2]].visible[frame] &&
-			(points[3] == -1 || (points[3] != -1 && particles[points[3]].visible[frame])))
-		{
-			VRPoint3 pt1 = particles[points[2]].positions[frame];
-			pt1.x = pt1.x *scale;
-			pt1.y = pt1.y *scale;
-			pt1.z = pt1.z *scale;
-			pt1 = roompose * pt1;
-
-			VRPoint3 pt2;
-
-			if (points[3] != -1)
-			{
-				pt2 = particles[points[3]].positions[frame];
-				pt2.x = pt2.x *scale;
-				pt2.y = pt2.y *scale;
-				pt2.z = pt2.z *scale;
-				pt2 = roompose * pt2;
-			}
-			else
-			{
-				pt2 = controllerpose * VRPoint3(0, 0, tool_dist);
-			}
-			glPushMatrix();
-			glBegin(GL_LINES);                // Begin drawing the color cube with 6 quads
-			// Back face (z = -1.0f)
-			glColor3f(0.0f, 0.0f, 1.0f);     // Yellow
-			glVertex3f(pt1.x, pt1.y, pt1.z);
-			glVertex3f(pt2.x, pt2.y, pt2.z);
-			glEnd();  // End of drawing color-cube
-			glPopMatrix();
-		}
-
-		if (toggle_project_Particle->isToggled() && clicked)
-		{
-			double min_x = 1000000000;
-			double min_z = 1000000000;
-			double max_x = -1000000000;
-			double max_z = -1000000000;
-			VRVector3 controller_n = controllerpose * VRVector3(0, 1, 0);
-
-			for (int i = 0; i < particles.size(); i++)
-			{
-				if ((i == hover_particle && selected_particle == -1) ||
-					selected_particle == i) {
-					glColor3f(1.0, 0.0, 0.0);
-				}
-				else
-				{
-					glColor3f(color_array[particles[i].color][0], color_array[particles[i].color][1], color_array[particles[i].color][2]);
-				}
-
-				glBegin(GL_LINE_STRIP);
-				int start = 0;
-				int end = particles[i].positions.size();
-
-				if (particle_trail != -1)
-				{
-					start = frame - particle_trail;
-					if (start < 0) start = 0;
-					end = frame;
-				}
-
-				for (int j = start; j < end; j++)
-				{
-					if (particles[i].visible[j]){
-						VRPoint3 p_particle = particles[i].positions[j];
-						p_particle.x = p_particle.x * scale;
-						p_particle.y = p_particle.y * scale;
-						p_particle.z = p_particle.z * scale;
-						p_particle = roompose * p_particle;
-						VRPoint3 p_particle2 = controllerpose.inverse()* p_particle;
-						double d = -p_particle2.y;
-
-						if (p_particle2.x < min_x) min_x = p_particle2.x;
-						if (p_particle2.x > max_x) max_x = p_particle2.x;
-						if (p_particle2.z < min_z) min_z = p_particle2.z;
-						if (p_particle2.z > max_z) max_z = p_particle2.z;
-					
-						glVertex3f(p_particle.x + d * controller_n.x, p_particle.y + d * controller_n.y, p_particle.z + d * controller_n.z);
-					}
-					else
-					{
-						glEnd();
-						glBegin(GL_LINE_STRIP);
-					}
-				}
-				glEnd();
-			}
-
-			glPushMatrix();
-			glMultMatrixf(controllerpose.getArray());
-			glBegin(GL_LINE_STRIP);                
-			glColor3f(0.5f, 0.5f, 0.0f);     // Yellow
-			glVertex3f(min_x - 0.1, 0.0f, max_z + 0.1);
-			glVertex3f(max_x + 0.1, 0.0f, max_z + 0.1);
-			glVertex3f(max_x + 0.1, 0.0f, min_z - 0.1);
-			glVertex3f(min_x - 0.1, 0.0f, min_z - 0.1);
-			glVertex3f(min_x - 0.1, 0.0f, max_z + 0.1);
-			glEnd();  // End of drawing color-cube
-			glPopMatrix();
-		}
-		
-		glPushMatrix();
-		glMultMatrixf(roompose.getArray());
-		glScaled(scale, scale, scale);
-		for (int i = 0; i < particles.size(); i++)
-		{
-			if ((i == hover_particle && selected_particle == -1) ||
-				selected_particle == i) {
-				glColor3f(1.0, 0.0, 0.0);
-			}
-			else
-			{
-				glColor3f(color_array[particles[i].color][0], color_array[particles[i].color][1], color_array[particles[i].color][2]);
-			}
-
-			glBegin(GL_LINE_STRIP);
-			int start = 0;
-			int end = particles[i].positions.size();
-
-			if (particle_trail != -1)
-			{
-				start = frame - particle_trail;
-				if (start < 0) start = 0;
-				end = frame;
-			}
-
-			for (int j = start; j < end; j++)
-			{
-				if (particles[i].visible[j]){
-					glVertex3f(particles[i].positions[j].x, particles[i].positions[j].y, particles[i].positions[j].z);
-				}
-				else
-				{
-					glEnd();
-					glBegin(GL_LINE_STRIP);
-				}
-			}
-			glEnd();
-		}
-		glPopMatrix();
+		VRProfiler::ScopedTimer timer(phase_render);
+		VRTraceRecorder::Scope trace("onVRRenderGraphics");
+		renderer.render(state.getProjectionMatrix(), state.getViewMatrix());
+		focal_length = state.getProjectionMatrix()[5];
+	}
 
-		drawMenus();
+	//scene and menu state the renderer draws from
+	XMARenderState getRenderState()
+	{
+		XMARenderState s;
+		s.objects = &objects;
+		s.particles = &particles;
+		s.menus = &menus;
+		s.frame = frame;
+		s.scale = scale;
+		s.roompose = roompose;
+		s.controllerpose = controllerpose;
+		s.object_fixpose = object_fixpose;
+		s.fixed_obj = toggle_fix_current_Object->isToggled() ? fixed_obj : -1;
+		s.current_obj = current_obj;
+		s.hover_particle = hover_particle;
+		s.selected_particle = selected_particle;
+		s.particle_trail = particle_trail;
+		for (int i = 0; i < 4; i++)
+			s.points[i] = points[i];
+		s.tool_dist = tool_dist;
+		s.transparent = toggle_display_transparent->isToggled();
+		s.project = toggle_project_Particle->isToggled() && clicked;
+		s.showTool = true;
+		s.showToolSphere = toggle_add_Particle->isToggled() || toggle_move_Particle->isToggled() ||
+			toggle_delete_Particle->isToggled() || toggle_move_light->isToggled() || currentMenu == 1 || currentMenu == 2;
+		s.lod = true;
+		s.headpose = headpose;
+		s.focalLength = focal_length;
+		return s;
 	}
 
+	//bones loaded so far at their first frame and the progress panel
+	XMARenderState getLoadingRenderState()
+	{
+		XMARenderState s;
+		s.objects = &objects;
+		s.particles = &particles;
+		s.menus = &loadingMenus;
+		s.frame = 0;
+		s.scale = scale;
+		s.roompose = roompose;
+		s.controllerpose = controllerpose;
+		s.object_fixpose = object_fixpose;
+		s.fixed_obj = -1;
+		s.current_obj = -1;
+		s.hover_particle = -1;
+		s.selected_particle = -1;
+		s.particle_trail = -1;
+		for (int i = 0; i < 4; i++)
+			s.points[i] = -1;
+		s.tool_dist = tool_dist;
+		s.transparent = false;
+		s.project = false;
+		s.showTool = false;
+		s.showToolSphere = false;
+		s.lod = true;
+		s.headpose = headpose;
+		s.focalLength = focal_length;
+		return s;
+	}
 
 	virtual void handleEvent(VRMenuElement * element)
 	{
@@ -1014,6 +1031,53 @@ public:
 		{			
 			frame = graph_angle->getSelection();		
 		}
+		else if (element == graph_collision)
+		{
+			frame = graph_collision->getSelection();
+		}
+		else if (element == button_check_collisions)
+		{
+			startCollisionCheck();
+		}
+		else if (element == button_prev_collision)
+		{
+			jumpToCollision(-1);
+		}
+		else if (element == button_next_collision)
+		{
+			jumpToCollision(1);
+		}
+		else if (element == toggle_filter)
+		{
+			applyFilter();
+		}
+		else if (element == button_decrease_cutoff || element == button_increase_cutoff)
+		{
+			//1 Hz steps below 10 Hz, 5 Hz steps above
+			if (element == button_increase_cutoff)
+				filter_cutoff += (filter_cutoff < 10.0) ? 1.0 : 5.0;
+			else if (filter_cutoff > 1.0)
+				filter_cutoff -= (filter_cutoff <= 10.0) ? 1.0 : 5.0;
+			textbox_cutoff->setText("Cutoff: " + std::to_string((long long)filter_cutoff) + " Hz");
+			if (toggle_filter->isToggled())
+				applyFilter();
+		}
+		else if (element == button_decrease_rate || element == button_increase_rate)
+		{
+			static const double rates[] = { 30, 60, 100, 120, 125, 200, 250, 300, 500, 1000, 2000 };
+			int count = sizeof(rates) / sizeof(rates[0]);
+			int r = 0;
+			while (r + 1 < count && rates[r] < filter_sample_rate)
+				r++;
+			if (element == button_increase_rate && rates[r] <= filter_sample_rate)
+				r = std::min(r + 1, count - 1);
+			else if (element == button_decrease_rate)
+				r = std::max(r - 1, 0);
+			filter_sample_rate = rates[r];
+			textbox_sample_rate->setText("Sample rate: " + std::to_string((long long)filter_sample_rate) + " Hz");
+			if (toggle_filter->isToggled())
+				applyFilter();
+		}
 		else if (element == toggle_display_transparent)
 		{
 			glLightModeli(GL_LIGHT_MODEL_TWO_SIDE, toggle_display_transparent->isToggled());
@@ -1156,6 +1220,31 @@ public:
 			scale += 0.01;
 			textbox_current_scale->setText("Scale: " + std::to_string((long double)scale));
 		}
+		else if (element == toggle_profiler)
+		{
+			VRProfiler::getInstance()->setEnabled(toggle_profiler->isToggled());
+			profiler_refresh = PROFILER_HUD_INTERVAL;
+		}
+		else if (element == button_dump_profile)
+		{
+			std::string csv = filename + "profile.csv";
+			if (VRProfiler::getInstance()->dumpCSV(csv)){
+				std::cerr << "Profile written to " << csv << std::endl;
+			}
+			else
+			{
+				std::cerr << "Could not write " << csv << std::endl;
+			}
+		}
+		else if (element == button_dump_memory)
+		{
+			dumpMemory();
+		}
+		else if (element == button_trace)
+		{
+			if (!VRTraceRecorder::getInstance()->isRecording())
+				VRTraceRecorder::getInstance()->start(TRACE_SECONDS, filename + "trace.json");
+		}
 		else if (element == button_decrease_scale)
 		{
 			scale -= 0.01;
@@ -1192,6 +1281,7 @@ public:
 				menus[i]->setVisible(true);
 			}
 		}
+		menusDirty = true;
 	}
 
 	void createMenu()
@@ -1211,6 +1301,7 @@ public:
 		button_prev_frame = new VRButton("button_prev_frame", "-", true);
 		menu1->addElement(button_prev_frame, 1, 3, 1, 1);
 		textbox_current_frame = new VRTextBox("textbox_current_frame", "Frame: " + std::to_string((long long)frame + 1));
+		textbox_current_frame->setOverlay(true);
 		menu1->addElement(textbox_current_frame, 2, 3, 6, 1);
 		button_next_frame = new VRButton("button_next_frame", "+", true);
 		menu1->addElement(button_next_frame, 8, 3, 1, 1);
@@ -1283,26 +1374,268 @@ public:
 		menu3->addMenuHandler(this);
 
 		menus.push_back(menu3);
+
+		VRMenu *menu4 = new VRMenu(1.0, 1.0, 8, 8, "Profiler");
+		toggle_profiler = new VRToggle("toggle_profiler", "Profile");
+		menu4->addElement(toggle_profiler, 1, 1, 3, 1);
+		button_dump_profile = new VRButton("button_dump_profile", "Dump CSV");
+		menu4->addElement(button_dump_profile, 4, 1, 3, 1);
+		button_trace = new VRButton("button_trace", "Trace 5s");
+		menu4->addElement(button_trace, 7, 1, 2, 1);
+		textbox_profiler = new VRMultiLineTextBox("textbox_profiler", VRProfiler::getInstance()->getReport(), VRFontHandler::LEFT);
+		menu4->addElement(textbox_profiler, 1, 2, 8, 7);
+
+		menu4->addMenuHandler(this);
+
+		menus.push_back(menu4);
+
+		VRMenu *menu5 = new VRMenu(1.0, 1.0, 8, 8, "Memory");
+		button_dump_memory = new VRButton("button_dump_memory", "Dump CSV");
+		menu5->addElement(button_dump_memory, 1, 1, 3, 1);
+		textbox_memory = new VRMultiLineTextBox("textbox_memory", VRMemoryTracker::getInstance()->getReport(getBoneMemory(MEMORY_PAGE_BONES)), VRFontHandler::LEFT);
+		menu5->addElement(textbox_memory, 1, 2, 8, 7);
+
+		menu5->addMenuHandler(this);
+
+		menus.push_back(menu5);
+
+		VRMenu *menu6 = new VRMenu(1.0, 1.0, 8, 8, "Collisions");
+		button_check_collisions = new VRButton("button_check_collisions", "Check all frames");
+		menu6->addElement(button_check_collisions, 1, 1, 8, 1);
+		button_prev_collision = new VRButton("button_prev_collision", "-");
+		menu6->addElement(button_prev_collision, 1, 2, 1, 1);
+		textbox_collision = new VRTextBox("textbox_collision", "Not checked");
+		menu6->addElement(textbox_collision, 2, 2, 6, 1);
+		button_next_collision = new VRButton("button_next_collision", "+");
+		menu6->addElement(button_next_collision, 8, 2, 1, 1);
+		graph_collision = new VRGraph("graph_collision", data);
+		menu6->addElement(graph_collision, 1, 3, 8, 6);
+
+		menu6->addMenuHandler(this);
+
+		menus.push_back(menu6);
+
+		VRMenu *menu7 = new VRMenu(1.0, 1.0, 8, 8, "Filter");
+		toggle_filter = new VRToggle("toggle_filter", "Low-pass filter");
+		menu7->addElement(toggle_filter, 1, 1, 8, 1);
+		button_decrease_cutoff = new VRButton("button_decrease_cutoff", "-");
+		menu7->addElement(button_decrease_cutoff, 1, 2, 1, 1);
+		textbox_cutoff = new VRTextBox("textbox_cutoff", "Cutoff: " + std::to_string((long long)filter_cutoff) + " Hz");
+		menu7->addElement(textbox_cutoff, 2, 2, 6, 1);
+		button_increase_cutoff = new VRButton("button_increase_cutoff", "+");
+		menu7->addElement(button_increase_cutoff, 8, 2, 1, 1);
+		button_decrease_rate = new VRButton("button_decrease_rate", "-");
+		menu7->addElement(button_decrease_rate, 1, 3, 1, 1);
+		textbox_sample_rate = new VRTextBox("textbox_sample_rate", "Sample rate: " + std::to_string((long long)filter_sample_rate) + " Hz");
+		menu7->addElement(textbox_sample_rate, 2, 3, 6, 1);
+		button_increase_rate = new VRButton("button_increase_rate", "+");
+		menu7->addElement(button_increase_rate, 8, 3, 1, 1);
+		textbox_filter = new VRTextBox("textbox_filter", "Raw data");
+		menu7->addElement(textbox_filter, 1, 4, 8, 1);
+
+		menu7->addMenuHandler(this);
+
+		menus.push_back(menu7);
 		displayMenu(-1);
 	}
 
-	void drawMenus()
+	//filters the bones on background threads with the settings of the filter page, a running
+	//filter is restarted. The bones are shown as before until they are all filtered. If the filter
+	//is off, the bones and particle trajectories are shown as read again
+	void applyFilter()
 	{
-		for (std::vector<VRMenu*>::const_iterator it = menus.begin(); it != menus.end(); ++it)
-			(*it)->draw();
+		VRTraceRecorder::Scope trace("applyFilter");
+		delete filterTask;
+		filterTask = NULL;
+		std::string status = "Raw data";
+		if (toggle_filter->isToggled())
+		{
+			XMAFilter next(filter_cutoff, filter_sample_rate);
+			if (next.isValid())
+			{
+				filterStart = std::chrono::steady_clock::now();
+				filterTask = new XMAFilterTask(objects, next);
+				filterTask->start();
+				filter_refresh = PROFILER_HUD_INTERVAL;
+				return;
+			}
+			toggle_filter->setToggled(false);
+			status = "Cutoff has to be below half the sample rate";
+		}
+
+		delete filter;
+		filter = NULL;
+		for (size_t i = 0; i < objects.size(); i++)
+			objects[i]->removeFilter();
+		updateFilteredData();
+		textbox_filter->setText(status);
 	}
 
-	void updateMenus()
+	//shows the progress of a running filter, and the bones and particle trajectories filtered
+	//with it once it is finished
+	void updateFilter()
 	{
-		for (std::vector<VRMenu*>::const_iterator it = menus.begin(); it != menus.end(); ++it)
-			(*it)->setTransformation(menupose);
+		if (!filterTask)
+			return;
+		if (!filterTask->isFinished())
+		{
+			if (++filter_refresh < PROFILER_HUD_INTERVAL)
+				return;
+			filter_refresh = 0;
+			textbox_filter->setText("Filtering: " + std::to_string((long long)(100 * filterTask->getProgress())) + "%");
+			return;
+		}
+
+		VRTraceRecorder::Scope trace("updateFilter");
+		delete filter;
+		filter = new XMAFilter(filterTask->getFilter());
+		filterTask->apply();
+		delete filterTask;
+		filterTask = NULL;
+		updateFilteredData();
+
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - filterStart).count();
+		textbox_filter->setText("Filtered " + std::to_string((long long)objects.size()) + " bones, " + std::to_string((long long)particles.size()) +
+			" particles in " + std::to_string((long long)ms) + " ms");
+	}
+
+	//particle trajectories and graphs computed with the current filter
+	void updateFilteredData()
+	{
+		updateParticles();
+		if (points[0] != -1 && points[1] != -1)
+			setDistanceData();
+		setAngleData();
+	}
+
+	//tests all frames for penetrating bones on background threads, a running check is restarted
+	void startCollisionCheck()
+	{
+		delete collisionCheck;
+		collisionCheck = new XMAInterpenetration(objects, max_Frame, GRAPHSKIPDVALUE);
+		collisionCheck->start();
+		collision_event = -1;
+		collision_refresh = PROFILER_HUD_INTERVAL;
+	}
+
+	//shows the progress of a running check and its results once it is finished
+	void updateCollisionCheck()
+	{
+		if (!collisionCheck || collision_event != -1)
+			return;
+		if (!collisionCheck->isFinished())
+		{
+			if (++collision_refresh < PROFILER_HUD_INTERVAL)
+				return;
+			collision_refresh = 0;
+			textbox_collision->setText("Checking: " + std::to_string((long long)(100 * collisionCheck->getProgress())) + "%");
+			return;
+		}
 
+		graph_collision->setData(collisionCheck->getSeries());
+		textbox_collision->setText(std::to_string((long long)collisionCheck->getEvents().size()) + " collisions in " +
+			std::to_string((long long)collisionCheck->getPenetratingFrames()) + " frames");
+		//no event is shown until the first jump
+		collision_event = (int)collisionCheck->getEvents().size();
+	}
 
+	//moves to the deepest frame of the previous or next collision
+	void jumpToCollision(int step)
+	{
+		if (!collisionCheck || !collisionCheck->isFinished() || collisionCheck->getEvents().empty())
+			return;
+
+		const std::vector<XMAInterpenetration::Event> &events = collisionCheck->getEvents();
+		int count = events.size();
+		if (collision_event == count)
+			collision_event = (step > 0) ? 0 : count - 1;
+		else
+			collision_event = (collision_event + step + count) % count;
+		const XMAInterpenetration::Event &event = events[collision_event];
+		frame = event.frame;
+		textbox_current_frame->setText("Frame: " + std::to_string((long long)frame + 1));
+		textbox_collision->setText("Frame " + std::to_string((long long)event.frame + 1) + ": " + objects[event.boneA]->getName() +
+			" / " + objects[event.boneB]->getName() + " " + std::to_string((long double)event.depth));
+	}
+
+	void updateMemoryPage()
+	{
+		if (!menuVisible || currentMenu != 4)
+			return;
+		if (++memory_refresh < PROFILER_HUD_INTERVAL)
+			return;
+
+		memory_refresh = 0;
+		textbox_memory->setText(VRMemoryTracker::getInstance()->getReport(getBoneMemory(MEMORY_PAGE_BONES)));
+	}
+
+	//memory of the bones, the largest first. A shared mesh is split between the bones using it
+	std::vector<VRMemoryTracker::Usage> getBoneMemory(int count)
+	{
+		std::vector<VRMemoryTracker::Usage> bones;
+		for (size_t i = 0; i < objects.size(); i++)
+		{
+			VRMemoryTracker::Usage usage = { objects[i]->getName(), objects[i]->getCPUBytes(), objects[i]->getGPUBytes() };
+			bones.push_back(usage);
+		}
+		std::stable_sort(bones.begin(), bones.end(), [](const VRMemoryTracker::Usage &a, const VRMemoryTracker::Usage &b)
+			{ return a.cpuBytes + a.gpuBytes > b.cpuBytes + b.gpuBytes; });
+		if (count > 0 && bones.size() > count)
+			bones.resize(count);
+		return bones;
+	}
+
+	//prints the categories and writes them with all bones to memory.csv next to the trial
+	void dumpMemory()
+	{
+		std::vector<std::string> report = VRMemoryTracker::getInstance()->getReport();
+		for (size_t i = 0; i < report.size(); i++)
+			std::cerr << report[i] << std::endl;
+
+		std::string csv = filename + "memory.csv";
+		if (VRMemoryTracker::getInstance()->dumpCSV(csv, getBoneMemory(0)))
+			std::cerr << "Memory written to " << csv << std::endl;
+		else
+			std::cerr << "Could not write " << csv << std::endl;
+	}
+
+	void updateProfilerPage()
+	{
+		if (!VRProfiler::getInstance()->isEnabled() || !menuVisible || currentMenu != 3)
+			return;
+		if (++profiler_refresh < PROFILER_HUD_INTERVAL)
+			return;
+
+		profiler_refresh = 0;
+		std::vector<std::string> report = VRProfiler::getInstance()->getReport();
+		report.push_back("Events/s: " + std::to_string((long long)(eventDispatcher.getEventsPerSecond() + replayDispatcher.getEventsPerSecond())));
+		//counts of the last frame over both eyes
+		const XMARenderer::Stats &stats = renderer.getStats();
+		report.push_back("Bones drawn/culled: " + std::to_string((long long)stats.objects) + "/" + std::to_string((long long)stats.culledObjects));
+		report.push_back("Particles drawn/culled: " + std::to_string((long long)stats.particles) + "/" + std::to_string((long long)stats.culledParticles));
+		report.push_back("Trails drawn/culled: " + std::to_string((long long)stats.trails) + "/" + std::to_string((long long)stats.culledTrails));
+		textbox_profiler->setText(report);
+	}
+
+	//pose events only mark the menus dirty, placement and ray intersection run once per frame
+	void flushMenus()
+	{
+		if (!menusDirty)
+			return;
+		menusDirty = false;
+		updateMenus();
+	}
+
+	void updateMenus()
+	{
 		VRPoint3 pos = controllerpose * VRPoint3(0, 0, 0);
 		VRVector3 dir = controllerpose * VRVector3(0, 0, -1);
 
 		double distance;
 		for (std::vector<VRMenu*>::const_iterator it = menus.begin(); it != menus.end(); ++it){
+			if (!(*it)->isVisible())
+				continue;
+			(*it)->setTransformation(menupose);
 			(*it)->intersect(pos, dir, distance);
 		}
 	}
@@ -1310,14 +1643,22 @@ public:
 protected:
 	int current_obj;
 	std::vector<XMAObject* > objects;
-	std::vector<particle> particles;
+	std::vector<XMAParticle> particles;
 	int points[4];
 	bool initialised;
 	string filename;
 	int hover_particle;
+	std::vector<float> hover_points;
 	int selected_particle;
 	GLfloat light_pos[4];
 	double objscale;
+	double weldEpsilon;
+
+	XMALoader * loader;		//NULL once all bones are loaded
+	std::chrono::steady_clock::time_point loadStart;
+	VRMenu * loadingMenu;
+	VRMultiLineTextBox * textbox_loading;
+	std::vector<VRMenu*> loadingMenus;
 
 	int max_Frame;
 	double frame;
@@ -1325,8 +1666,8 @@ protected:
 	double scale;
 	bool clicked;
 
-	unsigned int sphere;
 	double tool_dist;
+	XMARenderer renderer;
 
 	VRMatrix4 obj_rotation;
 	bool rotateObj;
@@ -1338,11 +1679,13 @@ protected:
 	VRMatrix4 controllerpose;
 	VRMatrix4 roompose;
 	VRMatrix4 headpose;
+	float focal_length;	//of the projection of the last eye drawn, for the detail levels of the next frame
 	double movement_x;
 	double movement_y;
 
 
 	bool menuVisible;
+	bool menusDirty;
 	std::vector<VRMenu*>		menus;
 	int currentMenu;
 
@@ -1384,6 +1727,53 @@ protected:
 	VRTextBox*	textbox_current_trail;
 	VRButton*	button_increase_trail;
 	VRButton*	button_decrease_trail;
+
+	VREventDispatcher<MyVRApp> eventDispatcher;	//live events
+	VREventDispatcher<MyVRApp, XMAInputEvent> replayDispatcher;	//copies of events, recorded or replayed
+	XMAInputLog inputLog;
+	int inputFrame;
+
+	VRToggle*	toggle_profiler;
+	VRButton*	button_dump_profile;
+	VRButton*	button_trace;
+	VRMultiLineTextBox*	textbox_profiler;
+	int profiler_refresh;
+
+	VRButton*	button_dump_memory;
+	VRMultiLineTextBox*	textbox_memory;
+	int memory_refresh;
+	int memory_particles;
+	long long particleBytes;
+
+	XMAInterpenetration * collisionCheck;	//NULL until a check is started
+	VRButton*	button_check_collisions;
+	VRButton*	button_prev_collision;
+	VRButton*	button_next_collision;
+	VRTextBox*	textbox_collision;
+	VRGraph*	graph_collision;
+	int collision_refresh;
+	int collision_event;	//event shown, -1 while the check runs and the number of events before the first jump
+
+	XMAFilter * filter;		//NULL while the data is shown as read
+	XMAFilterTask * filterTask;	//NULL unless the bones are being filtered
+	std::chrono::steady_clock::time_point filterStart;
+	int filter_refresh;
+	VRToggle*	toggle_filter;
+	VRButton*	button_decrease_cutoff;
+	VRButton*	button_increase_cutoff;
+	VRButton*	button_decrease_rate;
+	VRButton*	button_increase_rate;
+	VRTextBox*	textbox_cutoff;
+	VRTextBox*	textbox_sample_rate;
+	VRTextBox*	textbox_filter;
+	double filter_cutoff;
+	double filter_sample_rate;
+
+	int phase_events;
+	int phase_context;
+	int phase_playback;
+	int phase_hover;
+	int phase_render;
 };
 
 
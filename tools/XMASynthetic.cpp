@@ -0,0 +1,191 @@
+#include "XMASynthetic.h"
+#include <cstdio>
+#include <cmath>
+#include <vector>
+#include <random>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+bool XMASynthetic::writeSphereOBJ(const std::string &filename, int stacks, int slices, float radius, bool shareVertices)
+{
+	FILE * file = fopen(filename.c_str(), "w");
+	if (!file)
+		return false;
+
+	std::vector<float> vertices;
+	for (int i = 0; i <= stacks; i++)
+	{
+		double phi = M_PI * i / stacks;
+		for (int j = 0; j < slices; j++)
+		{
+			double theta = 2.0 * M_PI * j / slices;
+			vertices.push_back(radius * sin(phi) * cos(theta));
+			vertices.push_back(radius * cos(phi));
+			vertices.push_back(radius * sin(phi) * sin(theta));
+		}
+	}
+
+	//obj indices start at 1
+	std::vector<int> triangles;
+	for (int i = 0; i < stacks; i++)
+	{
+		for (int j = 0; j < slices; j++)
+		{
+			int a = i * slices + j + 1;
+			int b = i * slices + (j + 1) % slices + 1;
+			int c = (i + 1) * slices + j + 1;
+			int d = (i + 1) * slices + (j + 1) % slices + 1;
+			if (i > 0)
+			{
+				triangles.push_back(a);
+				triangles.push_back(c);
+				triangles.push_back(b);
+			}
+			if (i < stacks - 1)
+			{
+				triangles.push_back(b);
+				triangles.push_back(c);
+				triangles.push_back(d);
+			}
+		}
+	}
+
+	fprintf(file, "# synthetic sphere %d x %d\n", stacks, slices);
+	if (shareVertices)
+	{
+		for (size_t v = 0; v < vertices.size(); v += 3)
+			fprintf(file, "v %f %f %f\n", vertices[v], vertices[v + 1], vertices[v + 2]);
+		for (size_t t = 0; t < triangles.size(); t += 3)
+			fprintf(file, "f %d %d %d\n", triangles[t], triangles[t + 1], triangles[t + 2]);
+	}
+	else
+	{
+		for (size_t t = 0; t < triangles.size(); t++)
+		{
+			int v = 3 * (triangles[t] - 1);
+			fprintf(file, "v %f %f %f\n", vertices[v], vertices[v + 1], vertices[v + 2]);
+		}
+		for (size_t t = 0; t < triangles.size(); t += 3)
+			fprintf(file, "f %d %d %d\n", (int)t + 1, (int)t + 2, (int)t + 3);
+	}
+
+	fclose(file);
+	return true;
+}
+
+bool XMASynthetic::writeBoneOBJ(const std::string &filename, int triangles, float length, float radius)
+{
+	FILE * file = fopen(filename.c_str(), "w");
+	if (!file)
+		return false;
+
+	//2 * slices * stacks triangles, with about 4 times more rings than segments per ring
+	int slices = (int)(sqrt(triangles / 8.0) + 0.5);
+	if (slices < 6) slices = 6;
+	int stacks = triangles / (2 * slices) - 1;
+	if (stacks < 2) stacks = 2;
+
+	fprintf(file, "# synthetic bone, %d rings of %d vertices\n", stacks + 1, slices);
+	for (int i = 0; i <= stacks; i++)
+	{
+		//shaft radius with bulges at both ends, as for the epiphyses of a long bone
+		double t = (double)i / stacks;
+		double r = radius * (1.0 + 0.8 * exp(-pow((t - 0.05) / 0.12, 2)) + 0.6 * exp(-pow((t - 0.95) / 0.12, 2)));
+		for (int j = 0; j < slices; j++)
+		{
+			double theta = 2.0 * M_PI * j / slices;
+			//slightly flattened cross section
+			fprintf(file, "v %f %f %f\n", r * cos(theta), length * t, 0.8 * r * sin(theta));
+		}
+	}
+	int bottom = (stacks + 1) * slices + 1;
+	int top = bottom + 1;
+	fprintf(file, "v %f %f %f\n", 0.0, -0.3 * radius, 0.0);
+	fprintf(file, "v %f %f %f\n", 0.0, length + 0.3 * radius, 0.0);
+
+	for (int i = 0; i < stacks; i++)
+	{
+		for (int j = 0; j < slices; j++)
+		{
+			int a = i * slices + j + 1;
+			int b = i * slices + (j + 1) % slices + 1;
+			fprintf(file, "f %d %d %d\n", a, a + slices, b);
+			fprintf(file, "f %d %d %d\n", b, a + slices, b + slices);
+		}
+	}
+	for (int j = 0; j < slices; j++)
+	{
+		fprintf(file, "f %d %d %d\n", bottom, j + 1, (j + 1) % slices + 1);
+		fprintf(file, "f %d %d %d\n", top, stacks * slices + (j + 1) % slices + 1, stacks * slices + j + 1);
+	}
+
+	fclose(file);
+	return true;
+}
+
+bool XMASynthetic::writeTransformCSV(const std::string &filename, int frames, unsigned int seed, const float * offset,
+	double gapsPer1000, int gapLength)
+{
+	FILE * file = fopen(filename.c_str(), "w");
+	if (!file)
+		return false;
+
+	std::vector<char> buffer(1 << 20);
+	setvbuf(file, &buffer[0], _IOFBF, buffer.size());
+
+	//every rotation angle and translation is a sum of sinusoids with random frequency, amplitude and phase
+	std::mt19937 random(seed);
+	std::uniform_real_distribution<double> uniform(0.0, 1.0);
+	double frequency[6][3], amplitude[6][3], phase[6][3];
+	for (int k = 0; k < 6; k++)
+	{
+		for (int s = 0; s < 3; s++)
+		{
+			frequency[k][s] = 2.0 * M_PI * (0.0005 + 0.01 * uniform(random));
+			amplitude[k][s] = (k < 3) ? 0.6 * uniform(random) : 20.0 * uniform(random);
+			phase[k][s] = 2.0 * M_PI * uniform(random);
+		}
+	}
+
+	fprintf(file, "m00,m10,m20,m30,m01,m11,m21,m31,m02,m12,m22,m32,m03,m13,m23,m33\n");
+
+	int gapRemaining = 0;
+	for (int f = 0; f < frames; f++)
+	{
+		if (gapRemaining == 0 && gapsPer1000 > 0 && gapLength > 0 && uniform(random) < gapsPer1000 / 1000.0)
+			gapRemaining = 1 + (int)(uniform(random) * 2 * gapLength);
+		if (gapRemaining > 0)
+		{
+			gapRemaining--;
+			fprintf(file, "NaN,NaN,NaN,NaN,NaN,NaN,NaN,NaN,NaN,NaN,NaN,NaN,NaN,NaN,NaN,NaN\n");
+			continue;
+		}
+
+		double v[6];
+		for (int k = 0; k < 6; k++)
+		{
+			v[k] = 0;
+			for (int s = 0; s < 3; s++)
+				v[k] += amplitude[k][s] * sin(frequency[k][s] * f + phase[k][s]);
+		}
+
+		//R = Rz * Ry * Rx
+		double cx = cos(v[0]), sx = sin(v[0]);
+		double cy = cos(v[1]), sy = sin(v[1]);
+		double cz = cos(v[2]), sz = sin(v[2]);
+		double m[16] = {
+			cz * cy, sz * cy, -sy, 0,
+			cz * sy * sx - sz * cx, sz * sy * sx + cz * cx, cy * sx, 0,
+			cz * sy * cx + sz * sx, sz * sy * cx - cz * sx, cy * cx, 0,
+			offset[0] + v[3], offset[1] + v[4], offset[2] + v[5], 1
+		};
+
+		for (int i = 0; i < 16; i++)
+			fprintf(file, (i < 15) ? "%.9g," : "%.9g\n", m[i]);
+	}
+
+	fclose(file);
+	return true;
+}
@@ -0,0 +1,24 @@
+#ifndef XMASYNTHETIC_H
+#define XMASYNTHETIC_H
+
+#include <string>
+
+// Writers for synthetic XROMM inputs used by the tools.
+namespace XMASynthetic
+{
+	//uv sphere of the given radius. If shareVertices is false every triangle gets its own
+	//three vertices, as in meshes exported without welding
+	bool writeSphereOBJ(const std::string &filename, int stacks, int slices, float radius, bool shareVertices);
+
+	//long bone along the y axis: a shaft with thickened ends, closed by caps. The tessellation is
+	//chosen to get close to the requested number of triangles
+	bool writeBoneOBJ(const std::string &filename, int triangles, float length, float radius);
+
+	//transformation csv with a header line and one column major 4x4 matrix per line. The bone moves
+	//with a smooth random rigid motion around offset. On average gapsPer1000 gaps per 1000 frames of
+	//about gapLength frames are written as NaN lines. The same seed gives the same file
+	bool writeTransformCSV(const std::string &filename, int frames, unsigned int seed, const float * offset,
+		double gapsPer1000 = 0.0, int gapLength = 0);
+}
+
+#endif //XMASYNTHETIC_H
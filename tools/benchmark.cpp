@@ -0,0 +1,426 @@
+// Benchmarks of the loading and analysis code paths. Runs without MinVR and without a display.
+//
+// usage: XROMM-benchmark [-o results.json] [-obj mesh.obj] [-csv transformation.csv]
+// Synthetic inputs are always measured, -obj and -csv add measurements on real data.
+// Results are written as JSON to stdout or the file given with -o.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <chrono>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+
+#include "glm.h"
+#include "XMATransformTrack.h"
+#include "XMAAnalysis.h"
+#include "XMABVH.h"
+#include "XMAFilter.h"
+#include "XMASynthetic.h"
+
+//every case runs at least BENCH_MIN_ITERATIONS times and until BENCH_MIN_SECONDS passed
+#define BENCH_MIN_ITERATIONS 5
+#define BENCH_MAX_ITERATIONS 1000
+#define BENCH_MIN_SECONDS 1.0
+
+#define SYNTHETIC_OBJ "benchmark_sphere.obj"
+#define SYNTHETIC_OBJ_UNWELDED "benchmark_sphere_unwelded.obj"
+#define SYNTHETIC_OBJ_UNWELDED_LARGE "benchmark_sphere_unwelded_large.obj"
+#define SYNTHETIC_OBJ_LARGE "benchmark_sphere_large.obj"
+#define SYNTHETIC_CSV "benchmark_transformation.csv"
+#define SYNTHETIC_FRAMES 20000
+#define SYNTHETIC_PARTICLES 32
+#define SKIP_VALUE -9999999999
+
+struct Result
+{
+	std::string name;
+	std::string input;
+	int iterations;
+	double min, median, mean;	//ms
+};
+
+static std::vector<Result> results;
+
+//times run(), setup() is called before every iteration and is not timed
+static void measure(const std::string &name, const std::string &input, std::function<void()> setup, std::function<void()> run)
+{
+	typedef std::chrono::steady_clock Clock;
+	std::vector<double> times;
+	double total = 0;
+	while (times.size() < BENCH_MIN_ITERATIONS || (total < BENCH_MIN_SECONDS * 1000.0 && times.size() < BENCH_MAX_ITERATIONS))
+	{
+		if (setup)
+			setup();
+		Clock::time_point start = Clock::now();
+		run();
+		double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+		times.push_back(ms);
+		total += ms;
+	}
+
+	std::sort(times.begin(), times.end());
+	Result r;
+	r.name = name;
+	r.input = input;
+	r.iterations = times.size();
+	r.min = times.front();
+	r.median = times[times.size() / 2];
+	r.mean = total / times.size();
+	results.push_back(r);
+
+	std::cerr << name << " (" << input << "): " << r.median << " ms" << std::endl;
+}
+
+//the per vertex and per triangle kernels, glmUnitize leaves the model unchanged after its first call
+static void benchmarkKernels(GLMmodel * model, const std::string &input)
+{
+	GLfloat dimensions[3];
+	measure("glmDimensions", input, nullptr, [&](){ glmDimensions(model, dimensions); });
+	measure("glmScale", input, nullptr, [&](){ glmScale(model, 1.0f); });
+	measure("glmUnitize", input, nullptr, [&](){ glmUnitize(model); });
+	measure("glmFacetNormals", input, nullptr, [&](){ glmFacetNormals(model); });
+}
+
+static void benchmarkOBJ(const std::string &filename, const std::string &input)
+{
+	GLMmodel * model = NULL;
+
+	measure("glmReadOBJ", input, [&](){ if (model) glmDelete(model); model = NULL; },
+		[&](){ model = glmReadOBJ((char*)filename.c_str()); });
+
+	benchmarkKernels(model, input);
+	measure("glmVertexNormals", input, nullptr, [&](){ glmVertexNormals(model, 90.0); });
+
+	GLMmodel * simplified = NULL;
+	measure("glmSimplify", input, [&](){ if (simplified) glmDelete(simplified); simplified = NULL; },
+		[&](){ simplified = glmSimplify(model, model->numtriangles / 4); });
+	glmDelete(simplified);
+
+	glmDelete(model);
+	model = NULL;
+}
+
+static void benchmarkLargeOBJ(const std::string &filename, const std::string &input)
+{
+	GLMmodel * model = glmReadOBJ((char*)filename.c_str());
+	benchmarkKernels(model, input);
+	glmDelete(model);
+}
+
+static void benchmarkWeld(const std::string &filename, const std::string &input)
+{
+	GLMmodel * model = NULL;
+	measure("glmWeld", input, [&](){
+		if (model) glmDelete(model);
+		model = glmReadOBJ((char*)filename.c_str());
+	}, [&](){ glmWeld(model, 0.00001); });
+	glmDelete(model);
+}
+
+//the hierarchy of a mesh and the test of the mesh against itself in poses from penetrating to apart,
+//as the interpenetration check runs it for every pair of adjacent bones and frame
+static void benchmarkBVH(const std::string &filename, const std::string &input)
+{
+	GLMmodel * model = glmReadOBJ((char*)filename.c_str());
+	std::vector<float> triangles(9 * model->numtriangles);
+	for (GLuint t = 0; t < model->numtriangles; t++)
+	{
+		for (int v = 0; v < 3; v++)
+		{
+			for (int k = 0; k < 3; k++)
+				triangles[9 * t + 3 * v + k] = model->vertices[3 * model->triangles[t].vindices[v] + k];
+		}
+	}
+	float dimensions[3];
+	glmDimensions(model, dimensions);
+	glmDelete(model);
+
+	XMABVH * bvh = NULL;
+	measure("bvh build", input, [&](){ delete bvh; bvh = NULL; },
+		[&](){ bvh = new XMABVH(&triangles[0], triangles.size() / 9); });
+
+	int poses = 100;
+	int found = 0;
+	measure("bvh pair test", input + ", 100 poses", nullptr, [&](){
+		for (int p = 0; p < poses; p++)
+		{
+			float angle = 0.01f * p;
+			float offset = dimensions[0] * (0.5f + p / (float)poses);
+			float pose[16] = { cosf(angle), sinf(angle), 0, 0, -sinf(angle), cosf(angle), 0, 0, 0, 0, 1, 0, offset, 0, 0, 1 };
+			float depth;
+			if (bvh->intersect(*bvh, pose, &depth))
+				found++;
+		}
+	});
+	delete bvh;
+}
+
+static void benchmarkTrack(const std::string &filename, const std::string &input)
+{
+	float m[16];
+	measure("XMATransformTrack index", input, nullptr, [&](){
+		XMATransformTrack track(filename);
+		track.waitForIndex();
+	});
+
+	measure("XMATransformTrack parse", input, nullptr, [&](){
+		XMATransformTrack track(filename);
+		track.waitForIndex();
+		for (int i = 0; i < track.size(); i++)
+			track.getTransformation(i, m);
+	});
+
+	XMATransformTrack track(filename);
+	track.waitForIndex();
+	measure("XMATransformTrack playback", input, nullptr, [&](){
+		for (int i = 0; i < track.size(); i++)
+		{
+			track.setPlayhead(i);
+			track.getTransformation(i, m);
+		}
+	});
+
+	std::vector<float> matrices(16 * track.size());
+	std::vector<unsigned char> visible(track.size());
+	measure("XMATransformTrack read range", input, nullptr, [&](){
+		track.readRange(0, track.size(), &matrices[0], &visible[0]);
+	});
+}
+
+static void benchmarkAnalysis(const std::string &filename, const std::string &input)
+{
+	XMATransformTrack track(filename);
+	XMATransformTrack fixedTrack(filename);
+	track.waitForIndex();
+	fixedTrack.waitForIndex();
+	int frames = track.size();
+
+	std::vector<std::vector<float> > positions(SYNTHETIC_PARTICLES, std::vector<float>(3 * frames));
+	std::vector<std::vector<unsigned char> > visible(SYNTHETIC_PARTICLES, std::vector<unsigned char>(frames));
+	float fixPose[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+
+	std::ostringstream particlesInput;
+	particlesInput << input << ", " << SYNTHETIC_PARTICLES << " particles";
+
+	measure("trajectory", particlesInput.str(), nullptr, [&](){
+		for (int p = 0; p < SYNTHETIC_PARTICLES; p++)
+		{
+			float position[3] = { (float)p, 1.0f, -1.0f };
+			XMAAnalysis::computeTrajectory(position, &track, NULL, fixPose, frames, &positions[p][0], &visible[p][0]);
+		}
+	});
+
+	measure("trajectory fixed object", particlesInput.str(), nullptr, [&](){
+		for (int p = 0; p < SYNTHETIC_PARTICLES; p++)
+		{
+			float position[3] = { (float)p, 1.0f, -1.0f };
+			XMAAnalysis::computeTrajectory(position, &track, &fixedTrack, fixPose, frames, &positions[p][0], &visible[p][0]);
+		}
+	});
+
+	//all particles on the one bone, as the application computes them
+	std::vector<float> points;
+	std::vector<float *> positionPointers;
+	std::vector<unsigned char *> visiblePointers;
+	for (int p = 0; p < SYNTHETIC_PARTICLES; p++)
+	{
+		points.push_back((float)p);
+		points.push_back(1.0f);
+		points.push_back(-1.0f);
+		positionPointers.push_back(&positions[p][0]);
+		visiblePointers.push_back(&visible[p][0]);
+	}
+	measure("trajectories per bone", particlesInput.str(), nullptr, [&](){
+		XMAAnalysis::computeTrajectories(&points[0], SYNTHETIC_PARTICLES, &track, NULL, fixPose, frames, &positionPointers[0], &visiblePointers[0]);
+	});
+	measure("trajectories per bone fixed object", particlesInput.str(), nullptr, [&](){
+		XMAAnalysis::computeTrajectories(&points[0], SYNTHETIC_PARTICLES, &track, &fixedTrack, fixPose, frames, &positionPointers[0], &visiblePointers[0]);
+	});
+
+	std::vector<double> series;
+	measure("distance series", input, nullptr, [&](){
+		XMAAnalysis::distanceSeries(&positions[0][0], &visible[0][0], &positions[1][0], &visible[1][0], frames, SKIP_VALUE, series);
+	});
+	measure("angle series", input, nullptr, [&](){
+		XMAAnalysis::angleSeries(&positions[0][0], &visible[0][0], &positions[1][0], &visible[1][0],
+			&positions[2][0], &visible[2][0], &positions[3][0], &visible[3][0], frames, SKIP_VALUE, series);
+	});
+
+	//full trails of all particles onto a tilted controller plane, as in the projection mode
+	std::vector<float> trails;
+	for (int p = 0; p < SYNTHETIC_PARTICLES; p++)
+		trails.insert(trails.end(), positions[p].begin(), positions[p].end());
+	std::vector<float> projected(trails.size());
+	float controller[16] = { 1, 0, 0, 0, 0, 0.8f, 0.6f, 0, 0, -0.6f, 0.8f, 0, 0.2f, 1.0f, -0.5f, 1 };
+	float toPlane[16];
+	XMAAnalysis::invert(controller, toPlane);
+	float min[2], max[2];
+	measure("plane projection", particlesInput.str(), nullptr, [&](){
+		XMAAnalysis::projectToPlane(toPlane, controller, &trails[0], trails.size() / 3, &projected[0], min, max);
+	});
+}
+
+//the low-pass filter over a whole track and over the trajectories of the particles, as the
+//filter page runs it for every change of the cutoff
+static void benchmarkFilter(const std::string &filename, const std::string &input)
+{
+	XMATransformTrack track(filename);
+	track.waitForIndex();
+	int frames = track.size();
+	std::vector<float> matrices(16 * frames);
+	std::vector<unsigned char> visible(frames);
+	track.readRange(0, frames, &matrices[0], &visible[0]);
+
+	XMAFilter filter(15.0, 250.0);
+	std::vector<float> filtered;
+	measure("filter transforms", input, [&](){ filtered = matrices; },
+		[&](){ filter.filterTransforms(&filtered[0], &visible[0], frames); });
+
+	std::vector<std::vector<float> > positions(SYNTHETIC_PARTICLES, std::vector<float>(3 * frames));
+	std::vector<std::vector<unsigned char> > particleVisible(SYNTHETIC_PARTICLES, std::vector<unsigned char>(frames));
+	float fixPose[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+	for (int p = 0; p < SYNTHETIC_PARTICLES; p++)
+	{
+		float position[3] = { (float)p, 1.0f, -1.0f };
+		XMAAnalysis::computeTrajectory(position, &track, NULL, fixPose, frames, &positions[p][0], &particleVisible[p][0]);
+	}
+	std::vector<std::vector<float> > trajectories;
+	std::vector<float *> pointers(SYNTHETIC_PARTICLES);
+	std::vector<const unsigned char *> visiblePointers(SYNTHETIC_PARTICLES);
+	for (int p = 0; p < SYNTHETIC_PARTICLES; p++)
+		visiblePointers[p] = &particleVisible[p][0];
+
+	std::ostringstream particlesInput;
+	particlesInput << input << ", " << SYNTHETIC_PARTICLES << " particles";
+	measure("filter trajectories", particlesInput.str(), [&](){
+		trajectories = positions;
+		for (int p = 0; p < SYNTHETIC_PARTICLES; p++)
+			pointers[p] = &trajectories[p][0];
+	}, [&](){ filter.filterTrajectories(&pointers[0], &visiblePointers[0], SYNTHETIC_PARTICLES, frames); });
+}
+
+static void benchmarkHover()
+{
+	//one hover query per frame of a playback over many particles
+	int count = 10000;
+	int queries = 1000;
+	std::vector<float> points(3 * count);
+	srand(1);
+	for (int i = 0; i < 3 * count; i++)
+		points[i] = (rand() / (float)RAND_MAX) * 100.0f - 50.0f;
+
+	int found = 0;
+	measure("hover search", "10000 particles, 1000 queries", nullptr, [&](){
+		for (int q = 0; q < queries; q++)
+		{
+			float target[3] = { (float)(q % 100) - 50.0f, 0.0f, 0.0f };
+			if (XMAAnalysis::findNearest(&points[0], count, target, 5.0f) >= 0)
+				found++;
+		}
+	});
+}
+
+static std::string escape(const std::string &text)
+{
+	std::string out;
+	for (size_t i = 0; i < text.size(); i++)
+	{
+		if (text[i] == '"' || text[i] == '\\')
+			out += '\\';
+		out += text[i];
+	}
+	return out;
+}
+
+static void writeJSON(std::ostream &out)
+{
+	out << "{" << std::endl;
+#ifdef NDEBUG
+	out << "  \"build\": \"release\"," << std::endl;
+#else
+	out << "  \"build\": \"debug\"," << std::endl;
+#endif
+	out << "  \"results\": [" << std::endl;
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const Result &r = results[i];
+		out << "    {\"name\": \"" << escape(r.name) << "\", \"input\": \"" << escape(r.input) << "\", \"iterations\": " << r.iterations
+			<< ", \"min_ms\": " << r.min << ", \"median_ms\": " << r.median << ", \"mean_ms\": " << r.mean << "}"
+			<< ((i + 1 < results.size()) ? "," : "") << std::endl;
+	}
+	out << "  ]" << std::endl << "}" << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+	std::string output, objFile, csvFile;
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "-o") && i + 1 < argc) output = argv[++i];
+		else if (!strcmp(argv[i], "-obj") && i + 1 < argc) objFile = argv[++i];
+		else if (!strcmp(argv[i], "-csv") && i + 1 < argc) csvFile = argv[++i];
+		else
+		{
+			std::cerr << "usage: " << argv[0] << " [-o results.json] [-obj mesh.obj] [-csv transformation.csv]" << std::endl;
+			return 1;
+		}
+	}
+
+	float origin[3] = { 0, 0, 0 };
+	if (!XMASynthetic::writeSphereOBJ(SYNTHETIC_OBJ, 256, 256, 1.0f, true) ||
+		!XMASynthetic::writeSphereOBJ(SYNTHETIC_OBJ_UNWELDED, 48, 48, 1.0f, false) ||
+		!XMASynthetic::writeSphereOBJ(SYNTHETIC_OBJ_UNWELDED_LARGE, 256, 256, 1.0f, false) ||
+		!XMASynthetic::writeSphereOBJ(SYNTHETIC_OBJ_LARGE, 768, 768, 1.0f, true) ||
+		!XMASynthetic::writeTransformCSV(SYNTHETIC_CSV, SYNTHETIC_FRAMES, 1, origin, 2.0, 10))
+	{
+		std::cerr << "Could not write the synthetic inputs" << std::endl;
+		return 1;
+	}
+
+	benchmarkOBJ(SYNTHETIC_OBJ, "synthetic sphere 256x256");
+	benchmarkLargeOBJ(SYNTHETIC_OBJ_LARGE, "synthetic sphere 768x768");
+	benchmarkWeld(SYNTHETIC_OBJ_UNWELDED, "synthetic unwelded sphere 48x48");
+	benchmarkWeld(SYNTHETIC_OBJ_UNWELDED_LARGE, "synthetic unwelded sphere 256x256");
+	benchmarkBVH(SYNTHETIC_OBJ, "synthetic sphere 256x256");
+	benchmarkTrack(SYNTHETIC_CSV, "synthetic 20000 frames");
+	benchmarkAnalysis(SYNTHETIC_CSV, "synthetic 20000 frames");
+	benchmarkFilter(SYNTHETIC_CSV, "synthetic 20000 frames");
+	benchmarkHover();
+
+	if (!objFile.empty())
+	{
+		benchmarkOBJ(objFile, objFile);
+		benchmarkWeld(objFile, objFile);
+		benchmarkBVH(objFile, objFile);
+	}
+	if (!csvFile.empty())
+	{
+		benchmarkTrack(csvFile, csvFile);
+		benchmarkAnalysis(csvFile, csvFile);
+		benchmarkFilter(csvFile, csvFile);
+	}
+
+	remove(SYNTHETIC_OBJ);
+	remove(SYNTHETIC_OBJ_UNWELDED);
+	remove(SYNTHETIC_OBJ_UNWELDED_LARGE);
+	remove(SYNTHETIC_OBJ_LARGE);
+	remove(SYNTHETIC_CSV);
+
+	if (output.empty())
+	{
+		writeJSON(std::cout);
+	}
+	else
+	{
+		std::ofstream out(output.c_str());
+		writeJSON(out);
+	}
+	return 0;
+}
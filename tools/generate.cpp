@@ -0,0 +1,114 @@
+// Writes a synthetic trial which can be opened like a recorded one: a Data.csv listing
+// one mesh and one transformation file per bone, the bone meshes as OBJ and the
+// transformations as csv with one column major 4x4 matrix per frame.
+//
+// usage: XROMM-generate <directory> [-bones N] [-frames M] [-triangles T] [-gaps G] [-gaplength L] [-seed S] [-binary]
+//   -bones      number of bones (default 10)
+//   -frames     number of frames (default 10000)
+//   -triangles  triangles per bone mesh (default 20000)
+//   -gaps       average number of tracking gaps per 1000 frames (default 1)
+//   -gaplength  average length of a gap in frames (default 20)
+//   -seed       seed of the random motion (default 1)
+//   -binary     lists a binary track per bone in Data.csv, written by the viewer when it first loads the trial
+// The directory has to exist. Existing files are overwritten.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <iostream>
+
+#include "XMASynthetic.h"
+
+#ifdef _MSC_VER
+#define slash "\\"
+#else
+#define slash "/"
+#endif
+
+static void usage(const char * name)
+{
+	std::cerr << "usage: " << name << " <directory> [-bones N] [-frames M] [-triangles T] [-gaps G] [-gaplength L] [-seed S] [-binary]" << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc < 2)
+	{
+		usage(argv[0]);
+		return 1;
+	}
+
+	std::string directory = argv[1];
+	int bones = 10;
+	int frames = 10000;
+	int triangles = 20000;
+	double gaps = 1.0;
+	int gapLength = 20;
+	unsigned int seed = 1;
+	bool binary = false;
+
+	for (int i = 2; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "-binary"))
+		{
+			binary = true;
+			continue;
+		}
+		if (i + 1 >= argc)
+		{
+			usage(argv[0]);
+			return 1;
+		}
+		if (!strcmp(argv[i], "-bones")) bones = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-frames")) frames = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-triangles")) triangles = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-gaps")) gaps = atof(argv[++i]);
+		else if (!strcmp(argv[i], "-gaplength")) gapLength = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-seed")) seed = atoi(argv[++i]);
+		else
+		{
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	std::string dataFile = directory + slash + "Data.csv";
+	FILE * data = fopen(dataFile.c_str(), "w");
+	if (!data)
+	{
+		std::cerr << "Could not write " << dataFile << std::endl;
+		return 1;
+	}
+	if (binary)
+		fprintf(data, "obj,transformation,binary\n");
+
+	for (int b = 0; b < bones; b++)
+	{
+		char name[64];
+		sprintf(name, "bone%03d", b);
+		std::string obj = std::string(name) + ".obj";
+		std::string csv = std::string(name) + "_transformation.csv";
+
+		//bones of different length placed side by side
+		float length = 80.0f + 40.0f * ((b * 7) % 5);
+		float radius = 6.0f + (b % 3);
+		float offset[3] = { 40.0f * (b - bones * 0.5f), 0.0f, 0.0f };
+
+		if (!XMASynthetic::writeBoneOBJ(directory + slash + obj, triangles, length, radius) ||
+			!XMASynthetic::writeTransformCSV(directory + slash + csv, frames, seed + b, offset, gaps, gapLength))
+		{
+			std::cerr << "Could not write " << name << std::endl;
+			fclose(data);
+			return 1;
+		}
+		if (binary)
+			fprintf(data, "%s,%s,%s_transformation.trk\n", obj.c_str(), csv.c_str(), name);
+		else
+			fprintf(data, "%s,%s\n", obj.c_str(), csv.c_str());
+		std::cerr << "Wrote " << name << std::endl;
+	}
+
+	fclose(data);
+	return 0;
+}
@@ -0,0 +1,572 @@
+// Headless benchmark of the render path. Creates an offscreen OpenGL context through EGL without
+// a window (Mesa's llvmpipe on machines without a GPU), loads a trial and draws it with the same
+// XMARenderer the application uses while a scripted camera orbits the scene in stereo.
+// Reports the CPU time spent submitting each frame, the time until the frame finished and the
+// number of draw calls and of bones, particles and trails culled against the frustum of each eye,
+// and the memory held per category of the VRMemoryTracker after the run.
+//
+// usage: XROMM-renderbench [<directory>] [-frames N] [-width W] [-height H] [-particles P]
+//                          [-trail T] [-scale S] [-distance D] [-transparent] [-project] [-nomenus] [-nolod]
+//                          [-o results.json]
+//   <directory>   trial with a Data.csv as read by XROMM-VR. Without one a synthetic trial is
+//                 generated into renderbench_trial and reused by later runs
+//   -frames       number of rendered frames (default 600)
+//   -width/height size of each eye (default 1080x1200, as on the Vive)
+//   -particles    particles placed on every bone (default 4)
+//   -trail        particle trail length in frames, -1 draws full trails (default 100)
+//   -scale        scale of the scene (default 0.0328, as in XROMM-VR)
+//   -distance     distance of the camera from the center of the scene in scene radii (default 1.5)
+//   -transparent  draws the bones transparent
+//   -project      projects the particles and trails onto the controller plane
+//   -nomenus      does not draw the menu
+//   -nolod        draws the bones at full detail regardless of their size on screen
+// The sphere for particles is read from sphere.obj in the working directory if it exists.
+
+#include <GL/glew.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <fstream>
+#include <sys/stat.h>
+
+#include "XMAObject.h"
+#include "XMALoader.h"
+#include "XMARenderer.h"
+#include "XMAAnalysis.h"
+#include "XMATransformTrack.h"
+#include "XMASynthetic.h"
+#include "VRMenu.h"
+#include "VRGraph.h"
+#include "VRTextBox.h"
+#include "VRToggle.h"
+#include "VRProfiler.h"
+#include "VRMemoryTracker.h"
+
+using namespace MinVR;
+
+#define SYNTHETIC_TRIAL "renderbench_trial"
+#define SYNTHETIC_SPHERE "renderbench_sphere.obj"
+#define SYNTHETIC_BONES 10
+#define SYNTHETIC_FRAMES 2000
+#define SYNTHETIC_TRIANGLES 20000
+//distance between the eyes in scene units
+#define EYE_SEPARATION 0.064
+//degrees the camera orbits per rendered frame
+#define ORBIT_STEP 0.5
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+struct FrameTimes
+{
+	std::vector<double> submit;	//ms of cpu time in the render calls of both eyes
+	std::vector<double> total;	//ms including playback, menu update and glFinish
+	std::vector<int> drawCalls;
+	std::vector<int> vertices;
+	std::vector<int> culled;	//bones, particles and trails outside of the frustum of an eye
+};
+
+static bool createContext()
+{
+	//surfaceless Mesa platform if available, otherwise the default display
+	EGLDisplay display = EGL_NO_DISPLAY;
+	PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+#ifdef EGL_PLATFORM_SURFACELESS_MESA
+	if (getPlatformDisplay)
+		display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+#endif
+	if (display == EGL_NO_DISPLAY)
+		display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+	EGLint major, minor;
+	if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor))
+	{
+		std::cerr << "Could not initialise EGL" << std::endl;
+		return false;
+	}
+
+	//legacy OpenGL, not ES, as the display lists and immediate mode need it
+	if (!eglBindAPI(EGL_OPENGL_API))
+	{
+		std::cerr << "EGL does not support desktop OpenGL" << std::endl;
+		return false;
+	}
+
+	EGLint attributes[] = { EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+	EGLConfig config = NULL;
+	EGLint count = 0;
+	eglChooseConfig(display, attributes, &config, 1, &count);
+
+	//we only render into framebuffer objects, so no surface is needed
+	EGLContext context = eglCreateContext(display, count ? config : NULL, EGL_NO_CONTEXT, NULL);
+	if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context))
+	{
+		std::cerr << "Could not create a surfaceless OpenGL context" << std::endl;
+		return false;
+	}
+
+	//glew loads the core and extension functions before it looks for a GLX display, which
+	//does not exist for an EGL context
+	GLenum err = glewInit();
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+	if (err == GLEW_ERROR_NO_GLX_DISPLAY)
+		err = GLEW_OK;
+#endif
+	if (err != GLEW_OK)
+	{
+		std::cerr << "Could not initialise GLEW: " << glewGetErrorString(err) << std::endl;
+		return false;
+	}
+
+	std::cerr << "Renderer: " << glGetString(GL_RENDERER) << " " << glGetString(GL_VERSION) << std::endl;
+	return true;
+}
+
+//framebuffer object with the size of one eye
+static bool createFramebuffer(int width, int height)
+{
+	GLuint fbo, color, depth;
+	glGenFramebuffers(1, &fbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+
+	glGenRenderbuffers(1, &color);
+	glBindRenderbuffer(GL_RENDERBUFFER, color);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+
+	glGenRenderbuffers(1, &depth);
+	glBindRenderbuffer(GL_RENDERBUFFER, depth);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cerr << "Framebuffer incomplete" << std::endl;
+		return false;
+	}
+	glViewport(0, 0, width, height);
+	return true;
+}
+
+static bool fileExists(const std::string &filename)
+{
+	FILE * file = fopen(filename.c_str(), "r");
+	if (!file)
+		return false;
+	fclose(file);
+	return true;
+}
+
+static bool writeSyntheticTrial(const std::string &directory)
+{
+	mkdir(directory.c_str(), 0755);
+	FILE * data = fopen((directory + "/Data.csv").c_str(), "w");
+	if (!data)
+		return false;
+
+	for (int b = 0; b < SYNTHETIC_BONES; b++)
+	{
+		char name[64];
+		sprintf(name, "bone%03d", b);
+		std::string obj = std::string(name) + ".obj";
+		std::string csv = std::string(name) + "_transformation.csv";
+		float offset[3] = { 40.0f * (b - SYNTHETIC_BONES * 0.5f), 0.0f, 0.0f };
+		if (!XMASynthetic::writeBoneOBJ(directory + "/" + obj, SYNTHETIC_TRIANGLES, 80.0f + 40.0f * ((b * 7) % 5), 6.0f + (b % 3)) ||
+			!XMASynthetic::writeTransformCSV(directory + "/" + csv, SYNTHETIC_FRAMES, b + 1, offset, 1.0, 20))
+		{
+			fclose(data);
+			return false;
+		}
+		fprintf(data, "%s,%s\n", obj.c_str(), csv.c_str());
+	}
+	fclose(data);
+	return true;
+}
+
+//loads the trial with the loader of XROMM-VR and uploads all display lists
+static bool loadTrial(const std::string &directory, std::vector<XMAObject*> &objects)
+{
+	typedef std::chrono::steady_clock Clock;
+	Clock::time_point start = Clock::now();
+	XMALoader loader(directory + "/");
+	if (!loader.start())
+		return false;
+	loader.wait();
+	loader.takeLoaded(objects);
+	for (size_t i = 0; i < objects.size(); i++)
+		objects[i]->getTrack()->waitForIndex();
+	double loaded = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	for (size_t i = 0; i < objects.size(); i++)
+	{
+		while (objects[i]->upload());
+	}
+	std::cerr << "Loaded " << objects.size() << " bones in " << loaded << " ms, uploaded in "
+		<< std::chrono::duration<double, std::milli>(Clock::now() - start).count() - loaded << " ms" << std::endl;
+	return !objects.empty();
+}
+
+//column major view matrix looking from eye at center, y up
+static void lookAt(const VRPoint3 &eye, const VRPoint3 &center, float * m)
+{
+	VRVector3 f = (center - eye).normalize();
+	VRVector3 s = f.cross(VRVector3(0, 1, 0)).normalize();
+	VRVector3 u = s.cross(f);
+	float view[16] = {
+		s.x, u.x, -f.x, 0,
+		s.y, u.y, -f.y, 0,
+		s.z, u.z, -f.z, 0,
+		-(s.x * eye.x + s.y * eye.y + s.z * eye.z), -(u.x * eye.x + u.y * eye.y + u.z * eye.z), f.x * eye.x + f.y * eye.y + f.z * eye.z, 1
+	};
+	memcpy(m, view, sizeof(view));
+}
+
+//column major perspective projection as set up by glFrustum
+static void frustum(double fovy, double aspect, double zNear, double zFar, float * m)
+{
+	double top = zNear * tan(fovy * M_PI / 360.0);
+	double right = top * aspect;
+	float projection[16] = {
+		(float)(zNear / right), 0, 0, 0,
+		0, (float)(zNear / top), 0, 0,
+		0, 0, (float)(-(zFar + zNear) / (zFar - zNear)), -1,
+		0, 0, (float)(-2 * zFar * zNear / (zFar - zNear)), 0
+	};
+	memcpy(m, projection, sizeof(projection));
+}
+
+static double percentile(std::vector<double> values, double p)
+{
+	if (values.empty())
+		return 0;
+	size_t n = (size_t)(p * (values.size() - 1));
+	std::nth_element(values.begin(), values.begin() + n, values.end());
+	return values[n];
+}
+
+static double mean(const std::vector<double> &values)
+{
+	double sum = 0;
+	for (size_t i = 0; i < values.size(); i++)
+		sum += values[i];
+	return values.empty() ? 0 : sum / values.size();
+}
+
+static void writeTimes(std::ostream &out, const char * name, const std::vector<double> &times, bool last)
+{
+	out << "    \"" << name << "\": {\"min\": " << percentile(times, 0.0) << ", \"median\": " << percentile(times, 0.5)
+		<< ", \"p99\": " << percentile(times, 0.99) << ", \"mean\": " << mean(times) << "}" << (last ? "" : ",") << std::endl;
+}
+
+static void writeJSON(std::ostream &out, const std::string &input, int width, int height, int numObjects, int numParticles,
+	const FrameTimes &times)
+{
+	std::vector<double> drawCalls(times.drawCalls.begin(), times.drawCalls.end());
+	std::vector<double> vertices(times.vertices.begin(), times.vertices.end());
+	std::vector<double> culled(times.culled.begin(), times.culled.end());
+
+	out << "{" << std::endl;
+#ifdef NDEBUG
+	out << "  \"build\": \"release\"," << std::endl;
+#else
+	out << "  \"build\": \"debug\"," << std::endl;
+#endif
+	out << "  \"renderer\": \"" << glGetString(GL_RENDERER) << "\"," << std::endl;
+	out << "  \"input\": \"" << input << "\"," << std::endl;
+	out << "  \"eye\": [" << width << ", " << height << "]," << std::endl;
+	out << "  \"objects\": " << numObjects << "," << std::endl;
+	out << "  \"particles\": " << numParticles << "," << std::endl;
+	out << "  \"frames\": " << times.submit.size() << "," << std::endl;
+	out << "  \"per_frame\": {" << std::endl;
+	writeTimes(out, "submit_ms", times.submit, false);
+	writeTimes(out, "frame_ms", times.total, false);
+	writeTimes(out, "draw_calls", drawCalls, false);
+	writeTimes(out, "vertices", vertices, false);
+	writeTimes(out, "culled", culled, true);
+	out << "  }," << std::endl;
+	out << "  \"phases_ms\": {" << std::endl;
+	VRProfiler * profiler = VRProfiler::getInstance();
+	for (int p = 0; p < profiler->getNumPhases(); p++)
+	{
+		VRProfiler::Stats stats = profiler->getStats(p);
+		out << "    \"" << profiler->getPhaseName(p) << "\": {\"min\": " << stats.min << ", \"avg\": " << stats.avg << ", \"p99\": " << stats.p99 << "}"
+			<< ((p + 1 < profiler->getNumPhases()) ? "," : "") << std::endl;
+	}
+	out << "  }," << std::endl;
+	out << "  \"memory_bytes\": {" << std::endl;
+	VRMemoryTracker * memory = VRMemoryTracker::getInstance();
+	for (int c = 0; c <= memory->getNumCategories(); c++)
+	{
+		bool total = c == memory->getNumCategories();
+		VRMemoryTracker::Usage usage = total ? memory->getTotal() : memory->getUsage(c);
+		VRMemoryTracker::Usage peak = total ? memory->getTotalPeak() : memory->getPeak(c);
+		out << "    \"" << usage.name << "\": {\"cpu\": " << usage.cpuBytes << ", \"gpu\": " << usage.gpuBytes
+			<< ", \"peak_cpu\": " << peak.cpuBytes << ", \"peak_gpu\": " << peak.gpuBytes << "}" << (total ? "" : ",") << std::endl;
+	}
+	out << "  }" << std::endl << "}" << std::endl;
+}
+
+static void usage(const char * name)
+{
+	std::cerr << "usage: " << name << " [<directory>] [-frames N] [-width W] [-height H] [-particles P] [-trail T] [-scale S]"
+		<< " [-distance D] [-transparent] [-project] [-nomenus] [-nolod] [-o results.json]" << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+	std::string directory, output;
+	int numFrames = 600;
+	int width = 1080;
+	int height = 1200;
+	int particlesPerBone = 4;
+	int trail = 100;
+	double scale = 0.0328;
+	double orbitDistance = 1.5;
+	bool transparent = false;
+	bool project = false;
+	bool drawMenus = true;
+	bool lod = true;
+
+	for (int i = 1; i < argc; i++)
+	{
+		bool hasValue = i + 1 < argc;
+		if (!strcmp(argv[i], "-frames") && hasValue) numFrames = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-width") && hasValue) width = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-height") && hasValue) height = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-particles") && hasValue) particlesPerBone = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-trail") && hasValue) trail = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-scale") && hasValue) scale = atof(argv[++i]);
+		else if (!strcmp(argv[i], "-distance") && hasValue) orbitDistance = atof(argv[++i]);
+		else if (!strcmp(argv[i], "-o") && hasValue) output = argv[++i];
+		else if (!strcmp(argv[i], "-transparent")) transparent = true;
+		else if (!strcmp(argv[i], "-project")) project = true;
+		else if (!strcmp(argv[i], "-nomenus")) drawMenus = false;
+		else if (!strcmp(argv[i], "-nolod")) lod = false;
+		else if (argv[i][0] != '-' && directory.empty()) directory = argv[i];
+		else
+		{
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (!createContext() || !createFramebuffer(width, height))
+		return 1;
+
+	std::string input = directory;
+	if (directory.empty())
+	{
+		directory = SYNTHETIC_TRIAL;
+		input = "synthetic trial";
+		if (!fileExists(directory + "/Data.csv") && !writeSyntheticTrial(directory))
+		{
+			std::cerr << "Could not write the synthetic trial" << std::endl;
+			return 1;
+		}
+	}
+
+	std::vector<XMAObject*> objects;
+	if (!loadTrial(directory, objects))
+	{
+		std::cerr << "Could not load " << directory << std::endl;
+		return 1;
+	}
+
+	int maxFrame = objects[0]->getTransformationSize();
+	for (size_t i = 1; i < objects.size(); i++)
+		maxFrame = std::min(maxFrame, objects[i]->getTransformationSize());
+
+	XMARenderer renderer;
+	std::string sphereFile = "sphere.obj";
+	if (!fileExists(sphereFile))
+	{
+		sphereFile = SYNTHETIC_SPHERE;
+		XMASynthetic::writeSphereOBJ(sphereFile, 16, 16, 1.0f, true);
+	}
+	renderer.loadSphere(sphereFile.c_str());
+
+	//particles spread along every bone, in bone coordinates as when added with the controller
+	float fixPose[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+	std::vector<XMAParticle> particles;
+	for (size_t b = 0; b < objects.size(); b++)
+	{
+		for (int p = 0; p < particlesPerBone; p++)
+		{
+			XMAParticle particle;
+			particle.object = b;
+			particle.position = VRPoint3(5.0f, 20.0f + 30.0f * p, 0.0f);
+			particle.color = particles.size() % XMA_PARTICLE_COLORS;
+			particle.positions.resize(3 * maxFrame);
+			particle.visible.resize(maxFrame);
+			float position[3] = { particle.position.x, particle.position.y, particle.position.z };
+			XMAAnalysis::computeTrajectory(position, objects[b]->getTrack(), NULL, fixPose, maxFrame,
+				&particle.positions[0], &particle.visible[0]);
+			particle.updateTrailBounds();
+			particles.push_back(particle);
+		}
+	}
+	long long particleBytes = 0;
+	for (size_t p = 0; p < particles.size(); p++)
+		particleBytes += particles[p].positions.capacity() * sizeof(float) + particles[p].visible.capacity();
+	VRMemoryTracker::getInstance()->allocate(VRMemoryTracker::getInstance()->addCategory("Particles"), particleBytes);
+
+	//center and size of the scene in the first frame, the camera orbits around it
+	VRPoint3 center(0, 0, 0);
+	for (size_t b = 0; b < objects.size(); b++)
+	{
+		VRPoint3 p = objects[b]->getTransformation(0) * VRPoint3(0, 0, 0);
+		center = center + VRVector3(p.x, p.y, p.z) * (float)(1.0 / objects.size());
+	}
+	double radius = 0;
+	for (size_t b = 0; b < objects.size(); b++)
+	{
+		VRPoint3 p = objects[b]->getTransformation(0) * VRPoint3(0, 0, 0);
+		radius = std::max(radius, (double)(p - center).length());
+	}
+	radius = (radius + 100.0) * scale;
+	center = VRPoint3(center.x * scale, center.y * scale, center.z * scale);
+
+	//a menu with a graph and a text box that changes every frame, as the frame counter during playback
+	std::vector<VRMenu*> menus;
+	VRTextBox * textbox_frame = NULL;
+	VRGraph * graph = NULL;
+	if (drawMenus)
+	{
+		std::vector<double> distance;
+		if (particles.size() >= 2)
+			XMAAnalysis::distanceSeries(&particles[0].positions[0], &particles[0].visible[0], &particles[1].positions[0], &particles[1].visible[0],
+				maxFrame, -9999999999, distance);
+		else
+			distance.assign(maxFrame, 0.0);
+
+		VRMenu * menu = new VRMenu(1.0, 1.0, 8, 8, "Render benchmark");
+		textbox_frame = new VRTextBox("textbox_frame", "Frame: 1");
+		textbox_frame->setOverlay(true);
+		menu->addElement(textbox_frame, 1, 1, 8, 1);
+		VRToggle * toggle = new VRToggle("toggle_play", "Play");
+		toggle->setToggled(true);
+		menu->addElement(toggle, 1, 2, 8, 1);
+		graph = new VRGraph("graph_distance", distance);
+		menu->addElement(graph, 1, 3, 8, 6);
+		menu->setVisible(true);
+		menus.push_back(menu);
+	}
+
+	XMARenderState state;
+	state.objects = &objects;
+	state.particles = &particles;
+	state.menus = &menus;
+	state.scale = scale;
+	state.fixed_obj = -1;
+	state.current_obj = 0;
+	state.hover_particle = -1;
+	state.selected_particle = -1;
+	state.particle_trail = trail;
+	state.points[0] = particles.size() >= 2 ? 0 : -1;
+	state.points[1] = particles.size() >= 2 ? 1 : -1;
+	state.points[2] = -1;
+	state.points[3] = -1;
+	state.tool_dist = -0.8;
+	state.transparent = transparent;
+	state.project = project;
+	state.showTool = true;
+	state.showToolSphere = true;
+	state.lod = lod;
+
+	VRProfiler * profiler = VRProfiler::getInstance();
+	renderer.registerProfilerPhases();
+	profiler->setEnabled(true);
+
+	float projection[16];
+	frustum(100.0, (double)width / height, 0.05, 100.0, projection);
+
+	typedef std::chrono::steady_clock Clock;
+	FrameTimes times;
+	for (int f = 0; f < numFrames; f++)
+	{
+		Clock::time_point frameStart = Clock::now();
+
+		//playback and menu update as in the context pass of XROMM-VR
+		state.frame = f % maxFrame;
+		for (size_t i = 0; i < objects.size(); i++)
+			objects[i]->setPlayhead((int)state.frame);
+
+		double angle = f * ORBIT_STEP * M_PI / 180.0;
+		VRPoint3 head(center.x + orbitDistance * radius * sin(angle), center.y + 0.5 * radius, center.z + orbitDistance * radius * cos(angle));
+		VRVector3 forward = (center - head).normalize();
+		VRVector3 right = forward.cross(VRVector3(0, 1, 0)).normalize();
+
+		//menu and controller held in front of the head
+		float pose[16];
+		lookAt(head, center, pose);
+		VRMatrix4 headpose = VRMatrix4(pose).inverse();
+		state.controllerpose = headpose * VRMatrix4::translation(VRVector3(0.2, -0.3, -0.5));
+		VRMatrix4 menupose = headpose * VRMatrix4::translation(VRVector3(-0.3, 0.0, -1.0));
+		if (drawMenus)
+		{
+			textbox_frame->setText("Frame: " + std::to_string((long long)state.frame + 1));
+			graph->setCurrent(state.frame);
+		}
+		for (size_t m = 0; m < menus.size(); m++)
+		{
+			menus[m]->setTransformation(menupose);
+			menus[m]->updateIteration();
+			menus[m]->updateTexture();
+		}
+
+		state.headpose = headpose;
+		state.focalLength = projection[5];
+		renderer.resetStats();
+		Clock::time_point prepareStart = Clock::now();
+		renderer.prepare(state);
+		double submit = std::chrono::duration<double, std::milli>(Clock::now() - prepareStart).count();
+		for (int eye = 0; eye < 2; eye++)
+		{
+			VRPoint3 eyePosition = head + right * (float)((eye == 0 ? -0.5 : 0.5) * EYE_SEPARATION);
+			float view[16];
+			lookAt(eyePosition, eyePosition + forward, view);
+
+			Clock::time_point submitStart = Clock::now();
+			renderer.render(projection, view);
+			submit += std::chrono::duration<double, std::milli>(Clock::now() - submitStart).count();
+		}
+		glFinish();
+
+		times.submit.push_back(submit);
+		times.total.push_back(std::chrono::duration<double, std::milli>(Clock::now() - frameStart).count());
+		times.drawCalls.push_back(renderer.getStats().drawCalls);
+		times.vertices.push_back(renderer.getStats().vertices);
+		const XMARenderer::Stats &stats = renderer.getStats();
+		times.culled.push_back(stats.culledObjects + stats.culledParticles + stats.culledTrails);
+		profiler->endFrame();
+	}
+
+	std::cerr << "submit " << percentile(times.submit, 0.5) << " ms, frame " << percentile(times.total, 0.5) << " ms, "
+		<< times.drawCalls.back() << " draw calls per frame, " << percentile(std::vector<double>(times.culled.begin(), times.culled.end()), 0.5)
+		<< " culled" << std::endl;
+
+	if (output.empty())
+	{
+		writeJSON(std::cout, input, width, height, objects.size(), particles.size(), times);
+	}
+	else
+	{
+		std::ofstream out(output.c_str());
+		writeJSON(out, input, width, height, objects.size(), particles.size(), times);
+	}
+
+	for (size_t m = 0; m < menus.size(); m++)
+		delete menus[m];
+	for (size_t i = 0; i < objects.size(); i++)
+		delete objects[i];
+	return 0;
+}